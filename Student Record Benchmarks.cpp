@@ -0,0 +1,551 @@
+// Benchmarks for the student record system. They build as a program of
+// their own (see Benchmarks in README.md) and run as
+//   ./student_bench <suite> [students...]
+//   ./student_bench generate <file> <count>
+// Each suite prints one result line per roster size on stdout. Console
+// messages of the roster code go to stderr.
+
+#include <chrono>
+#include <cstdio>
+#include <memory>
+
+#define STUDENT_RECORD_NO_MAIN // this file supplies main
+#include "Student Record Management System.cpp"
+
+class Benchmarks {
+public:
+  static bool run(const vector<string> &args, FILE *out) {
+    string suite = args.empty() ? "" : args[0];
+    if (suite == "generate") {
+      size_t count;
+      if (args.size() < 3 || !parseCount(args[2], count)) {
+        cout << "[ERROR] Usage: generate <file> <count>\n";
+        return false;
+      }
+      return writeRoster(args[1], count);
+    }
+
+    vector<size_t> sizes;
+    for (size_t i = 1; i < args.size(); i++) {
+      size_t count;
+      if (!parseCount(args[i], count)) {
+        cout << "[ERROR] Invalid roster size '" << args[i] << "'\n";
+        return false;
+      }
+      sizes.push_back(count);
+    }
+    if (sizes.empty())
+      sizes = {10000, 100000, 1000000};
+
+    for (size_t count : sizes) {
+      if (suite == "lookup") {
+        lookup(count, out);
+      } else if (suite == "load") {
+        load(count, out);
+      } else if (suite == "import") {
+        import(count, out);
+      } else if (suite == "scaling") {
+        scaling(count, out);
+      } else if (suite == "grades") {
+        grades(count, out);
+      } else if (suite == "pool") {
+        pool(count, out);
+      } else if (suite == "records") {
+        records(count, out);
+      } else {
+        cout << "[ERROR] Unknown suite '" << suite << "'; expected "
+             << "generate, lookup, load, import, scaling, grades, pool or "
+                "records\n";
+        return false;
+      }
+      fflush(out);
+    }
+    return true;
+  }
+
+private:
+  using Clock = chrono::steady_clock;
+
+  static double secondsSince(Clock::time_point start) {
+    return chrono::duration<double>(Clock::now() - start).count();
+  }
+
+  static bool parseCount(const string &text, size_t &count) {
+    if (text.empty() || text.size() > 9 ||
+        text.find_first_not_of("0123456789") != string::npos)
+      return false;
+    count = stoul(text);
+    return count > 0;
+  }
+
+  // Write `count` made-up students to `filename`: the students.txt layout
+  // with marks and two years of attendance, or the CSV import layout when
+  // the name ends in .csv. A given count always gives the same file.
+  static bool writeRoster(const string &filename, size_t count) {
+    static const char *const firstNames[] = {
+        "Ali",   "Ahmed", "Ayesha", "Bilal", "Fatima", "Hamza", "Hassan",
+        "Iqra",  "Maryam", "Omar",  "Sana",  "Usman",  "Zainab", "Zara",
+        "Hina",  "Imran"};
+    static const char *const fatherNames[] = {
+        "Muhammad", "Abdul", "Tariq", "Khalid", "Naveed", "Asif", "Shahid",
+        "Zafar"};
+    static const char *const surnames[] = {
+        "Khan",  "Ahmed",  "Malik",   "Butt",    "Chaudhry", "Qureshi",
+        "Shah",  "Sheikh", "Raza",    "Iqbal",   "Hussain",  "Javed",
+        "Akhtar", "Siddiqui", "Mirza", "Aslam"};
+    static const char *const juniorSubjects[] = {
+        "English", "Urdu", "Maths", "General Science", "Islamiat",
+        "Social Studies", "Computer"};
+    static const char *const lowerCategories[] = {"Computer Science",
+                                                  "Biology"};
+    static const char *const upperCategories[] = {
+        "Computer Science", "Pre-Engineering", "Pre-Medical"};
+
+    ofstream file(filename, ios::binary);
+    if (!file.is_open()) {
+      cout << "[ERROR] Cannot open " << filename << "\n";
+      return false;
+    }
+    bool csv = filename.size() >= 4 &&
+               filename.compare(filename.size() - 4, 4, ".csv") == 0;
+    if (csv)
+      file << "roll,name,father,class,category,admission,dob,cnic,address,"
+              "subjects\n";
+
+    uint64_t random = 0x9E3779B97F4A7C15ULL;
+    auto next = [&random]() {
+      random ^= random << 13;
+      random ^= random >> 7;
+      random ^= random << 17;
+      return random;
+    };
+
+    StudentManager catalog; // for the subjects of classes 8-12
+    string row;
+    char buffer[64];
+    char separator = csv ? ',' : '|';
+    auto field = [&](const string &value) {
+      row += value;
+      row += separator;
+    };
+    for (size_t i = 0; i < count; i++) {
+      int classNum = 1 + (int)(next() % 12);
+      string surname = surnames[next() % 16];
+      uint64_t choice = next();
+      string category = classNum <= 7    ? ""
+                        : classNum <= 10 ? lowerCategories[choice % 2]
+                                         : upperCategories[choice % 3];
+      vector<string> subjects =
+          classNum <= 7
+              ? vector<string>(juniorSubjects, juniorSubjects + 7)
+              : catalog.getSubjectsForClass(to_string(classNum), category);
+      int day = 1 + (int)(next() % 28);
+      int month = 1 + (int)(next() % 12);
+      int year = 2018 - classNum;
+
+      row.clear();
+      field("S" + to_string(i));
+      field(string(firstNames[next() % 16]) + " " + surname);
+      field(string(fatherNames[next() % 8]) + " " + surname);
+      field(to_string(classNum));
+      field(category);
+      field("2024");
+      if (csv) {
+        snprintf(buffer, sizeof(buffer), "%02d%02d%04d", day, month, year);
+        field(buffer);
+        snprintf(buffer, sizeof(buffer), "%05zu%07zu1",
+                 i / 10000000 % 100000, i % 10000000);
+        field(buffer);
+        field("House " + to_string(1 + next() % 500) + " Street " +
+              to_string(1 + next() % 40));
+        for (size_t s = 0; classNum <= 7 && s < subjects.size(); s++)
+          row += (s == 0 ? "" : ";") + subjects[s];
+        file << row << "\n";
+        continue;
+      }
+
+      field("2025");
+      snprintf(buffer, sizeof(buffer), "%02d-%02d-%04d", day, month, year);
+      field(buffer);
+      snprintf(buffer, sizeof(buffer), "%05zu-%07zu-1", i / 10000000 % 100000,
+               i % 10000000);
+      field(buffer);
+      field("House " + to_string(1 + next() % 500) + " Street " +
+            to_string(1 + next() % 40));
+      field(to_string(subjects.size()));
+      field(to_string(next() % 3));
+      field("0");
+      for (size_t s = 0; s < subjects.size(); s++) {
+        // Science subjects of classes 8-12 are marked out of 75
+        bool science = subjects[s] == "Physics" ||
+                       subjects[s] == "Chemistry" ||
+                       subjects[s] == "Computer Science" ||
+                       subjects[s] == "Biology";
+        int maxMarks = classNum >= 8 && science ? 75 : 100;
+        uint64_t marks = next() % 40;
+        row += (s == 0 ? "" : ",") + subjects[s] + ":";
+        row += marks == 0   ? "A"
+               : marks == 1 ? "-"
+                            : to_string(next() % (maxMarks + 1));
+      }
+      row += '|';
+      // Days alternate between 2024 and 2025, March to December
+      int days = 40 + (int)(next() % 40);
+      int offset = (int)(i % 24);
+      for (int k = 0; k < days; k++) {
+        int slot = k / 2;
+        snprintf(buffer, sizeof(buffer), "%d-%02d-%02d:%c,", 2024 + (k & 1),
+                 3 + slot % 10, 1 + offset + slot / 10,
+                 next() % 8 == 0 ? 'A' : 'P');
+        row += buffer;
+      }
+      file << row << "\n";
+    }
+    file.close();
+    if (file.fail()) {
+      cout << "[ERROR] Cannot write " << filename << "\n";
+      return false;
+    }
+    return true;
+  }
+
+  // perf-<count>.txt (or .csv), the generated roster of `count` students,
+  // written on first use and kept for later runs
+  static string rosterFile(size_t count, const char *extension = ".txt") {
+    string filename = "perf-" + to_string(count) + extension;
+    if (!ifstream(filename).is_open())
+      writeRoster(filename, count);
+    return filename;
+  }
+
+  // Loading the generated students.txt into an empty roster
+  static void load(size_t count, FILE *out) {
+    string filename = rosterFile(count);
+    uint64_t size = (uint64_t)ifstream(filename, ios::binary | ios::ate)
+                        .tellg();
+    unique_ptr<StudentManager> manager(new StudentManager());
+    Clock::time_point start = Clock::now();
+    manager->loadFromFile(filename);
+    double seconds = secondsSince(start);
+    int loaded = manager->totalStudents;
+    fprintf(out,
+            "load students=%d bytes=%llu time=%.2fs %.0fMB/s %.0fk rows/s\n",
+            loaded, (unsigned long long)size, seconds, size / seconds / 1e6,
+            loaded / seconds / 1e3);
+  }
+
+  // A manager holding the generated roster of `count` students
+  static unique_ptr<StudentManager> roster(size_t count) {
+    unique_ptr<StudentManager> manager(new StudentManager());
+    manager->loadFromFile(rosterFile(count));
+    return manager;
+  }
+
+  // Importing the generated CSV into an empty roster with 1, 2, 4 and 8
+  // worker threads
+  static void import(size_t count, FILE *out) {
+    string filename = rosterFile(count, ".csv");
+    fprintf(out, "import students=%zu", count);
+    for (size_t threads : {1, 2, 4, 8}) {
+      workerOverride = threads;
+      unique_ptr<StudentManager> manager(new StudentManager());
+      Clock::time_point start = Clock::now();
+      manager->importCSV(filename);
+      fprintf(out, " threads=%zu:%.3fs", threads, secondsSince(start));
+    }
+    workerOverride = 0;
+    fprintf(out, "\n");
+  }
+
+  // How the roster list scales: loading the generated roster (one append
+  // per student), then deleting every student by roll number in random
+  // order (one unlink each), with the mean time per student of each
+  static void scaling(size_t count, FILE *out) {
+    string filename = rosterFile(count);
+    unique_ptr<StudentManager> manager(new StudentManager());
+    Clock::time_point start = Clock::now();
+    manager->loadFromFile(filename);
+    double load = secondsSince(start);
+
+    vector<string> rolls;
+    for (Student *s = manager->head; s != nullptr; s = s->next)
+      rolls.push_back(s->rollNo);
+    uint64_t random = 0x2545F4914F6CDD1DULL;
+    for (size_t i = rolls.size(); i > 1; i--) {
+      random ^= random << 13;
+      random ^= random >> 7;
+      random ^= random << 17;
+      swap(rolls[i - 1], rolls[random % i]);
+    }
+    start = Clock::now();
+    for (const string &roll : rolls)
+      manager->removeStudent(roll);
+    double remove = secondsSince(start);
+
+    size_t students = rolls.size();
+    fprintf(out,
+            "scaling students=%zu load=%.2fs (%.2fus each) "
+            "delete=%.2fs (%.2fus each)%s\n",
+            students, load, load * 1e6 / students, remove,
+            remove * 1e6 / students,
+            manager->head == nullptr ? "" : " LEFTOVERS");
+  }
+
+  // Grade recomputation of the whole roster, best of five runs each: the
+  // per-student Student::recalculateMarks path, gathering the marks into
+  // columns from the subjects (what recomputeAllGrades did before the store
+  // kept them), the scalar and AVX2 kernels on one thread over the store's
+  // marks columns, and recomputeAllGrades (kernels on every worker). The
+  // store's columns must hold what the gather finds, and the kernels must
+  // reproduce the per-student results bit for bit.
+  static void grades(size_t count, FILE *out) {
+    const int ROUNDS = 5;
+    unique_ptr<StudentManager> manager = roster(count);
+    StudentStore &store = manager->store;
+    size_t slots = store.slotCount();
+    auto best = [](const function<void()> &run) {
+      double fastest = 0;
+      for (int round = 0; round < ROUNDS; round++) {
+        Clock::time_point start = Clock::now();
+        run();
+        double seconds = secondsSince(start);
+        if (round == 0 || seconds < fastest)
+          fastest = seconds;
+      }
+      return fastest * 1e3;
+    };
+
+    double perStudent = best([&] {
+      for (Student *s = manager->head; s != nullptr; s = s->next)
+        s->recalculateMarks();
+    });
+    MarksColumns columns;
+    double gather = best([&] {
+      columns = MarksColumns();
+      for (size_t slot = 0; slot < slots; slot++)
+        StudentManager::gatherMarks(columns, store.owner[slot]);
+    });
+
+    // Each kernel writes its own copy of the per-student results
+    struct Results {
+      vector<float> totalMarks, maxMarks, percentage;
+      vector<char> grade;
+      static Results of(const StudentStore &store, size_t slots) {
+        return {{store.totalMarks.begin(), store.totalMarks.begin() + slots},
+                {store.maxMarks.begin(), store.maxMarks.begin() + slots},
+                {store.percentage.begin(), store.percentage.begin() + slots},
+                {store.grade.begin(), store.grade.begin() + slots}};
+      }
+      GradeColumns columns() {
+        return {totalMarks.data(), maxMarks.data(), percentage.data(),
+                grade.data()};
+      }
+      bool operator==(const Results &other) const {
+        auto same = [](const auto &a, const auto &b) {
+          return memcmp(a.data(), b.data(), a.size() * sizeof(a[0])) == 0;
+        };
+        return same(totalMarks, other.totalMarks) &&
+               same(maxMarks, other.maxMarks) &&
+               same(percentage, other.percentage) && same(grade, other.grade);
+      }
+    };
+    Results expected = Results::of(store, slots);
+    const MarksColumns &stored = store.marks;
+    bool matches = true;
+    for (size_t slot = 0; slot < slots && matches; slot++) {
+      uint32_t count = columns.count[slot];
+      matches =
+          stored.count[slot] == count &&
+          equal(columns.marks.begin() + columns.offset[slot],
+                columns.marks.begin() + columns.offset[slot] + count,
+                stored.marks.begin() + stored.offset[slot]) &&
+          equal(columns.maxMarks.begin() + columns.offset[slot],
+                columns.maxMarks.begin() + columns.offset[slot] + count,
+                stored.maxMarks.begin() + stored.offset[slot]);
+    }
+
+    Results scalar = expected;
+    double scalarKernel = best(
+        [&] { recomputeGradesScalar(stored, scalar.columns(), 0, slots); });
+    matches = matches && scalar == expected;
+
+    double avx2Kernel = -1;
+#ifdef HAVE_AVX2_KERNEL
+    if (__builtin_cpu_supports("avx2")) {
+      Results avx2 = expected;
+      avx2Kernel = best(
+          [&] { recomputeGradesAVX2(stored, avx2.columns(), 0, slots); });
+      matches = matches && avx2 == expected;
+    }
+#endif
+
+    double all = best([&] { manager->recomputeAllGrades(); });
+    matches = matches && Results::of(store, slots) == expected;
+
+    int students = manager->totalStudents;
+    fprintf(out,
+            "grades students=%d per-student=%.1fms gather=%.1fms "
+            "scalar=%.1fms ",
+            students, perStudent, gather, scalarKernel);
+    if (avx2Kernel < 0)
+      fprintf(out, "avx2=unsupported ");
+    else
+      fprintf(out, "avx2=%.1fms ", avx2Kernel);
+    fprintf(out, "recompute-all=%.1fms%s\n", all,
+            matches ? "" : " MISMATCH");
+  }
+
+  // Building the generated roster (load) and tearing it down (destroying
+  // the manager), then the same number of student, record-version and
+  // attendance-year blocks allocated from a BlockPool and with operator
+  // new, and released by destroying the pool or by one delete per block
+  static void pool(size_t count, FILE *out) {
+    unique_ptr<StudentManager> manager(new StudentManager());
+    string filename = rosterFile(count);
+    Clock::time_point start = Clock::now();
+    manager->loadFromFile(filename);
+    double build = secondsSince(start);
+    int students = manager->totalStudents;
+    BlockPool::Stats pools[] = {manager->store.studentBlocks.stats(),
+                                manager->store.recordBlocks.stats(),
+                                manager->store.yearBlocks.stats()};
+    start = Clock::now();
+    manager.reset();
+    double teardown = secondsSince(start);
+
+    double poolAllocate = 0, poolRelease = 0;
+    double newAllocate = 0, newRelease = 0;
+    size_t blocks = 0, slabs = 0;
+    for (const BlockPool::Stats &stats : pools) {
+      blocks += stats.liveBlocks;
+      slabs += stats.slabs;
+      unique_ptr<BlockPool> pool(new BlockPool());
+      start = Clock::now();
+      for (size_t i = 0; i < stats.liveBlocks; i++)
+        pool->allocate(stats.blockSize);
+      poolAllocate += secondsSince(start);
+      start = Clock::now();
+      pool.reset();
+      poolRelease += secondsSince(start);
+
+      vector<void *> allocated(stats.liveBlocks);
+      start = Clock::now();
+      for (void *&block : allocated)
+        block = ::operator new(stats.blockSize);
+      newAllocate += secondsSince(start);
+      start = Clock::now();
+      for (void *block : allocated)
+        ::operator delete(block);
+      newRelease += secondsSince(start);
+    }
+
+    fprintf(out,
+            "pool students=%d build=%.2fs teardown=%.1fms blocks=%zu "
+            "slabs=%zu pool-allocate=%.1fms pool-release=%.1fms "
+            "new=%.1fms delete=%.1fms\n",
+            students, build, teardown * 1e3, blocks, slabs,
+            poolAllocate * 1e3, poolRelease * 1e3, newAllocate * 1e3,
+            newRelease * 1e3);
+  }
+
+  // Record operations on 1, 2, 4 and 8 threads at once: a million in all,
+  // on random students, 90% lookupStudent and 10% writes split between
+  // setAttendance and setMarks
+  static void records(size_t count, FILE *out) {
+    const size_t OPERATIONS = 1000000;
+    unique_ptr<StudentManager> manager = roster(count);
+    vector<string> rolls;
+    for (Student *s = manager->head; s != nullptr; s = s->next)
+      rolls.push_back(s->rollNo);
+    const vector<string> statuses(9, "50");
+
+    fprintf(out, "records students=%zu", rolls.size());
+    for (size_t threads : {1, 2, 4, 8}) {
+      vector<thread> workers;
+      Clock::time_point start = Clock::now();
+      for (size_t t = 0; t < threads; t++) {
+        workers.emplace_back([&, t] {
+          uint64_t random = 0x9E3779B97F4A7C15ULL * (t + 1);
+          StudentManager::StudentView view;
+          for (size_t i = 0; i < OPERATIONS / threads; i++) {
+            random ^= random << 13;
+            random ^= random >> 7;
+            random ^= random << 17;
+            const string &roll = rolls[random % rolls.size()];
+            uint64_t kind = (random >> 40) % 20;
+            if (kind == 0)
+              manager->setMarks(roll, statuses, false);
+            else if (kind == 1)
+              manager->setAttendance(roll, 2025, 3 + (random >> 48) % 10,
+                                     1 + (random >> 56) % 28, true);
+            else
+              manager->lookupStudent(roll, view);
+          }
+        });
+      }
+      for (thread &worker : workers)
+        worker.join();
+      fprintf(out, " threads=%zu:%.0fk/s", threads,
+              OPERATIONS / threads * threads / secondsSince(start) / 1e3);
+    }
+    fprintf(out, "\n");
+  }
+
+  // Roll number lookups in the std::map the roster used to keep against
+  // its own roll index: time to build each over the generated roster, then
+  // the mean time of a million hits in the same random order
+  static void lookup(size_t count, FILE *out) {
+    const size_t LOOKUPS = 1000000;
+    using RollLookup = decltype(StudentManager::hashTable);
+    unique_ptr<StudentManager> manager = roster(count);
+    vector<Student *> students;
+    for (Student *s = manager->head; s != nullptr; s = s->next)
+      students.push_back(s);
+    vector<string> rolls;
+    uint64_t random = 0x2545F4914F6CDD1DULL;
+    for (size_t i = 0; i < LOOKUPS; i++) {
+      random ^= random << 13;
+      random ^= random >> 7;
+      random ^= random << 17;
+      rolls.push_back(students[random % students.size()]->rollNo);
+    }
+
+    Clock::time_point start = Clock::now();
+    map<string, Student *> ordered;
+    for (Student *s : students)
+      ordered.emplace(s->rollNo, s);
+    double mapBuild = secondsSince(start);
+
+    start = Clock::now();
+    unique_ptr<RollLookup> index(new RollLookup());
+    index->reserve(students.size());
+    for (Student *s : students)
+      index->insert(s);
+    double indexBuild = secondsSince(start);
+
+    size_t mapHits = 0;
+    start = Clock::now();
+    for (const string &roll : rolls)
+      mapHits += ordered.find(roll) != ordered.end();
+    double mapLookups = secondsSince(start);
+
+    size_t indexHits = 0;
+    start = Clock::now();
+    for (const string &roll : rolls)
+      indexHits += index->find(roll) != nullptr;
+    double indexLookups = secondsSince(start);
+
+    fprintf(out,
+            "lookup students=%zu build: map=%.1fms index=%.1fms "
+            "lookup: map=%.0fns index=%.0fns%s\n",
+            students.size(), mapBuild * 1e3, indexBuild * 1e3,
+            mapLookups * 1e9 / LOOKUPS, indexLookups * 1e9 / LOOKUPS,
+            mapHits == LOOKUPS && indexHits == LOOKUPS ? "" : " MISSES");
+  }
+};
+
+int main(int argc, char *argv[]) {
+  cout.rdbuf(cerr.rdbuf());
+  vector<string> args(argv + 1, argv + argc);
+  return Benchmarks::run(args, stdout) ? 0 : 2;
+}
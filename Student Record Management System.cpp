@@ -1,403 +1,4088 @@
 #include <iostream>
+#include <algorithm>
+#include <atomic>
+#include <bitset>
+#include <charconv>
+#include <chrono>
+#include <cstddef>
+#include <cstdlib>
+#include <cstdint>
+#include <cstdio>
+#include <cctype>
+#include <cstring>
 #include <ctime>
+#include <deque>
 #include <fstream>
 #include <functional>
 #include <iomanip>
+#include <list>
 #include <map>
+#include <memory>
+#include <mutex>
 #include <sstream>
 #include <stack>
 #include <string>
+#include <string_view>
+#include <thread>
+#include <unordered_map>
+#include <unordered_set>
 #include <vector>
 
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#include <immintrin.h>
+#define HAVE_AVX2_KERNEL // AVX2 kernels compiled in, chosen at runtime
+#endif
+
+#ifdef _WIN32
+#include <io.h>
+#include <malloc.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+#ifdef __linux__
+#include <arpa/inet.h>
+#include <cerrno>
+#include <csignal>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <sys/epoll.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#endif
+
 using namespace std;
 
-// Calendar structure to manage dates from 2024-2034
-class Calendar {
+// Fixed-size blocks carved out of 1 MiB slabs. A freed block goes on a free
+// list for the next allocation; slabs are only returned when the pool is
+// destroyed, so dropping a whole roster costs one free per slab rather than
+// one per object. Slabs are aligned to their size, which lets release() find
+// a block's pool from the block's address alone. Allocation and release
+// take the pool's lock, as record writers on different threads may mark a
+// student's first day of a year at the same time.
+class BlockPool {
 public:
-  map<string, bool>
-      attendanceMap; // "YYYY-MM-DD" -> true(present)/false(absent)
-
-  bool isLeapYear(int year) {
-    return (year % 4 == 0 && year % 100 != 0) || (year % 400 == 0);
+  static const size_t SLAB_BYTES = 1 << 20;
+
+  struct Stats {
+    size_t blockSize;
+    size_t liveBlocks;
+    size_t allocations; // Blocks handed out over the pool's lifetime
+    size_t slabs;
+  };
+
+  BlockPool()
+      : blockSize(0), slabs(nullptr), slabCount(0), next(nullptr),
+        end(nullptr), freeList(nullptr), liveBlocks(0), allocations(0),
+        draining(false) {}
+  BlockPool(const BlockPool &) = delete;
+  BlockPool &operator=(const BlockPool &) = delete;
+
+  ~BlockPool() {
+    while (slabs != nullptr) {
+      Slab *following = slabs->next;
+#ifdef _WIN32
+      _aligned_free(slabs);
+#else
+      free(slabs);
+#endif
+      slabs = following;
+    }
   }
 
-  int getDaysInMonth(int month, int year) {
-    int days[] = {31, 28, 31, 30, 31, 30, 31, 31, 30, 31, 30, 31};
-    if (month == 2 && isLeapYear(year))
-      return 29;
-    return days[month - 1];
+  // The first allocation fixes the block size for the pool
+  void *allocate(size_t size) {
+    lock_guard<mutex> hold(lock);
+    if (blockSize == 0)
+      blockSize = roundUp(max(size, sizeof(FreeBlock)));
+    if (size > blockSize)
+      throw bad_alloc();
+
+    void *block;
+    if (freeList != nullptr) {
+      block = freeList;
+      freeList = freeList->next;
+    } else {
+      if (next == nullptr || next + blockSize > end)
+        addSlab();
+      block = next;
+      next += blockSize;
+    }
+    liveBlocks++;
+    allocations++;
+    return block;
   }
 
-  string getDateKey(int year, int month, int day) {
-    stringstream ss;
-    ss << year << "-" << setfill('0') << setw(2) << month << "-" << setw(2)
-       << day;
-    return ss.str();
+  static void release(void *block) {
+    if (block == nullptr)
+      return;
+    Slab *slab = (Slab *)((uintptr_t)block & ~(uintptr_t)(SLAB_BYTES - 1));
+    slab->pool->releaseBlock(block);
   }
 
-  void markAttendance(int year, int month, int day, bool present) {
-    string key = getDateKey(year, month, day);
-    attendanceMap[key] = present;
-  }
+  // The pool is about to be destroyed with everything in it, so released
+  // blocks need not be threaded back onto the free list
+  void drain() { draining = true; }
 
-  bool getAttendance(int year, int month, int day) {
-    string key = getDateKey(year, month, day);
-    if (attendanceMap.find(key) != attendanceMap.end()) {
-      return attendanceMap[key];
-    }
-    return false; // Default: absent
+  Stats stats() const {
+    lock_guard<mutex> hold(lock);
+    return {blockSize, liveBlocks, allocations, slabCount};
   }
 
-  int getTotalPresent() {
-    int count = 0;
-    for (auto &entry : attendanceMap) {
-      if (entry.second)
-        count++;
-    }
-    return count;
+private:
+  struct Slab {
+    BlockPool *pool;
+    Slab *next;
+  };
+
+  struct FreeBlock {
+    FreeBlock *next;
+  };
+
+  size_t blockSize;
+  Slab *slabs;
+  size_t slabCount;
+  char *next; // Unused tail of the newest slab
+  char *end;
+  FreeBlock *freeList;
+  size_t liveBlocks;
+  size_t allocations;
+  bool draining;
+  mutable mutex lock;
+
+  static size_t roundUp(size_t size) {
+    const size_t align = alignof(max_align_t);
+    return (size + align - 1) / align * align;
   }
 
-  int getTotalAbsent() {
-    int count = 0;
-    for (auto &entry : attendanceMap) {
-      if (!entry.second)
-        count++;
-    }
-    return count;
+  void addSlab() {
+#ifdef _WIN32
+    void *memory = _aligned_malloc(SLAB_BYTES, SLAB_BYTES);
+#else
+    void *memory = aligned_alloc(SLAB_BYTES, SLAB_BYTES);
+#endif
+    if (memory == nullptr)
+      throw bad_alloc();
+    Slab *slab = (Slab *)memory;
+    slab->pool = this;
+    slab->next = slabs;
+    slabs = slab;
+    slabCount++;
+    next = (char *)memory + roundUp(sizeof(Slab));
+    end = (char *)memory + SLAB_BYTES;
   }
 
-  int getTotalDays() { return attendanceMap.size(); }
+  void releaseBlock(void *block) {
+    lock_guard<mutex> hold(lock);
+    liveBlocks--;
+    if (draining)
+      return;
+    FreeBlock *freed = (FreeBlock *)block;
+    freed->next = freeList;
+    freeList = freed;
+  }
 };
 
-class Subject {
+// Calendar structure to manage dates from 2024-2034
+class Calendar {
 public:
-  string subjectName;
-  string marksStatus;
-  Subject *next;
+  static const int FIRST_YEAR = 2024;
+  static const int LAST_YEAR = 2034;
 
-  Subject(string name, string status) {
-    subjectName = name;
-    marksStatus = status;
-    next = nullptr;
+  static const int WORDS_PER_YEAR = 6; // 366 days rounded up to 64-bit words
+  static const int YEARS = LAST_YEAR - FIRST_YEAR + 1;
+
+private:
+  // Two bits per day of the year: whether the day was marked and, if so,
+  // whether the student was present. A year's bits are only allocated once
+  // something in that year is marked.
+  struct YearBits {
+    uint64_t marked[WORDS_PER_YEAR];
+    uint64_t present[WORDS_PER_YEAR];
+    // Running counts: days marked/present in the words before word w. The
+    // last entry is the year's total.
+    uint16_t markedBefore[WORDS_PER_YEAR + 1];
+    uint16_t presentBefore[WORDS_PER_YEAR + 1];
+
+    static void *operator new(size_t size, BlockPool *pool) {
+      return pool->allocate(size);
+    }
+    static void operator delete(void *block, BlockPool *) {
+      BlockPool::release(block);
+    }
+    static void operator delete(void *block) { BlockPool::release(block); }
+  };
+
+  unique_ptr<YearBits> years[YEARS];
+  BlockPool *pool; // Where YearBits are allocated, set by the owning Student
+
+  // Days marked/present in the calendar years before year y; the last entry
+  // is the lifetime total. With the per-word counts above, the count up to
+  // any date is two lookups and one popcount.
+  uint16_t markedBeforeYear[YEARS + 1];
+  uint16_t presentBeforeYear[YEARS + 1];
+
+  static int popcount(uint64_t word) { return (int)bitset<64>(word).count(); }
+
+  static bool testBit(const uint64_t *words, int index) {
+    return (words[index >> 6] >> (index & 63)) & 1;
   }
-};
 
-class Student {
-public:
-  string rollNo; // Changed to string
-  string name;
-  string fatherName;
-  string className;
-  string classCategory;
-  int admissionYear;
-  int currentYear; // Current academic year
-  string dateOfBirth;
-  string cnicBForm;
-  string address;
-  Subject *subjectHead;
-  int totalSubjects;
-  float totalMarks;
-  float maxMarks;
-  float percentage;
-  char grade;
-  int termsCompleted;     // Track number of terms completed
-  bool boardMarksEntered; // Track if board marks are entered
-  Calendar attendance;    // Attendance calendar
-  Student *next;
-  Student *left;
-  Student *right;
+  static int dayOfYear(int year, int month, int day) {
+    static const int daysBefore[] = {0,   31,  59,  90,  120, 151,
+                                     181, 212, 243, 273, 304, 334};
+    int index = daysBefore[month - 1] + day - 1;
+    if (month > 2 && isLeapYear(year))
+      index++;
+    return index;
+  }
 
-  Student(string r, string n, string fn, string cn, string cc, int ay,
-          string dob, string cnic, string addr) {
-    rollNo = r;
-    name = n;
-    fatherName = fn;
-    className = cn;
-    classCategory = cc;
-    admissionYear = ay;
-    currentYear = ay;
-    dateOfBirth = dob;
-    cnicBForm = cnic;
-    address = addr;
-    subjectHead = nullptr;
-    totalSubjects = 0;
-    totalMarks = 0;
-    maxMarks = 0;
-    percentage = 0;
-    grade = 'F';
-    termsCompleted = 0;
-    boardMarksEntered = false;
-    next = nullptr;
-    left = nullptr;
-    right = nullptr;
+  // Add to the running counts of every word after `word` in `year` and of
+  // every later year
+  void shiftCounts(int year, int word, int marked, int present) {
+    YearBits &bits = *years[year - FIRST_YEAR];
+    for (int w = word + 1; w <= WORDS_PER_YEAR; w++) {
+      bits.markedBefore[w] += marked;
+      bits.presentBefore[w] += present;
+    }
+    for (int y = year - FIRST_YEAR + 1; y <= YEARS; y++) {
+      markedBeforeYear[y] += marked;
+      presentBeforeYear[y] += present;
+    }
   }
 
-  int getMaxMarksForSubject(string subjectName) {
-    try {
-      int classNum = stoi(className);
-      if (classNum >= 8 && classNum <= 12) {
-        if (subjectName == "Physics" || subjectName == "Chemistry" ||
-            subjectName == "Computer Science" || subjectName == "Biology") {
-          return 75;
+  // Rebuild all running counts from the bits
+  void recount() {
+    for (int y = 0; y < YEARS; y++) {
+      int marked = 0;
+      int present = 0;
+      if (years[y]) {
+        YearBits &bits = *years[y];
+        for (int w = 0; w < WORDS_PER_YEAR; w++) {
+          bits.markedBefore[w] = (uint16_t)marked;
+          bits.presentBefore[w] = (uint16_t)present;
+          marked += popcount(bits.marked[w]);
+          present += popcount(bits.present[w] & bits.marked[w]);
         }
+        bits.markedBefore[WORDS_PER_YEAR] = (uint16_t)marked;
+        bits.presentBefore[WORDS_PER_YEAR] = (uint16_t)present;
       }
-    } catch (...) {
-      // If className is not a valid number, default to 100
+      markedBeforeYear[y + 1] = (uint16_t)(markedBeforeYear[y] + marked);
+      presentBeforeYear[y + 1] = (uint16_t)(presentBeforeYear[y] + present);
     }
-    return 100;
   }
 
-  void addSubject(string subjectName, string status) {
-    Subject *newSubject = new Subject(subjectName, status);
-
-    if (subjectHead == nullptr) {
-      subjectHead = newSubject;
-    } else {
-      Subject *temp = subjectHead;
-      while (temp->next != nullptr) {
-        temp = temp->next;
-      }
-      temp->next = newSubject;
+  // Marked and present days from the start of the calendar through `days`
+  void countThrough(int32_t days, int &marked, int &present) const {
+    int32_t first = dayNumber(FIRST_YEAR, 1, 1);
+    if (days < first) {
+      marked = present = 0;
+      return;
+    }
+    int year, month, day;
+    fromDayNumber(days, year, month, day);
+    if (year > LAST_YEAR) {
+      marked = markedBeforeYear[YEARS];
+      present = presentBeforeYear[YEARS];
+      return;
     }
+    marked = markedBeforeYear[year - FIRST_YEAR];
+    present = presentBeforeYear[year - FIRST_YEAR];
+    const unique_ptr<YearBits> &bits = years[year - FIRST_YEAR];
+    if (!bits)
+      return;
+    int index = dayOfYear(year, month, day);
+    int w = index >> 6;
+    uint64_t upTo = (index & 63) == 63 ? ~0ULL : (2ULL << (index & 63)) - 1;
+    marked += bits->markedBefore[w] + popcount(bits->marked[w] & upTo);
+    present += bits->presentBefore[w] +
+               popcount(bits->present[w] & bits->marked[w] & upTo);
+  }
 
-    totalSubjects++;
+public:
+  Calendar() : pool(nullptr) {
+    memset(markedBeforeYear, 0, sizeof(markedBeforeYear));
+    memset(presentBeforeYear, 0, sizeof(presentBeforeYear));
+  }
 
-    if (status != "A" && status != "L" && status != "-") {
-      float marks = stof(status);
-      totalMarks += marks;
-      int maxMarksForSub = getMaxMarksForSubject(subjectName);
-      maxMarks += maxMarksForSub;
-    }
+  void usePool(BlockPool *blocks) { pool = blocks; }
+
+  // Point at the same year bits as `from`. Of two calendars sharing bits
+  // only one may free them; the other forgets them first.
+  void share(const Calendar &from) {
+    pool = from.pool;
+    for (int y = 0; y < YEARS; y++)
+      years[y].reset(from.years[y].get());
+    memcpy(markedBeforeYear, from.markedBeforeYear, sizeof(markedBeforeYear));
+    memcpy(presentBeforeYear, from.presentBeforeYear,
+           sizeof(presentBeforeYear));
+  }
 
-    if (maxMarks > 0) {
-      percentage = (totalMarks / maxMarks) * 100.0;
-      grade = calculateGrade(percentage);
+  // Give `year` bits of its own, copied from the shared ones, so marking it
+  // leaves the calendar it shares with unchanged
+  void unshare(int year) {
+    if (year < FIRST_YEAR || year > LAST_YEAR || !years[year - FIRST_YEAR])
+      return;
+    unique_ptr<YearBits> &bits = years[year - FIRST_YEAR];
+    YearBits *shared = bits.release();
+    bits.reset(new (pool) YearBits(*shared));
+  }
+
+  // Drop the bits of every year but `keep` without freeing them, as they
+  // belong to a calendar this one shares with
+  void forget(int keep) {
+    for (int y = 0; y < YEARS; y++) {
+      if (y != keep - FIRST_YEAR)
+        years[y].release();
     }
   }
 
-  static char calculateGrade(float perc) {
-    if (perc >= 90)
-      return 'A';
-    else if (perc >= 80)
-      return 'B';
-    else if (perc >= 70)
-      return 'C';
-    else if (perc >= 60)
-      return 'D';
-    else if (perc >= 50)
-      return 'E';
-    else
-      return 'F';
+  static bool isLeapYear(int year) {
+    return (year % 4 == 0 && year % 100 != 0) || (year % 400 == 0);
   }
 
-  void clearSubjects() {
-    Subject *current = subjectHead;
-    while (current != nullptr) {
-      Subject *next = current->next;
-      delete current;
-      current = next;
-    }
-    subjectHead = nullptr;
-    totalSubjects = 0;
-    totalMarks = 0;
-    maxMarks = 0;
-    percentage = 0;
-    grade = 'F';
+  static int getDaysInMonth(int month, int year) {
+    int days[] = {31, 28, 31, 30, 31, 30, 31, 31, 30, 31, 30, 31};
+    if (month == 2 && isLeapYear(year))
+      return 29;
+    return days[month - 1];
   }
 
-  // Check if student can be promoted
-  bool canBePromoted() {
-    // Must have 3 terms completed
-    if (termsCompleted < 3) {
-      return false;
-    }
+  static bool isValidDate(int year, int month, int day) {
+    return month >= 1 && month <= 12 && day >= 1 &&
+           day <= getDaysInMonth(month, year);
+  }
 
-    // Must have board marks entered (for classes 8-12)
-    try {
-      int classNum = stoi(className);
-      if (classNum >= 8 && classNum <= 12) {
-        if (!boardMarksEntered) {
+  static bool inRange(int year, int month, int day) {
+    return year >= FIRST_YEAR && year <= LAST_YEAR &&
+           isValidDate(year, month, day);
+  }
+
+  // Days since 1970-01-01 in the proleptic Gregorian calendar, so dates
+  // compare and subtract as plain integers
+  static int32_t dayNumber(int year, int month, int day) {
+    year -= month <= 2;
+    int era = (year >= 0 ? year : year - 399) / 400;
+    int yearOfEra = year - era * 400;
+    int dayOfYear = (153 * (month > 2 ? month - 3 : month + 9) + 2) / 5 +
+                    day - 1;
+    int dayOfEra =
+        yearOfEra * 365 + yearOfEra / 4 - yearOfEra / 100 + dayOfYear;
+    return era * 146097 + dayOfEra - 719468;
+  }
+
+  static void fromDayNumber(int32_t days, int &year, int &month, int &day) {
+    days += 719468;
+    int era = (days >= 0 ? days : days - 146096) / 146097;
+    int dayOfEra = days - era * 146097;
+    int yearOfEra = (dayOfEra - dayOfEra / 1460 + dayOfEra / 36524 -
+                     dayOfEra / 146096) /
+                    365;
+    int dayOfYear = dayOfEra - (365 * yearOfEra + yearOfEra / 4 -
+                                yearOfEra / 100);
+    int shifted = (5 * dayOfYear + 2) / 153; // Months counted from March
+    day = dayOfYear - (153 * shifted + 2) / 5 + 1;
+    month = shifted < 10 ? shifted + 3 : shifted - 9;
+    year = yearOfEra + era * 400 + (month <= 2);
+  }
+
+  // Writes `value` as exactly `width` digits
+  static void putDigits(char *out, int value, int width) {
+    for (int i = width - 1; i >= 0; i--, value /= 10)
+      out[i] = (char)('0' + value % 10);
+  }
+
+  // "YYYY-MM-DD", the attendance key format
+  static string getDateKey(int year, int month, int day) {
+    char key[10];
+    putDigits(key, year, 4);
+    key[4] = '-';
+    putDigits(key + 5, month, 2);
+    key[7] = '-';
+    putDigits(key + 8, day, 2);
+    return string(key, sizeof(key));
+  }
+
+  static bool parseDateKey(string_view text, int32_t &days) {
+    if (text.size() != 10 || text[4] != '-' || text[7] != '-')
+      return false;
+    int parts[3] = {0, 0, 0};
+    const int starts[3] = {0, 5, 8};
+    const int widths[3] = {4, 2, 2};
+    for (int part = 0; part < 3; part++) {
+      for (int i = 0; i < widths[part]; i++) {
+        char c = text[starts[part] + i];
+        if (c < '0' || c > '9')
           return false;
-        }
+        parts[part] = parts[part] * 10 + (c - '0');
       }
-    } catch (...) {
-      return false; // Invalid class number
     }
-
-    // Must have percentage calculated
-    if (maxMarks == 0 || percentage == 0) {
+    if (!isValidDate(parts[0], parts[1], parts[2]))
       return false;
-    }
+    days = dayNumber(parts[0], parts[1], parts[2]);
+    return true;
+  }
 
+  // Returns false if the date falls outside the calendar range
+  bool markAttendance(int year, int month, int day, bool present) {
+    if (!inRange(year, month, day))
+      return false;
+    unique_ptr<YearBits> &bits = years[year - FIRST_YEAR];
+    if (!bits)
+      bits.reset(new (pool) YearBits());
+    int index = dayOfYear(year, month, day);
+    int w = index >> 6;
+    uint64_t bit = 1ULL << (index & 63);
+    bool wasMarked = (bits->marked[w] & bit) != 0;
+    bool wasPresent = wasMarked && (bits->present[w] & bit) != 0;
+    bits->marked[w] |= bit;
+    if (present)
+      bits->present[w] |= bit;
+    else
+      bits->present[w] &= ~bit;
+    if (!wasMarked || wasPresent != present)
+      shiftCounts(year, w, wasMarked ? 0 : 1, (int)present - (int)wasPresent);
     return true;
   }
 
-  // Auto-promote to next class (only if eligible)
-  bool promoteToNextClass() {
-    if (!canBePromoted()) {
+  bool getAttendance(int year, int month, int day) const {
+    if (!inRange(year, month, day))
       return false;
-    }
+    const unique_ptr<YearBits> &bits = years[year - FIRST_YEAR];
+    if (!bits)
+      return false; // Default: absent
+    return testBit(bits->present, dayOfYear(year, month, day));
+  }
 
-    try {
-      int classNum = stoi(className);
-      if (classNum < 12) {
-        classNum++;
-        className = to_string(classNum);
-        currentYear++;
-        // Clear old marks for new year
-        clearSubjects();
-        termsCompleted = 0;
-        boardMarksEntered = false;
-        return true;
-      }
-    } catch (...) {
-      return false; // Invalid class number
-    }
-    return false;
+  int getTotalPresent() const { return presentBeforeYear[YEARS]; }
+
+  int getTotalAbsent() const { return getTotalDays() - getTotalPresent(); }
+
+  int getTotalDays() const { return markedBeforeYear[YEARS]; }
+
+  // Marked and present days between two day numbers, both included, in
+  // constant time from the running counts
+  void countBetween(int32_t from, int32_t to, int &marked,
+                    int &present) const {
+    marked = 0;
+    present = 0;
+    if (from > to)
+      return;
+    int markedBefore, presentBefore;
+    countThrough(to, marked, present);
+    countThrough(from - 1, markedBefore, presentBefore);
+    marked -= markedBefore;
+    present -= presentBefore;
   }
 
-  ~Student() { clearSubjects(); }
-};
+  // Raw access to one year's words, used by the binary snapshot. exportYear
+  // returns false when nothing in that year has been marked.
+  bool exportYear(int year, uint64_t *marked, uint64_t *present) const {
+    if (year < FIRST_YEAR || year > LAST_YEAR)
+      return false;
+    const unique_ptr<YearBits> &bits = years[year - FIRST_YEAR];
+    if (!bits)
+      return false;
+    memcpy(marked, bits->marked, sizeof(bits->marked));
+    memcpy(present, bits->present, sizeof(bits->present));
+    return true;
+  }
 
-class StudentManager {
-private:
-  Student *head;
-  int totalStudents;
-  map<string, Student *> hashTable; // String-based hash table
+  void importYear(int year, const uint64_t *marked, const uint64_t *present) {
+    if (year < FIRST_YEAR || year > LAST_YEAR)
+      return;
+    unique_ptr<YearBits> &bits = years[year - FIRST_YEAR];
+    if (!bits)
+      bits.reset(new (pool) YearBits());
+    memcpy(bits->marked, marked, sizeof(bits->marked));
+    memcpy(bits->present, present, sizeof(bits->present));
+    recount();
+  }
 
-  Student *searchInHashTable(string rollNo) {
-    if (hashTable.find(rollNo) != hashTable.end()) {
-      return hashTable[rollNo];
+  // Visit every marked day in chronological order
+  void forEachMarked(function<void(int, int, int, bool)> visit) const {
+    for (int year = FIRST_YEAR; year <= LAST_YEAR; year++) {
+      const unique_ptr<YearBits> &bits = years[year - FIRST_YEAR];
+      if (!bits)
+        continue;
+      int index = 0;
+      for (int month = 1; month <= 12; month++) {
+        int days = getDaysInMonth(month, year);
+        for (int day = 1; day <= days; day++, index++) {
+          if (testBit(bits->marked, index))
+            visit(year, month, day, testBit(bits->present, index));
+        }
+      }
     }
-    return nullptr;
   }
+};
 
-  void addToHashTable(Student *student) {
-    hashTable[student->rollNo] = student;
+// Every subject name in use, interned to a small id. Max marks for each
+// (class, subject) pair are worked out once when the name is first seen, so
+// the marks and display paths only index a table. Marks text that would not
+// print back the same from its number (e.g. "85.50") is interned here too.
+// Names are only added by roster operations, but marks text can be added by
+// concurrent marks writers, so it is interned under a lock into chunks that
+// never move and can be read without one. Both are capped: once full, a new
+// name or text is turned down and the caller reports FULL.
+class SubjectCatalog {
+public:
+  static const int LAST_CLASS = 12;
+  static const uint32_t MAX_SUBJECTS = 4096;
+  static const uint32_t TEXT_CHUNK = 256;
+  static const uint32_t TEXT_CHUNKS = 1 << 10;
+  static constexpr const char *FULL =
+      "too many distinct subject names or marks texts";
+
+  // False if `name` is new and MAX_SUBJECTS names are already in use
+  bool intern(string_view name, uint16_t &id) {
+    auto found = ids.find(name);
+    if (found != ids.end()) {
+      id = found->second;
+      return true;
+    }
+    if (names.size() >= MAX_SUBJECTS)
+      return false;
+    id = (uint16_t)names.size();
+    names.emplace_back(name);
+    ids.emplace(names.back(), id);
+
+    bool science = name == "Physics" || name == "Chemistry" ||
+                   name == "Computer Science" || name == "Biology";
+    for (int classNum = 0; classNum <= LAST_CLASS; classNum++)
+      maxMarksTable.push_back(science && classNum >= 8 ? 75 : 100);
+    return true;
   }
 
-  void removeFromHashTable(string rollNo) { hashTable.erase(rollNo); }
+  const string &name(uint16_t id) const { return names[id]; }
 
-  void showStudentInfo(Student *student) {
-    if (student == nullptr)
-      return;
-    cout << "\n+------------------------------------------------------+\n";
-    cout << "  Roll Number          : " << student->rollNo << "\n";
-    cout << "  Name                 : " << student->name << "\n";
-    cout << "  Father's Name        : " << student->fatherName << "\n";
-    cout << "  Class                : " << student->className << "\n";
-    if (!student->classCategory.empty()) {
-      cout << "  Category             : " << student->classCategory << "\n";
-    }
-    cout << "  Admission Year       : " << student->admissionYear << "\n";
-    cout << "  Current Year         : " << student->currentYear << "\n";
-    cout << "  Date of Birth        : " << student->dateOfBirth << "\n";
-    cout << "  CNIC/B-Form          : " << student->cnicBForm << "\n";
-    cout << "  Address              : " << student->address << "\n";
+  int maxMarks(uint16_t id, int classNum) const {
+    if (classNum < 0 || classNum > LAST_CLASS)
+      return 100;
+    return maxMarksTable[(size_t)id * (LAST_CLASS + 1) + classNum];
+  }
 
-    // Attendance info
-    cout << "  ---------------------------------------------------\n";
-    cout << "  ATTENDANCE SUMMARY:\n";
-    cout << "  Total Days Marked    : " << student->attendance.getTotalDays()
-         << "\n";
-    cout << "  Present Days         : " << student->attendance.getTotalPresent()
-         << "\n";
-    cout << "  Absent Days          : " << student->attendance.getTotalAbsent()
-         << "\n";
+  // False if `text` is new and every chunk is full
+  bool internText(string_view text, bool scored, float marks, uint32_t &id) {
+    lock_guard<mutex> hold(textLock);
+    auto found = textIds.find(text);
+    if (found != textIds.end()) {
+      id = found->second;
+      return true;
+    }
+    id = textCount;
+    if (id / TEXT_CHUNK >= TEXT_CHUNKS)
+      return false;
+    unique_ptr<Text[]> &chunk = texts[id / TEXT_CHUNK];
+    if (!chunk)
+      chunk.reset(new Text[TEXT_CHUNK]);
+    Text &entry = chunk[id % TEXT_CHUNK];
+    entry = {string(text), scored, marks};
+    textIds.emplace(entry.text, id);
+    textCount = id + 1;
+    return true;
+  }
 
-    cout << "  ---------------------------------------------------\n";
-    cout << "  SUBJECT DETAILS:\n";
-    cout << "  ---------------------------------------------------\n";
+  const string &text(uint32_t id) const { return textAt(id).text; }
+  bool textScored(uint32_t id) const { return textAt(id).scored; }
+  float textMarks(uint32_t id) const { return textAt(id).marks; }
 
-    Subject *current = student->subjectHead;
-    int count = 1;
-    while (current != nullptr) {
-      cout << "  " << count << ". " << current->subjectName << " : ";
-      if (current->marksStatus == "A") {
-        cout << "Absent\n";
-      } else if (current->marksStatus == "L") {
-        cout << "Leave\n";
-      } else if (current->marksStatus == "-") {
-        cout << "Not Entered\n";
+private:
+  struct Text {
+    string text;
+    bool scored;
+    float marks;
+  };
+
+  // deques keep the strings in place, so the maps can key on views of them
+  deque<string> names;
+  unordered_map<string_view, uint16_t> ids;
+  vector<uint8_t> maxMarksTable; // (LAST_CLASS + 1) entries per subject
+  unique_ptr<Text[]> texts[TEXT_CHUNKS];
+  uint32_t textCount = 0;
+  unordered_map<string_view, uint32_t> textIds;
+  mutex textLock; // Guards textIds, textCount and adding to texts
+
+  const Text &textAt(uint32_t id) const {
+    return texts[id / TEXT_CHUNK][id % TEXT_CHUNK];
+  }
+};
+
+static SubjectCatalog subjectCatalog;
+
+// One subject of a student: its catalog id and its marks, 8 bytes in all
+struct Subject {
+  enum Status : uint8_t { NOT_ENTERED, ABSENT, LEAVE, SCORED, VERBATIM };
+
+  uint16_t id;
+  uint8_t status;
+  union {
+    float value;   // SCORED
+    uint32_t text; // VERBATIM: catalog text id
+  };
+
+  Subject() : id(0), status(NOT_ENTERED), value(0) {}
+  explicit Subject(uint16_t subjectId)
+      : id(subjectId), status(NOT_ENTERED), value(0) {}
+
+  const string &name() const { return subjectCatalog.name(id); }
+
+  // False, leaving the marks as they were, if `marks` needs a catalog text
+  // and the catalog is full
+  bool setStatus(string_view marks) {
+    if (marks == "-") {
+      status = NOT_ENTERED;
+    } else if (marks == "A") {
+      status = ABSENT;
+    } else if (marks == "L") {
+      status = LEAVE;
+    } else {
+      float number;
+      char buffer[32];
+      bool isNumber = parseMarks(marks, number);
+      if (isNumber) {
+        to_chars_result printed =
+            to_chars(buffer, buffer + sizeof(buffer), number);
+        isNumber = string_view(buffer, printed.ptr - buffer) == marks;
+      }
+      if (isNumber) {
+        status = SCORED;
+        value = number;
       } else {
-        int maxMarksForSub =
-            student->getMaxMarksForSubject(current->subjectName);
-        cout << current->marksStatus << " / " << maxMarksForSub << "\n";
+        bool scored = parseMarks(marks, number);
+        uint32_t id;
+        if (!subjectCatalog.internText(marks, scored, scored ? number : 0,
+                                       id))
+          return false;
+        status = VERBATIM;
+        text = id;
       }
-      current = current->next;
-      count++;
     }
+    return true;
+  }
 
-    cout << "  ---------------------------------------------------\n";
-    cout << "  Total Subjects       : " << student->totalSubjects << "\n";
-    if (student->maxMarks > 0) {
-      cout << "  Total Marks          : " << fixed << setprecision(2)
-           << student->totalMarks << " / " << student->maxMarks << "\n";
-      cout << "  Percentage           : " << student->percentage << "%\n";
-      cout << "  Grade                : " << student->grade << "\n";
-    } else {
-      cout << "  Total Marks          : Not Calculated\n";
+  // False for A/L/- and anything that is not a number
+  bool scored() const {
+    return status == SCORED ||
+           (status == VERBATIM && subjectCatalog.textScored(text));
+  }
+
+  // Numeric marks, valid when scored()
+  float marks() const {
+    return status == SCORED ? value : subjectCatalog.textMarks(text);
+  }
+
+  string marksStatus() const {
+    switch (status) {
+    case NOT_ENTERED:
+      return "-";
+    case ABSENT:
+      return "A";
+    case LEAVE:
+      return "L";
+    case SCORED: {
+      char buffer[32];
+      to_chars_result printed =
+          to_chars(buffer, buffer + sizeof(buffer), value);
+      return string(buffer, printed.ptr);
     }
-    cout << "  ---------------------------------------------------\n";
-    cout << "  Terms Completed      : " << student->termsCompleted << "/3\n";
-    int classNum = stoi(student->className);
-    if (classNum >= 8 && classNum <= 12) {
-      cout << "  Board Marks Entered  : "
-           << (student->boardMarksEntered ? "Yes" : "No") << "\n";
+    default:
+      return subjectCatalog.text(text);
     }
-    cout << "+------------------------------------------------------+\n";
   }
 
-  string getValidInput(string prompt, bool canSkip,
-                       function<bool(string)> validator = nullptr) {
-    string input;
-    while (true) {
-      cout << prompt;
-      if (canSkip)
-        cout << " (Press Enter to skip)";
-      cout << ": ";
-      getline(cin, input);
+  static bool parseMarks(string_view status, float &marks) {
+    const char *last = status.data() + status.size();
+    from_chars_result result = from_chars(status.data(), last, marks);
+    return result.ec == errc() && result.ptr == last;
+  }
+};
 
-      if (input.empty() && canSkip) {
-        return "";
-      }
+// A student's subjects. Up to INLINE of them live inside the Student; only
+// the longer custom lists of classes 1-7 move to the heap.
+class SubjectList {
+public:
+  static const size_t INLINE = 9;
+
+  SubjectList() : count(0) {}
+  SubjectList(const SubjectList &) = delete;
+  SubjectList &operator=(const SubjectList &) = delete;
+
+  size_t size() const { return count; }
+  bool empty() const { return count == 0; }
+  Subject *begin() { return data(); }
+  Subject *end() { return data() + count; }
+  const Subject *begin() const { return data(); }
+  const Subject *end() const { return data() + count; }
+  Subject &operator[](size_t i) { return data()[i]; }
+
+  void push_back(const Subject &subject) {
+    if (count < INLINE) {
+      local[count] = subject;
+    } else {
+      if (spill.empty())
+        spill.assign(begin(), end());
+      spill.push_back(subject);
+    }
+    count++;
+  }
 
-      if (input.empty() && !canSkip) {
-        cout << "[ERROR] This field cannot be empty! Please try again.\n";
-        continue;
-      }
+  void clear() {
+    count = 0;
+    vector<Subject>().swap(spill);
+  }
 
-      if (validator && !validator(input)) {
-        cout << "[ERROR] Invalid input! Please try again.\n";
-        continue;
-      }
+  void assign(const SubjectList &from) {
+    copy(from.local, from.local + INLINE, local);
+    spill = from.spill;
+    count = from.count;
+  }
 
-      return input;
+private:
+  Subject *data() { return spill.empty() ? local : spill.data(); }
+  const Subject *data() const { return spill.empty() ? local : spill.data(); }
+
+  Subject local[INLINE];
+  vector<Subject> spill; // Every subject once there are more than INLINE
+  uint32_t count;
+};
+
+class Student;
+
+// Scored marks of a whole roster flattened for bulk recomputation. The
+// subjects of slot i are marks/maxMarks[offset[i] .. offset[i] + count[i])
+// in the student's subject order.
+struct MarksColumns {
+  vector<uint32_t> offset;
+  vector<uint32_t> count;
+  vector<float> marks;
+  vector<float> maxMarks;
+};
+
+// Column store behind every Student. Fields that whole-roster passes read
+// (class, terms, board flag, marks totals) sit in parallel arrays indexed by
+// the student's slot, so a scan over one field is a sequential sweep. Cold
+// strings that are only needed for display or export live in one arena.
+// Each student's scored marks are kept in marks columns too, so a whole
+// roster recompute runs the grade kernels without gathering them.
+class StudentStore {
+public:
+  enum ColdField {
+    NAME,
+    FATHER_NAME,
+    DATE_OF_BIRTH,
+    CNIC_B_FORM,
+    ADDRESS,
+    COLD_FIELDS
+  };
+
+  // Hot columns, one entry per slot
+  vector<uint8_t> classNumber;
+  vector<uint8_t> termsCompleted;
+  vector<uint8_t> boardMarksEntered;
+  vector<int16_t> currentYear;
+  vector<float> totalMarks;
+  vector<float> maxMarks;
+  vector<float> percentage;
+  vector<char> grade;
+  vector<Student *> owner; // nullptr marks a free slot
+  vector<uint64_t> listOrder; // Position in the roster list, ascending
+
+  // Scored marks and max marks of every slot, in subject order, written by
+  // Student as its subjects change. A free slot has none.
+  MarksColumns marks;
+
+  // Number of the last background save that has written each slot's
+  // student (see StudentManager::saveInBackground). Slots taken while a
+  // save runs start out at its number, since their students are too new for
+  // it. A deque so adding slots never moves the atomics.
+  deque<atomic<uint32_t>> captured;
+  uint32_t captureGeneration;
+
+  // Identity columns. A CNIC is kept as its 13 digits plus one and a date of
+  // birth as a Calendar day number. Text that is not in the canonical
+  // "12345-1234567-1" / "DD-MM-YYYY" form stays verbatim in the arena.
+  static const uint64_t NO_CNIC = 0;
+  static const uint64_t CNIC_VERBATIM = UINT64_MAX;
+  static const int32_t NO_BIRTH_DAY = INT32_MIN;
+  static const int32_t BIRTH_DAY_VERBATIM = INT32_MAX;
+  vector<uint64_t> cnic;
+  vector<int32_t> birthDay;
+
+  // Students, their record versions and attendance years are carved from
+  // these pools
+  BlockPool studentBlocks;
+  BlockPool recordBlocks;
+  BlockPool yearBlocks;
+
+private:
+  struct ColdRef {
+    uint32_t offset;
+    uint32_t length;
+  };
+
+  vector<ColdRef> cold; // COLD_FIELDS entries per slot
+  string arena;
+  size_t deadBytes;
+  vector<uint32_t> freeSlots;
+  bool draining;
+
+  // Room each slot has in the marks columns from its offset on. A slot that
+  // outgrows it moves to the end, unless it is already last and grows in
+  // place; moved-out entries are dead until compactMarks.
+  vector<uint32_t> marksRoom;
+  size_t deadMarks;
+  mutex marksLock; // Marks writers of different students run concurrently
+
+  // Category names, shared by every student in the category
+  deque<string> categories;
+  unordered_map<string_view, const string *> categoryIds;
+
+  // Drop the strings of released slots once they make up most of the arena
+  void compactArena() {
+    string packed;
+    packed.reserve(arena.size() - deadBytes);
+    for (size_t slot = 0; slot < owner.size(); slot++) {
+      for (int field = 0; field < COLD_FIELDS; field++) {
+        ColdRef &ref = cold[slot * COLD_FIELDS + field];
+        if (owner[slot] == nullptr) {
+          ref.offset = ref.length = 0;
+          continue;
+        }
+        uint32_t offset = (uint32_t)packed.size();
+        packed.append(arena, ref.offset, ref.length);
+        ref.offset = offset;
+      }
     }
+    arena.swap(packed);
+    deadBytes = 0;
   }
 
-  static bool validateCNIC(string cnic) {
-    if (cnic.length() != 13)
-      return false;
-    for (char c : cnic) {
-      if (c < '0' || c > '9')
-        return false;
+  // Pack the live marks of every slot, leaving each just its own count
+  void compactMarks() {
+    vector<float> packed;
+    vector<float> packedMax;
+    packed.reserve(marks.marks.size() - deadMarks);
+    packedMax.reserve(marks.marks.size() - deadMarks);
+    for (size_t slot = 0; slot < owner.size(); slot++) {
+      uint32_t offset = marks.offset[slot];
+      uint32_t count = marks.count[slot];
+      marks.offset[slot] = (uint32_t)packed.size();
+      marksRoom[slot] = count;
+      packed.insert(packed.end(), marks.marks.begin() + offset,
+                    marks.marks.begin() + offset + count);
+      packedMax.insert(packedMax.end(), marks.maxMarks.begin() + offset,
+                       marks.maxMarks.begin() + offset + count);
     }
-    return true;
+    marks.marks.swap(packed);
+    marks.maxMarks.swap(packedMax);
+    deadMarks = 0;
   }
 
-  static bool validateDOB(string dob) {
-    if (dob.length() != 8)
-      return false;
-    for (char c : dob) {
-      if (c < '0' || c > '9')
-        return false;
+  // Room for `count` marks at the slot's offset, keeping its current ones;
+  // marksLock held
+  void reserveMarks(uint32_t slot, uint32_t count) {
+    if (count <= marksRoom[slot])
+      return;
+    if (marks.offset[slot] + marksRoom[slot] != marks.marks.size()) {
+      deadMarks += marksRoom[slot];
+      if (deadMarks > (1 << 16) && deadMarks * 2 > marks.marks.size())
+        compactMarks();
+      uint32_t from = marks.offset[slot];
+      uint32_t end = (uint32_t)marks.marks.size();
+      marks.marks.resize(end + marks.count[slot]);
+      marks.maxMarks.resize(end + marks.count[slot]);
+      copy_n(marks.marks.begin() + from, marks.count[slot],
+             marks.marks.begin() + end);
+      copy_n(marks.maxMarks.begin() + from, marks.count[slot],
+             marks.maxMarks.begin() + end);
+      marks.offset[slot] = end;
+      marksRoom[slot] = marks.count[slot];
     }
-    return true;
+    // Last in the columns now, so it grows in place
+    marks.marks.resize(marks.offset[slot] + count);
+    marks.maxMarks.resize(marks.offset[slot] + count);
+    marksRoom[slot] = count;
   }
 
-  static bool validateYear(string year) {
-    try {
+public:
+  StudentStore()
+      : captureGeneration(0), deadBytes(0), draining(false), deadMarks(0) {}
+
+  size_t slotCount() const { return owner.size(); }
+
+  uint32_t allocate(Student *student) {
+    // Compacting moves every string, so it waits for a roster operation
+    // (allocation) rather than running when a concurrent delete releases
+    if (deadBytes > (1 << 20) && deadBytes * 2 > arena.size())
+      compactArena();
+    uint32_t slot;
+    if (!freeSlots.empty()) {
+      slot = freeSlots.back();
+      freeSlots.pop_back();
+    } else {
+      slot = (uint32_t)owner.size();
+      classNumber.push_back(0);
+      termsCompleted.push_back(0);
+      boardMarksEntered.push_back(0);
+      currentYear.push_back(0);
+      totalMarks.push_back(0);
+      maxMarks.push_back(0);
+      percentage.push_back(0);
+      grade.push_back('F');
+      cnic.push_back(NO_CNIC);
+      birthDay.push_back(NO_BIRTH_DAY);
+      owner.push_back(nullptr);
+      listOrder.push_back(0);
+      marks.offset.push_back((uint32_t)marks.marks.size());
+      marks.count.push_back(0);
+      marksRoom.push_back(0);
+      captured.emplace_back(0);
+      cold.resize(cold.size() + COLD_FIELDS, ColdRef{0, 0});
+    }
+    owner[slot] = student;
+    captured[slot].store(captureGeneration, memory_order_relaxed);
+    classNumber[slot] = 0;
+    termsCompleted[slot] = 0;
+    boardMarksEntered[slot] = 0;
+    currentYear[slot] = 0;
+    totalMarks[slot] = 0;
+    maxMarks[slot] = 0;
+    percentage[slot] = 0;
+    grade[slot] = 'F';
+    cnic[slot] = NO_CNIC;
+    birthDay[slot] = NO_BIRTH_DAY;
+    marks.count[slot] = 0;
+    return slot;
+  }
+
+  // Add one scored subject to the end of a slot's marks
+  void appendMarks(uint32_t slot, float value, float maxValue) {
+    lock_guard<mutex> hold(marksLock);
+    uint32_t count = marks.count[slot];
+    reserveMarks(slot, count + 1);
+    marks.marks[marks.offset[slot] + count] = value;
+    marks.maxMarks[marks.offset[slot] + count] = maxValue;
+    marks.count[slot] = count + 1;
+  }
+
+  // Replace a slot's marks with `count` new ones, which fill(marks,
+  // maxMarks) writes
+  template <typename Fill>
+  void replaceMarks(uint32_t slot, uint32_t count, Fill &&fill) {
+    lock_guard<mutex> hold(marksLock);
+    marks.count[slot] = 0; // nothing worth keeping if the slot moves
+    reserveMarks(slot, count);
+    fill(marks.marks.data() + marks.offset[slot],
+         marks.maxMarks.data() + marks.offset[slot]);
+    marks.count[slot] = count;
+  }
+
+  void release(uint32_t slot) {
+    if (draining) {
+      owner[slot] = nullptr;
+      return;
+    }
+    // Cleared, or setCold would count them dead again when the slot is reused
+    for (int field = 0; field < COLD_FIELDS; field++) {
+      ColdRef &ref = cold[slot * COLD_FIELDS + field];
+      deadBytes += ref.length;
+      ref.offset = ref.length = 0;
+    }
+    owner[slot] = nullptr;
+    freeSlots.push_back(slot);
+  }
+
+  void setCold(uint32_t slot, ColdField field, const string &value) {
+    ColdRef &ref = cold[slot * COLD_FIELDS + field];
+    deadBytes += ref.length;
+    ref.offset = (uint32_t)arena.size();
+    ref.length = (uint32_t)value.size();
+    arena += value;
+  }
+
+  string getCold(uint32_t slot, ColdField field) const {
+    const ColdRef &ref = cold[slot * COLD_FIELDS + field];
+    return arena.substr(ref.offset, ref.length);
+  }
+
+  void setCnic(uint32_t slot, const string &text) {
+    uint64_t digits = 0;
+    bool canonical = text.size() == 15 && text[5] == '-' && text[13] == '-';
+    for (size_t i = 0; canonical && i < text.size(); i++) {
+      if (i == 5 || i == 13)
+        continue;
+      canonical = text[i] >= '0' && text[i] <= '9';
+      digits = digits * 10 + (text[i] - '0');
+    }
+    if (text.empty()) {
+      cnic[slot] = NO_CNIC;
+    } else if (canonical) {
+      cnic[slot] = digits + 1;
+    } else {
+      cnic[slot] = CNIC_VERBATIM;
+      setCold(slot, CNIC_B_FORM, text);
+    }
+  }
+
+  // Formatted here, only when displayed or exported
+  string getCnic(uint32_t slot) const {
+    uint64_t value = cnic[slot];
+    if (value == NO_CNIC)
+      return "";
+    if (value == CNIC_VERBATIM)
+      return getCold(slot, CNIC_B_FORM);
+    return formatCnic(value - 1);
+  }
+
+  // 13 digits as "12345-1234567-1"
+  static string formatCnic(uint64_t value) {
+    char text[15];
+    for (int i = 14; i >= 0; i--) {
+      if (i == 5 || i == 13) {
+        text[i] = '-';
+      } else {
+        text[i] = (char)('0' + value % 10);
+        value /= 10;
+      }
+    }
+    return string(text, sizeof(text));
+  }
+
+  // A CNIC's 13 digits as one integer, ignoring dashes and spaces; false
+  // unless exactly 13 digits remain
+  static bool normalizeCnic(string_view text, uint64_t &key) {
+    int digits = 0;
+    key = 0;
+    for (char c : text) {
+      if (c == '-' || c == ' ')
+        continue;
+      if (c < '0' || c > '9' || ++digits > 13)
+        return false;
+      key = key * 10 + (c - '0');
+    }
+    return digits == 13;
+  }
+
+  bool cnicKey(uint32_t slot, uint64_t &key) const {
+    uint64_t value = cnic[slot];
+    if (value == NO_CNIC)
+      return false;
+    if (value == CNIC_VERBATIM)
+      return normalizeCnic(getCold(slot, CNIC_B_FORM), key);
+    key = value - 1;
+    return true;
+  }
+
+  void setBirthDate(uint32_t slot, const string &text) {
+    int parts[3] = {0, 0, 0}; // DD-MM-YYYY
+    bool canonical = text.size() == 10 && text[2] == '-' && text[5] == '-';
+    for (size_t i = 0, part = 0; canonical && i < text.size(); i++) {
+      if (text[i] == '-' && (i == 2 || i == 5)) {
+        part++;
+        continue;
+      }
+      canonical = text[i] >= '0' && text[i] <= '9';
+      parts[part] = parts[part] * 10 + (text[i] - '0');
+    }
+    if (text.empty()) {
+      birthDay[slot] = NO_BIRTH_DAY;
+    } else if (canonical && Calendar::isValidDate(parts[2], parts[1],
+                                                  parts[0])) {
+      birthDay[slot] = Calendar::dayNumber(parts[2], parts[1], parts[0]);
+    } else {
+      birthDay[slot] = BIRTH_DAY_VERBATIM;
+      setCold(slot, DATE_OF_BIRTH, text);
+    }
+  }
+
+  string getBirthDate(uint32_t slot) const {
+    int32_t days = birthDay[slot];
+    if (days == NO_BIRTH_DAY)
+      return "";
+    if (days == BIRTH_DAY_VERBATIM)
+      return getCold(slot, DATE_OF_BIRTH);
+    int year, month, day;
+    Calendar::fromDayNumber(days, year, month, day);
+    char text[10];
+    Calendar::putDigits(text, day, 2);
+    text[2] = '-';
+    Calendar::putDigits(text + 3, month, 2);
+    text[5] = '-';
+    Calendar::putDigits(text + 6, year, 4);
+    return string(text, sizeof(text));
+  }
+
+  // The whole roster is about to go: skip per-slot bookkeeping and let the
+  // pools drop their slabs wholesale
+  void drain() {
+    draining = true;
+    studentBlocks.drain();
+    recordBlocks.drain();
+    yearBlocks.drain();
+  }
+
+  size_t columnBytes() const {
+    size_t perSlot = sizeof(uint8_t) * 3 + sizeof(int16_t) +
+                     sizeof(float) * 3 + sizeof(char) + sizeof(Student *) +
+                     sizeof(uint64_t) + sizeof(int32_t) +
+                     sizeof(ColdRef) * COLD_FIELDS;
+    return owner.capacity() * perSlot + freeSlots.capacity() * sizeof(uint32_t);
+  }
+  const string &internCategory(const string &category) {
+    auto found = categoryIds.find(category);
+    if (found != categoryIds.end())
+      return *found->second;
+    categories.push_back(category);
+    categoryIds.emplace(categories.back(), &categories.back());
+    return categories.back();
+  }
+
+  size_t arenaBytes() const { return arena.capacity(); }
+  size_t deadArenaBytes() const { return deadBytes; }
+
+  // Promotion rules, read from the hot columns only
+  bool canBePromoted(uint32_t slot) const {
+    // Must have 3 terms completed
+    if (termsCompleted[slot] < 3) {
+      return false;
+    }
+
+    // Must have board marks entered (for classes 8-12)
+    int classNum = classNumber[slot];
+    if (classNum >= 8 && classNum <= 12) {
+      if (!boardMarksEntered[slot]) {
+        return false;
+      }
+    }
+
+    // Must have percentage calculated
+    if (maxMarks[slot] == 0 || percentage[slot] == 0) {
+      return false;
+    }
+
+    return true;
+  }
+};
+
+const uint64_t StudentStore::NO_CNIC;
+const uint64_t StudentStore::CNIC_VERBATIM;
+const int32_t StudentStore::NO_BIRTH_DAY;
+const int32_t StudentStore::BIRTH_DAY_VERBATIM;
+
+// A student record. Identity, subjects and attendance live on the object;
+// the remaining fields live in the roster's StudentStore at `slot` and are
+// reached through the accessors below.
+// The part of a student's record that record writers change: subjects,
+// attendance, and a copy of the marks summary and terms kept in the store
+// columns. Readers load the student's current version once and read it
+// without a lock, so a version never changes while a reader can reach it.
+// A record writer changes a copy, which shares every attendance year but
+// the one it marks, and swaps it in; the old version is retired through
+// the epoch domain. Roster operations, which keep readers out, change the
+// current version in place.
+struct RecordVersion {
+  struct Summary {
+    float totalMarks = 0;
+    float maxMarks = 0;
+    float percentage = 0;
+    char grade = 'F';
+    bool boardMarks = false;
+    uint8_t termsCompleted = 0;
+  };
+
+  SubjectList subjects;
+  Calendar attendance;
+  Summary summary;
+
+  static void *operator new(size_t size, BlockPool *pool) {
+    return pool->allocate(size);
+  }
+  static void operator delete(void *block, BlockPool *) {
+    BlockPool::release(block);
+  }
+  static void operator delete(void *block) { BlockPool::release(block); }
+};
+
+class Student {
+private:
+  StudentStore *store;
+  uint32_t slot;
+  atomic<RecordVersion *> current;
+
+public:
+  string rollNo; // Changed to string
+  const string &classCategory;
+  int admissionYear;
+  Student *next;
+  Student *prev;
+  Student *classNext; // Neighbours within the same class and category
+  Student *classPrev;
+
+  Student(StudentStore *owner, string r, string n, string fn, string cn,
+          string cc, int ay, string dob, string cnic, string addr)
+      : classCategory(owner->internCategory(cc)) {
+    store = owner;
+    slot = store->allocate(this);
+    current.store(new (&store->recordBlocks) RecordVersion());
+    record().attendance.usePool(&store->yearBlocks);
+    rollNo = r;
+    admissionYear = ay;
+    next = nullptr;
+    prev = nullptr;
+    classNext = nullptr;
+    classPrev = nullptr;
+    setClassNumber(atoi(cn.c_str()));
+    setCurrentYear(ay);
+    store->setCold(slot, StudentStore::NAME, n);
+    store->setCold(slot, StudentStore::FATHER_NAME, fn);
+    store->setBirthDate(slot, dob);
+    store->setCnic(slot, cnic);
+    store->setCold(slot, StudentStore::ADDRESS, addr);
+  }
+
+  // Students live in their store's pool: new (&store) Student(&store, ...)
+  static void *operator new(size_t size, StudentStore *owner) {
+    return owner->studentBlocks.allocate(size);
+  }
+  static void operator delete(void *block, StudentStore *) {
+    BlockPool::release(block);
+  }
+  static void operator delete(void *block) { BlockPool::release(block); }
+
+  uint32_t getSlot() const { return slot; }
+
+  // The current version of the record. A reader loads it once per look at
+  // the student.
+  RecordVersion &record() const { return *current.load(memory_order_acquire); }
+
+  // A copy of the current version for a record writer to change. It
+  // shares the attendance bits of every year but `year` (0 for none).
+  RecordVersion *copyRecord(int year) const {
+    const RecordVersion &from = record();
+    RecordVersion *next = new (&store->recordBlocks) RecordVersion();
+    next->subjects.assign(from.subjects);
+    next->attendance.share(from.attendance);
+    next->attendance.unshare(year);
+    next->summary = from.summary;
+    return next;
+  }
+
+  // Make `next` the current version; returns the one it replaces
+  RecordVersion *publish(RecordVersion *next) {
+    return current.exchange(next, memory_order_acq_rel);
+  }
+
+  // Repeat the store's marks summary and terms in `version`, for readers
+  void copySummary(RecordVersion &version) const {
+    version.summary.totalMarks = store->totalMarks[slot];
+    version.summary.maxMarks = store->maxMarks[slot];
+    version.summary.percentage = store->percentage[slot];
+    version.summary.grade = store->grade[slot];
+    version.summary.boardMarks = store->boardMarksEntered[slot] != 0;
+    version.summary.termsCompleted = store->termsCompleted[slot];
+  }
+
+  // Hot fields
+  int getClassNumber() const { return store->classNumber[slot]; }
+  string getClassName() const { return to_string(getClassNumber()); }
+  void setClassNumber(int classNum) {
+    store->classNumber[slot] = (uint8_t)classNum;
+  }
+  int getCurrentYear() const { return store->currentYear[slot]; }
+  void setCurrentYear(int year) { store->currentYear[slot] = (int16_t)year; }
+  int getTermsCompleted() const { return store->termsCompleted[slot]; }
+  void setTermsCompleted(int terms) { setTermsCompleted(terms, record()); }
+  void setTermsCompleted(int terms, RecordVersion &version) {
+    store->termsCompleted[slot] = (uint8_t)terms;
+    version.summary.termsCompleted = (uint8_t)terms;
+  }
+  bool hasBoardMarks() const { return store->boardMarksEntered[slot] != 0; }
+  void setBoardMarksEntered(bool entered) {
+    setBoardMarksEntered(entered, record());
+  }
+  void setBoardMarksEntered(bool entered, RecordVersion &version) {
+    store->boardMarksEntered[slot] = entered ? 1 : 0;
+    version.summary.boardMarks = entered;
+  }
+  float getTotalMarks() const { return store->totalMarks[slot]; }
+  float getMaxMarks() const { return store->maxMarks[slot]; }
+  float getPercentage() const { return store->percentage[slot]; }
+  char getGrade() const { return store->grade[slot]; }
+
+  // Cold fields
+  string getName() const { return store->getCold(slot, StudentStore::NAME); }
+  string getFatherName() const {
+    return store->getCold(slot, StudentStore::FATHER_NAME);
+  }
+  string getDateOfBirth() const { return store->getBirthDate(slot); }
+  string getCnicBForm() const { return store->getCnic(slot); }
+  string getAddress() const {
+    return store->getCold(slot, StudentStore::ADDRESS);
+  }
+
+  int getMaxMarksForSubject(const Subject &subject) const {
+    return subjectCatalog.maxMarks(subject.id, getClassNumber());
+  }
+
+  // False if the subject catalog is full (SubjectCatalog::FULL); the
+  // subject is then not added
+  bool addSubject(string_view subjectName, string_view status) {
+    uint16_t id;
+    if (!subjectCatalog.intern(subjectName, id))
+      return false;
+    Subject newSubject(id);
+    if (!newSubject.setStatus(status))
+      return false;
+    record().subjects.push_back(newSubject);
+
+    float &totalMarks = store->totalMarks[slot];
+    float &maxMarks = store->maxMarks[slot];
+    if (newSubject.scored()) {
+      totalMarks += newSubject.marks();
+      int maxMarksForSub = getMaxMarksForSubject(newSubject);
+      maxMarks += maxMarksForSub;
+      store->appendMarks(slot, newSubject.marks(), (float)maxMarksForSub);
+    }
+
+    if (maxMarks > 0) {
+      store->percentage[slot] = (totalMarks / maxMarks) * 100.0;
+      store->grade[slot] = calculateGrade(store->percentage[slot]);
+    }
+    copySummary(record());
+    return true;
+  }
+
+  // Recompute totals from the marks currently stored on each subject, and
+  // store those marks in the marks columns
+  void recalculateMarks() { recalculateMarks(record()); }
+  void recalculateMarks(RecordVersion &version) {
+    const SubjectList &subjects = version.subjects;
+    float &totalMarks = store->totalMarks[slot];
+    float &maxMarks = store->maxMarks[slot];
+    totalMarks = 0;
+    maxMarks = 0;
+    uint32_t scored = 0;
+    for (const Subject &current : subjects) {
+      if (current.scored()) {
+        totalMarks += current.marks();
+        maxMarks += getMaxMarksForSubject(current);
+        scored++;
+      }
+    }
+    store->replaceMarks(slot, scored, [&](float *marks, float *maxMarks) {
+      for (const Subject &current : subjects) {
+        if (current.scored()) {
+          *marks++ = current.marks();
+          *maxMarks++ = (float)getMaxMarksForSubject(current);
+        }
+      }
+    });
+
+    if (maxMarks > 0) {
+      store->percentage[slot] = (totalMarks / maxMarks) * 100.0;
+      store->grade[slot] = calculateGrade(store->percentage[slot]);
+    }
+    copySummary(version);
+  }
+
+  static char calculateGrade(float perc) {
+    if (perc >= 90)
+      return 'A';
+    else if (perc >= 80)
+      return 'B';
+    else if (perc >= 70)
+      return 'C';
+    else if (perc >= 60)
+      return 'D';
+    else if (perc >= 50)
+      return 'E';
+    else
+      return 'F';
+  }
+
+  void clearSubjects() {
+    record().subjects.clear();
+    store->replaceMarks(slot, 0, [](float *, float *) {});
+    store->totalMarks[slot] = 0;
+    store->maxMarks[slot] = 0;
+    store->percentage[slot] = 0;
+    store->grade[slot] = 'F';
+    copySummary(record());
+  }
+
+  // Check if student can be promoted
+  bool canBePromoted() { return store->canBePromoted(slot); }
+
+  // Auto-promote to next class (only if eligible)
+  bool promoteToNextClass() {
+    if (!canBePromoted()) {
+      return false;
+    }
+
+    int classNum = getClassNumber();
+    if (classNum < 12) {
+      setClassNumber(classNum + 1);
+      setCurrentYear(getCurrentYear() + 1);
+      // Clear old marks for new year
+      clearSubjects();
+      setTermsCompleted(0);
+      setBoardMarksEntered(false);
+      return true;
+    }
+    return false;
+  }
+
+  ~Student() {
+    clearSubjects();
+    delete current.load();
+    store->release(slot);
+  }
+};
+
+// Open-addressing index from roll number to student. Each slot stores the
+// roll's hash inline so probes compare integers before touching the Student.
+// Lookups may run while another thread erases: slots are read atomically,
+// and an erased entry leaves a marker that probes run on past, instead of
+// the cluster shifting back under them. Insertions reuse markers and a
+// rehash drops them.
+class RollIndex {
+private:
+  struct Slot {
+    uint64_t hash = 0;
+    atomic<Student *> student{nullptr}; // nullptr marks an empty slot
+  };
+
+  vector<Slot> slots;
+  size_t count;
+  size_t erasedCount;
+  size_t mask;
+
+  // Left in the slot of an erased roll number; never dereferenced
+  static Student *erased() {
+    static char marker;
+    return reinterpret_cast<Student *>(&marker);
+  }
+
+public:
+  static uint64_t hashRoll(string_view rollNo) {
+    // FNV-1a followed by a final avalanche so sequential rolls spread out
+    uint64_t h = 14695981039346656037ULL;
+    for (unsigned char c : rollNo) {
+      h ^= c;
+      h *= 1099511628211ULL;
+    }
+    h ^= h >> 33;
+    h *= 0xff51afd7ed558ccdULL;
+    h ^= h >> 33;
+    return h;
+  }
+
+private:
+  void rehash(size_t newCapacity) {
+    vector<Slot> old;
+    old.swap(slots);
+    vector<Slot>(newCapacity).swap(slots);
+    mask = newCapacity - 1;
+    erasedCount = 0;
+    for (const Slot &slot : old) {
+      Student *student = slot.student.load(memory_order_relaxed);
+      if (student == nullptr || student == erased())
+        continue;
+      size_t i = slot.hash & mask;
+      while (slots[i].student.load(memory_order_relaxed) != nullptr)
+        i = (i + 1) & mask;
+      slots[i].hash = slot.hash;
+      slots[i].student.store(student, memory_order_relaxed);
+    }
+  }
+
+  // Returns the slot holding rollNo, or the empty slot that ends its probe
+  size_t probe(const string &rollNo, uint64_t h) const {
+    size_t i = h & mask;
+    while (true) {
+      Student *student = slots[i].student.load(memory_order_acquire);
+      if (student == nullptr ||
+          (student != erased() && slots[i].hash == h &&
+           student->rollNo == rollNo))
+        return i;
+      i = (i + 1) & mask;
+    }
+  }
+
+public:
+  RollIndex() : count(0), erasedCount(0), mask(0) { rehash(16); }
+
+  size_t size() const { return count; }
+
+  // Grow ahead of a bulk insert so loading does not rehash repeatedly
+  void reserve(size_t n) {
+    size_t needed = 16;
+    while (needed * 7 < n * 10)
+      needed <<= 1;
+    if (needed > slots.size())
+      rehash(needed);
+  }
+
+  Student *find(const string &rollNo) const {
+    uint64_t h = hashRoll(rollNo);
+    return slots[probe(rollNo, h)].student.load(memory_order_acquire);
+  }
+
+  // Returns false if the roll number is already indexed. Not safe against
+  // concurrent lookups, as it may rehash.
+  bool insert(Student *student) {
+    // Markers count towards the load. The rehash drops them, and only
+    // grows the table once live entries fill half of it.
+    if ((count + erasedCount + 1) * 10 > slots.size() * 7)
+      rehash((count + 1) * 2 > slots.size() ? slots.size() * 2
+                                            : slots.size());
+    uint64_t h = hashRoll(student->rollNo);
+    size_t i = probe(student->rollNo, h);
+    if (slots[i].student.load(memory_order_relaxed) != nullptr)
+      return false;
+    // The first marker on the probe path takes the entry, if there is one
+    size_t target = h & mask;
+    while (target != i &&
+           slots[target].student.load(memory_order_relaxed) != erased())
+      target = (target + 1) & mask;
+    if (target != i)
+      erasedCount--;
+    slots[target].hash = h;
+    slots[target].student.store(student, memory_order_release);
+    count++;
+    return true;
+  }
+
+  bool erase(const string &rollNo) {
+    uint64_t h = hashRoll(rollNo);
+    size_t i = probe(rollNo, h);
+    if (slots[i].student.load(memory_order_relaxed) == nullptr)
+      return false;
+    slots[i].student.store(erased(), memory_order_release);
+    count--;
+    erasedCount++;
+    return true;
+  }
+
+  void clear() {
+    count = 0;
+    rehash(16);
+  }
+};
+
+// The roll number index split into SHARDS tables, a roll's shard picked by
+// the top bits of its hash. Besides its table each shard carries the lock
+// that record writers hold while they change the table or one of the
+// shard's students, so writers only contend within a shard. Readers take
+// no lock (see RollIndex and RecordVersion). Insertions only happen in
+// roster operations, so a table never moves while record operations probe
+// it.
+class RollShards {
+public:
+  static const int SHARD_BITS = 6;
+  static const size_t SHARDS = (size_t)1 << SHARD_BITS;
+
+  struct alignas(64) Shard {
+    mutex lock;
+    RollIndex index;
+  };
+
+  Shard &shardOf(const string &rollNo) {
+    return shards[RollIndex::hashRoll(rollNo) >> (64 - SHARD_BITS)];
+  }
+
+  // Whole-index operations, for roster operations only
+  size_t size() const {
+    size_t total = 0;
+    for (const Shard &shard : shards)
+      total += shard.index.size();
+    return total;
+  }
+
+  void reserve(size_t n) {
+    for (Shard &shard : shards)
+      shard.index.reserve(n / SHARDS + n / SHARDS / 4 + 16);
+  }
+
+  Student *find(const string &rollNo) {
+    return shardOf(rollNo).index.find(rollNo);
+  }
+  bool insert(Student *student) {
+    return shardOf(student->rollNo).index.insert(student);
+  }
+  bool erase(const string &rollNo) {
+    return shardOf(rollNo).index.erase(rollNo);
+  }
+
+  void clear() {
+    for (Shard &shard : shards)
+      shard.index.clear();
+  }
+
+private:
+  Shard shards[SHARDS];
+};
+
+// Lets record operations (lookups, marks, attendance, deletes) run on many
+// threads at once while roster operations still get the roster to
+// themselves. A thread inside a Section publishes the epoch it entered in
+// its own cache line, so entering and leaving writes no shared memory. An
+// object a writer has unlinked or replaced (a student, a record version) is
+// retired and destroyed only once every section that might still see it
+// has ended. An Exclusive guard closes the
+// gate to new sections, waits for the open ones to end and frees whatever
+// is still retired. A thread must not take an Exclusive guard from inside
+// a Section; sections opened under its own Exclusive guard are no-ops.
+class EpochDomain {
+public:
+  static const int MAX_THREADS = 128;
+  static const size_t RECLAIM_BATCH = 64;
+
+  class Section {
+  public:
+    explicit Section(EpochDomain &owner) : domain(owner) { domain.enter(); }
+    ~Section() { domain.leave(); }
+    Section(const Section &) = delete;
+    Section &operator=(const Section &) = delete;
+
+  private:
+    EpochDomain &domain;
+  };
+
+  class Exclusive {
+  public:
+    explicit Exclusive(EpochDomain &owner) : domain(owner) { domain.close(); }
+    ~Exclusive() { domain.open(); }
+    Exclusive(const Exclusive &) = delete;
+    Exclusive &operator=(const Exclusive &) = delete;
+
+  private:
+    EpochDomain &domain;
+  };
+
+  EpochDomain() : epoch(1), closed(false), reclaimAt(RECLAIM_BATCH) {
+    for (Record &record : records) {
+      record.epoch.store(0);
+      record.depth = 0;
+      record.exclusive = 0;
+    }
+  }
+  EpochDomain(const EpochDomain &) = delete;
+  EpochDomain &operator=(const EpochDomain &) = delete;
+
+  ~EpochDomain() { reclaimBefore(UINT64_MAX); }
+
+  // True if the calling thread holds an Exclusive guard
+  bool exclusive() { return records[threadIndex()].exclusive > 0; }
+
+  // Run `destroy` once no section that could have seen the object is open.
+  // Record writers retire a version per change, so the open sections are
+  // only checked once RECLAIM_BATCH more objects wait than after the last
+  // check.
+  void retire(function<void()> destroy) {
+    lock_guard<mutex> hold(retireLock);
+    retired.push_back({epoch.fetch_add(1), std::move(destroy)});
+    if (retired.size() < reclaimAt)
+      return;
+    uint64_t oldest = UINT64_MAX;
+    for (const Record &record : records) {
+      uint64_t entered = record.epoch.load();
+      if (entered != 0)
+        oldest = min(oldest, entered);
+    }
+    reclaimBefore(oldest);
+    reclaimAt = retired.size() + RECLAIM_BATCH;
+  }
+
+private:
+  struct alignas(64) Record {
+    atomic<uint64_t> epoch; // Epoch the owning thread entered; 0 outside
+    int depth;              // Sections the owning thread has open
+    int exclusive;          // Exclusive guards the owning thread holds
+  };
+
+  Record records[MAX_THREADS];
+  atomic<uint64_t> epoch;
+  atomic<bool> closed;
+  recursive_mutex gate; // Held by the thread with exclusive access
+  mutex retireLock;
+  vector<pair<uint64_t, function<void()>>> retired; // In epoch order
+  size_t reclaimAt; // retired.size() that triggers the next check
+
+  // The calling thread's record index, claimed on first use and given back
+  // when the thread exits
+  static int threadIndex() {
+    static atomic<bool> claimed[MAX_THREADS];
+    struct Claim {
+      int index = -1;
+      ~Claim() {
+        if (index >= 0)
+          claimed[index].store(false);
+      }
+    };
+    thread_local Claim claim;
+    while (claim.index < 0) {
+      for (int i = 0; i < MAX_THREADS && claim.index < 0; i++) {
+        bool expected = false;
+        if (claimed[i].compare_exchange_strong(expected, true))
+          claim.index = i;
+      }
+      if (claim.index < 0)
+        this_thread::yield(); // Every record is taken; wait for a thread
+    }
+    return claim.index;
+  }
+
+  void enter() {
+    Record &record = records[threadIndex()];
+    if (record.depth++ > 0 || record.exclusive > 0)
+      return;
+    while (true) {
+      record.epoch.store(epoch.load());
+      if (!closed.load())
+        return;
+      record.epoch.store(0);
+      while (closed.load())
+        this_thread::yield();
+    }
+  }
+
+  void leave() {
+    Record &record = records[threadIndex()];
+    if (--record.depth > 0 || record.exclusive > 0)
+      return;
+    record.epoch.store(0, memory_order_release);
+  }
+
+  void close() {
+    gate.lock();
+    Record &record = records[threadIndex()];
+    if (record.exclusive++ > 0)
+      return;
+    closed.store(true);
+    for (const Record &other : records) {
+      while (other.epoch.load() != 0)
+        this_thread::yield();
+    }
+    lock_guard<mutex> hold(retireLock);
+    reclaimBefore(UINT64_MAX);
+    reclaimAt = RECLAIM_BATCH;
+  }
+
+  void open() {
+    Record &record = records[threadIndex()];
+    if (--record.exclusive == 0)
+      closed.store(false);
+    gate.unlock();
+  }
+
+  // Destroy what was retired before `limit`; the caller holds retireLock
+  void reclaimBefore(uint64_t limit) {
+    size_t done = 0;
+    while (done < retired.size() && retired[done].first < limit)
+      retired[done++].second();
+    retired.erase(retired.begin(), retired.begin() + done);
+  }
+};
+
+// Open-addressing index from normalized CNIC to the students holding it.
+// New enrolments are refused a CNIC that is already held, but rows from
+// snapshots, the journal and text files are kept even when they share one;
+// those extra holders hang off the first in a chain linked by student slot,
+// so every collision group can be listed in one pass over the table.
+class CnicIndex {
+private:
+  struct Slot {
+    uint64_t key;
+    Student *first; // nullptr marks an empty slot
+    uint32_t holders;
+  };
+
+  vector<Slot> slots;
+  size_t count;
+  size_t mask;
+  vector<Student *> next; // By student slot: the next holder of the CNIC
+  vector<Student *> prev;
+  size_t groups; // Keys held by more than one student
+
+  static uint64_t mix(uint64_t key) {
+    key ^= key >> 33;
+    key *= 0xff51afd7ed558ccdULL;
+    key ^= key >> 33;
+    return key;
+  }
+
+  void rehash(size_t newCapacity) {
+    vector<Slot> old;
+    old.swap(slots);
+    slots.assign(newCapacity, Slot{0, nullptr, 0});
+    mask = newCapacity - 1;
+    for (const Slot &slot : old) {
+      if (slot.first == nullptr)
+        continue;
+      size_t i = mix(slot.key) & mask;
+      while (slots[i].first != nullptr)
+        i = (i + 1) & mask;
+      slots[i] = slot;
+    }
+  }
+
+  size_t probe(uint64_t key) const {
+    size_t i = mix(key) & mask;
+    while (slots[i].first != nullptr && slots[i].key != key)
+      i = (i + 1) & mask;
+    return i;
+  }
+
+  Student *&link(vector<Student *> &chain, Student *student) {
+    uint32_t slot = student->getSlot();
+    if (slot >= chain.size())
+      chain.resize(max<size_t>(slot + 1, chain.size() * 2), nullptr);
+    return chain[slot];
+  }
+
+  // Backward-shift deletion: pull later entries of the cluster into the
+  // hole whenever the hole lies between their home slot and their position
+  void eraseSlot(size_t hole) {
+    size_t i = hole;
+    while (true) {
+      i = (i + 1) & mask;
+      if (slots[i].first == nullptr)
+        break;
+      size_t home = mix(slots[i].key) & mask;
+      if (((i - home) & mask) >= ((i - hole) & mask)) {
+        slots[hole] = slots[i];
+        hole = i;
+      }
+    }
+    slots[hole].first = nullptr;
+    count--;
+  }
+
+public:
+  CnicIndex() : count(0), mask(0), groups(0) { rehash(16); }
+
+  // First student enrolled with the CNIC, or nullptr
+  Student *find(uint64_t key) const { return slots[probe(key)].first; }
+
+  size_t duplicateGroups() const { return groups; }
+
+  void add(Student *student, uint64_t key) {
+    if ((count + 1) * 10 > slots.size() * 7)
+      rehash(slots.size() * 2);
+    size_t i = probe(key);
+    link(prev, student) = nullptr;
+    if (slots[i].first == nullptr) {
+      slots[i] = Slot{key, student, 1};
+      link(next, student) = nullptr;
+      count++;
+      return;
+    }
+    // Later holders go straight after the first, so adding stays O(1)
+    Student *first = slots[i].first;
+    Student *second = link(next, first);
+    link(next, student) = second;
+    link(prev, student) = first;
+    if (second != nullptr)
+      link(prev, second) = student;
+    link(next, first) = student;
+    if (++slots[i].holders == 2)
+      groups++;
+  }
+
+  void remove(Student *student, uint64_t key) {
+    size_t i = probe(key);
+    if (slots[i].first == nullptr)
+      return;
+    Student *before = link(prev, student);
+    Student *after = link(next, student);
+    if (before == nullptr && slots[i].first != student)
+      return; // Not indexed under this key
+    if (before != nullptr)
+      link(next, before) = after;
+    else
+      slots[i].first = after;
+    if (after != nullptr)
+      link(prev, after) = before;
+    if (--slots[i].holders == 1)
+      groups--;
+    if (slots[i].first == nullptr)
+      eraseSlot(i);
+  }
+
+  // Visit every CNIC held by more than one student with all its holders
+  void forEachGroup(
+      const function<void(uint64_t, const vector<Student *> &)> &visit) {
+    vector<Student *> holders;
+    for (const Slot &slot : slots) {
+      if (slot.first == nullptr || slot.holders < 2)
+        continue;
+      holders.clear();
+      for (Student *s = slot.first; s != nullptr; s = link(next, s))
+        holders.push_back(s);
+      visit(slot.key, holders);
+    }
+  }
+};
+
+// Worker threads to use instead of one per core, 0 for one per core; set
+// by the import benchmark's thread sweep
+static atomic<size_t> workerOverride(0);
+
+// Number of worker threads used for parallel bulk operations
+static size_t workerCount() {
+  size_t workers = workerOverride;
+  if (workers != 0)
+    return workers;
+  unsigned int cores = thread::hardware_concurrency();
+  return cores == 0 ? 1 : cores;
+}
+
+// Run task(0) .. task(count - 1) across the worker threads. Each worker
+// claims the next unstarted index, so uneven tasks still balance out.
+static void parallelFor(size_t count, const function<void(size_t)> &task) {
+  size_t workers = min(count, workerCount());
+  if (workers <= 1) {
+    for (size_t i = 0; i < count; i++)
+      task(i);
+    return;
+  }
+  atomic<size_t> nextIndex(0);
+  auto worker = [&]() {
+    for (size_t i = nextIndex++; i < count; i = nextIndex++)
+      task(i);
+  };
+  vector<thread> threads;
+  for (size_t t = 1; t < workers; t++)
+    threads.emplace_back(worker);
+  worker();
+  for (thread &t : threads)
+    t.join();
+}
+
+// Case-insensitive text index over student and father names, by store
+// slot. Each field is keyed by its trigrams plus the first one and two
+// letters of every word; a key maps to a posting list of slots. A query
+// intersects the postings of its keys, smallest first, and then checks the
+// few surviving candidates against the stored text to rank them. A one- or
+// two-letter query can match most of the roster, so the best matches of
+// each such query are kept once asked for and updated as students come
+// and go. A bulk load defers the postings of the students it adds and
+// builds them in one pass at the end (see Bulk).
+class NameIndex {
+public:
+  enum Field { NAME, FATHER_NAME, FIELDS };
+
+  struct Match {
+    uint32_t slot;
+    int rank; // 0 exact, 1 prefix, 2 word prefix, 3 substring; +4 on father
+  };
+
+private:
+  enum KeyKind { TRIGRAM, WORD_START_1, WORD_START_2 };
+
+  struct Posting {
+    vector<uint32_t> slots;
+    bool sorted; // Appends can arrive out of order; sorted before use
+
+    Posting() : sorted(true) {}
+  };
+
+  // Leading matches of a short query, by its word start key
+  struct Head {
+    vector<Match> best; // The first HEAD_SIZE matches in search order
+    size_t total;       // Students matching in either field
+  };
+  static const size_t HEAD_SIZE = 64;
+
+  // Below this many deferred slots, buildDeferred adds them one by one
+  static const size_t BULK_MIN = 4096;
+  // Slots whose (key, slot) pairs are sorted together by buildDeferred
+  static const size_t BULK_BLOCK = 1 << 16;
+  static const int KEY_BITS = 26; // KeyKind plus three bytes
+
+  unordered_map<uint32_t, Posting> postings[FIELDS];
+  vector<string> text[FIELDS]; // Lowercased field per slot
+  vector<uint8_t> indexed;
+  unordered_map<uint32_t, Head> heads;
+  int bulkDepth = 0;
+  vector<uint32_t> deferred; // Added while a Bulk is alive, not yet posted
+
+  static uint32_t makeKey(KeyKind kind, char a, char b, char c) {
+    return (uint32_t)kind << 24 | (uint32_t)(unsigned char)a << 16 |
+           (uint32_t)(unsigned char)b << 8 | (unsigned char)c;
+  }
+
+  static string normalize(const string &value) {
+    string lower;
+    lower.reserve(value.size());
+    for (char c : value) {
+      if (c == ' ' && (lower.empty() || lower.back() == ' '))
+        continue; // Collapse runs of spaces
+      lower += (char)tolower((unsigned char)c);
+    }
+    if (!lower.empty() && lower.back() == ' ')
+      lower.pop_back();
+    return lower;
+  }
+
+  static bool isWordStart(const string &value, size_t i) {
+    return value[i] != ' ' && (i == 0 || value[i - 1] == ' ');
+  }
+
+  // Every key of a normalized field, repeats included
+  template <typename Visit>
+  static void forEachKey(const string &value, Visit &&visit) {
+    for (size_t i = 0; i + 3 <= value.size(); i++)
+      visit(makeKey(TRIGRAM, value[i], value[i + 1], value[i + 2]));
+    for (size_t i = 0; i < value.size(); i++) {
+      if (!isWordStart(value, i))
+        continue;
+      visit(makeKey(WORD_START_1, value[i], 0, 0));
+      if (i + 1 < value.size() && value[i + 1] != ' ')
+        visit(makeKey(WORD_START_2, value[i], value[i + 1], 0));
+    }
+  }
+
+  static void keysOf(const string &value, vector<uint32_t> &keys) {
+    keys.clear();
+    forEachKey(value, [&keys](uint32_t key) { keys.push_back(key); });
+    sort(keys.begin(), keys.end());
+    keys.erase(unique(keys.begin(), keys.end()), keys.end());
+  }
+
+  static void ensureSorted(Posting &posting) {
+    if (!posting.sorted) {
+      sort(posting.slots.begin(), posting.slots.end());
+      posting.sorted = true;
+    }
+  }
+
+  // Keep the entries of `result` that also appear in `other`. Similar sizes
+  // merge linearly; a much longer `other` is searched with lower_bound.
+  static void intersect(vector<uint32_t> &result,
+                        const vector<uint32_t> &other) {
+    size_t kept = 0;
+    if (other.size() > result.size() * 16) {
+      auto from = other.begin();
+      for (uint32_t slot : result) {
+        from = lower_bound(from, other.end(), slot);
+        if (from == other.end())
+          break;
+        if (*from == slot)
+          result[kept++] = slot;
+      }
+    } else {
+      size_t j = 0;
+      for (uint32_t slot : result) {
+        while (j < other.size() && other[j] < slot)
+          j++;
+        if (j < other.size() && other[j] == slot)
+          result[kept++] = slot;
+      }
+    }
+    result.resize(kept);
+  }
+
+  // Rank of `query` within one stored field, or -1 when it does not occur
+  static int rankIn(const string &value, const string &query) {
+    if (value == query)
+      return 0;
+    int best = -1;
+    for (size_t pos = value.find(query); pos != string::npos;
+         pos = value.find(query, pos + 1)) {
+      int rank = pos == 0 ? 1 : value[pos - 1] == ' ' ? 2 : 3;
+      if (best < 0 || rank < best)
+        best = rank;
+    }
+    return best;
+  }
+
+  // Search order: rank, then name
+  bool better(const Match &a, const Match &b) const {
+    if (a.rank != b.rank)
+      return a.rank < b.rank;
+    int order = text[NAME][a.slot].compare(text[NAME][b.slot]);
+    return order != 0 ? order < 0 : a.slot < b.slot;
+  }
+
+  static uint32_t shortKey(const string &query) {
+    return query.size() == 1 ? makeKey(WORD_START_1, query[0], 0, 0)
+                             : makeKey(WORD_START_2, query[0], query[1], 0);
+  }
+
+  // The short query a word start key stands for
+  static string shortQuery(uint32_t key) {
+    string query(1, (char)(key >> 16));
+    if ((KeyKind)(key >> 24) == WORD_START_2)
+      query += (char)(key >> 8);
+    return query;
+  }
+
+  // How an indexed slot matches a short query, or -1. The query's key is
+  // a word start, so a field holding it ranks 0-2.
+  Match shortMatch(uint32_t slot, const string &query) const {
+    for (int field = 0; field < FIELDS; field++) {
+      int rank = rankIn(text[field][slot], query);
+      if (rank >= 0 && rank < 3)
+        return Match{slot, rank + field * 4};
+    }
+    return Match{slot, -1};
+  }
+
+  Head &headOf(const string &query) {
+    uint32_t key = shortKey(query);
+    auto it = heads.find(key);
+    if (it != heads.end())
+      return it->second;
+
+    // Walk both fields' postings in slot order, each student once
+    vector<uint32_t> none;
+    const vector<uint32_t> *lists[FIELDS];
+    for (int field = 0; field < FIELDS; field++) {
+      auto found = postings[field].find(key);
+      lists[field] = &none;
+      if (found != postings[field].end()) {
+        ensureSorted(found->second);
+        lists[field] = &found->second.slots;
+      }
+    }
+    const vector<uint32_t> &byName = *lists[NAME];
+    const vector<uint32_t> &byFather = *lists[FATHER_NAME];
+    Head head;
+    head.total = 0;
+    auto worse = [this](const Match &a, const Match &b) {
+      return better(a, b);
+    };
+    size_t i = 0;
+    size_t j = 0;
+    while (i < byName.size() || j < byFather.size()) {
+      uint32_t slot;
+      if (j == byFather.size() ||
+          (i < byName.size() && byName[i] < byFather[j])) {
+        slot = byName[i++];
+      } else if (i == byName.size() || byFather[j] < byName[i]) {
+        slot = byFather[j++];
+      } else {
+        slot = byName[i++];
+        j++;
+      }
+      head.total++;
+      Match match = shortMatch(slot, query);
+      if (head.best.size() < HEAD_SIZE) {
+        head.best.push_back(match);
+        push_heap(head.best.begin(), head.best.end(), worse);
+      } else if (better(match, head.best.front())) {
+        pop_heap(head.best.begin(), head.best.end(), worse);
+        head.best.back() = match;
+        push_heap(head.best.begin(), head.best.end(), worse);
+      }
+    }
+    sort_heap(head.best.begin(), head.best.end(), worse);
+    return heads.emplace(key, std::move(head)).first->second;
+  }
+
+  // The word start keys of a slot's fields with a kept head
+  void headKeysOf(uint32_t slot, vector<uint32_t> &found) {
+    found.clear();
+    if (heads.empty())
+      return;
+    vector<uint32_t> keys;
+    for (int field = 0; field < FIELDS; field++) {
+      keysOf(text[field][slot], keys);
+      for (uint32_t key : keys) {
+        if ((KeyKind)(key >> 24) != TRIGRAM && heads.count(key) != 0)
+          found.push_back(key);
+      }
+    }
+    sort(found.begin(), found.end());
+    found.erase(unique(found.begin(), found.end()), found.end());
+  }
+
+  // Slots whose field holds every key of `query`, sorted
+  vector<uint32_t> candidates(Field field, const string &query) {
+    vector<uint32_t> keys;
+    if (query.size() >= 3) {
+      // Non-overlapping trigrams (plus the last one) already cover the
+      // query; overlapping ones mostly repeat the same students
+      for (size_t i = 0; i + 3 <= query.size(); i += 3)
+        keys.push_back(
+            makeKey(TRIGRAM, query[i], query[i + 1], query[i + 2]));
+      size_t last = query.size() - 3;
+      keys.push_back(
+          makeKey(TRIGRAM, query[last], query[last + 1], query[last + 2]));
+    } else if (query.size() == 2) {
+      keys.push_back(makeKey(WORD_START_2, query[0], query[1], 0));
+    } else {
+      keys.push_back(makeKey(WORD_START_1, query[0], 0, 0));
+    }
+    sort(keys.begin(), keys.end());
+    keys.erase(unique(keys.begin(), keys.end()), keys.end());
+
+    vector<Posting *> lists;
+    for (uint32_t key : keys) {
+      auto it = postings[field].find(key);
+      if (it == postings[field].end())
+        return {};
+      ensureSorted(it->second);
+      lists.push_back(&it->second);
+    }
+    sort(lists.begin(), lists.end(), [](Posting *a, Posting *b) {
+      return a->slots.size() < b->slots.size();
+    });
+    vector<uint32_t> result = lists[0]->slots;
+    for (size_t i = 1; i < lists.size() && !result.empty(); i++)
+      intersect(result, lists[i]->slots);
+    return result;
+  }
+
+  // Post one slot whose text is stored, keeping the heads up to date
+  void post(uint32_t slot) {
+    vector<uint32_t> keys;
+    for (int field = 0; field < FIELDS; field++) {
+      keysOf(text[field][slot], keys);
+      for (uint32_t key : keys) {
+        Posting &posting = postings[field][key];
+        if (!posting.slots.empty() && posting.slots.back() > slot)
+          posting.sorted = false;
+        posting.slots.push_back(slot);
+      }
+    }
+
+    headKeysOf(slot, keys);
+    for (uint32_t key : keys) {
+      Head &head = heads[key];
+      head.total++;
+      Match match = shortMatch(slot, shortQuery(key));
+      auto at = upper_bound(head.best.begin(), head.best.end(), match,
+                            [this](const Match &a, const Match &b) {
+                              return better(a, b);
+                            });
+      if (at - head.best.begin() < (ptrdiff_t)HEAD_SIZE) {
+        head.best.insert(at, match);
+        if (head.best.size() > HEAD_SIZE)
+          head.best.pop_back();
+      }
+    }
+  }
+
+  // Post the deferred slots. Many at once are posted a block of slots at a
+  // time: the block's (key, slot) pairs are radix sorted by key, so each
+  // posting takes one map lookup and one run of appends per block rather
+  // than a lookup per slot. The two fields are built in parallel. The kept
+  // heads are dropped and found again when asked for.
+  void buildDeferred() {
+    if (deferred.size() < BULK_MIN) {
+      for (uint32_t slot : deferred)
+        post(slot);
+      deferred.clear();
+      return;
+    }
+    heads.clear();
+    if (!is_sorted(deferred.begin(), deferred.end()))
+      sort(deferred.begin(), deferred.end());
+
+    const int DIGIT_BITS = KEY_BITS / 2;
+    const size_t RADIX = (size_t)1 << DIGIT_BITS;
+    parallelFor(FIELDS, [&](size_t field) {
+      vector<uint64_t> pairs; // key << 32 | slot
+      vector<uint64_t> scratch;
+      vector<size_t> counts(RADIX);
+      for (size_t first = 0; first < deferred.size(); first += BULK_BLOCK) {
+        size_t last = min(first + BULK_BLOCK, deferred.size());
+        pairs.clear();
+        for (size_t i = first; i < last; i++) {
+          uint64_t slot = deferred[i];
+          forEachKey(text[field][slot], [&pairs, slot](uint32_t key) {
+            pairs.push_back((uint64_t)key << 32 | slot);
+          });
+        }
+        // Stable counting passes over the key bits keep each key's slots
+        // in ascending order, with a slot's repeated keys side by side
+        scratch.resize(pairs.size());
+        for (int shift = 32; shift < 32 + KEY_BITS; shift += DIGIT_BITS) {
+          fill(counts.begin(), counts.end(), 0);
+          for (uint64_t pair : pairs)
+            counts[pair >> shift & (RADIX - 1)]++;
+          size_t offset = 0;
+          for (size_t &count : counts) {
+            size_t here = count;
+            count = offset;
+            offset += here;
+          }
+          for (uint64_t pair : pairs)
+            scratch[counts[pair >> shift & (RADIX - 1)]++] = pair;
+          pairs.swap(scratch);
+        }
+        for (size_t i = 0; i < pairs.size();) {
+          uint32_t key = (uint32_t)(pairs[i] >> 32);
+          size_t end = i;
+          while (end < pairs.size() && (uint32_t)(pairs[end] >> 32) == key)
+            end++;
+          Posting &posting = postings[field][key];
+          if (!posting.slots.empty() &&
+              posting.slots.back() > (uint32_t)pairs[i])
+            posting.sorted = false;
+          for (; i < end; i++) {
+            if (i == 0 || pairs[i] != pairs[i - 1])
+              posting.slots.push_back((uint32_t)pairs[i]);
+          }
+        }
+      }
+    });
+    deferred.clear();
+  }
+
+public:
+  // While one is alive, add() only stores the fields; the postings of every
+  // slot added meanwhile are built when the outermost one ends
+  class Bulk {
+  private:
+    NameIndex &index;
+
+  public:
+    explicit Bulk(NameIndex &owner) : index(owner) { index.bulkDepth++; }
+    Bulk(const Bulk &) = delete;
+    Bulk &operator=(const Bulk &) = delete;
+    ~Bulk() {
+      if (--index.bulkDepth == 0)
+        index.buildDeferred();
+    }
+  };
+
+  void add(uint32_t slot, const string &name, const string &fatherName) {
+    if (slot >= indexed.size()) {
+      indexed.resize(slot + 1, 0);
+      for (int field = 0; field < FIELDS; field++)
+        text[field].resize(slot + 1);
+    }
+    text[NAME][slot] = normalize(name);
+    text[FATHER_NAME][slot] = normalize(fatherName);
+    indexed[slot] = 1;
+    if (bulkDepth > 0)
+      deferred.push_back(slot);
+    else
+      post(slot);
+  }
+
+  void remove(uint32_t slot) {
+    if (slot >= indexed.size() || !indexed[slot])
+      return;
+    if (!deferred.empty())
+      buildDeferred(); // Its postings have to exist to be taken out
+    vector<uint32_t> keys;
+    headKeysOf(slot, keys);
+    for (uint32_t key : keys) {
+      Head &head = heads[key];
+      auto at = find_if(head.best.begin(), head.best.end(),
+                        [slot](const Match &m) { return m.slot == slot; });
+      if (at != head.best.end())
+        heads.erase(key); // The next best is not kept; found again if asked
+      else
+        head.total--;
+    }
+    for (int field = 0; field < FIELDS; field++) {
+      keysOf(text[field][slot], keys);
+      for (uint32_t key : keys) {
+        auto it = postings[field].find(key);
+        Posting &posting = it->second;
+        ensureSorted(posting);
+        posting.slots.erase(lower_bound(posting.slots.begin(),
+                                        posting.slots.end(), slot));
+        if (posting.slots.empty())
+          postings[field].erase(it);
+      }
+      string().swap(text[field][slot]);
+    }
+    indexed[slot] = 0;
+  }
+
+  // Students whose name or father's name contains `query`, best first: by
+  // rank, then name. Queries shorter than three letters match word starts
+  // only. Fills at most `limit` matches and returns the total match count.
+  size_t search(const string &rawQuery, size_t limit, vector<Match> &matches) {
+    matches.clear();
+    if (!deferred.empty())
+      buildDeferred();
+    string query = normalize(rawQuery);
+    if (query.empty() || (query.size() < 3 && query.find(' ') != string::npos))
+      return 0;
+    if (query.size() < 3 && limit <= HEAD_SIZE) {
+      Head &head = headOf(query);
+      matches.assign(head.best.begin(),
+                     head.best.begin() + min(limit, head.best.size()));
+      return head.total;
+    }
+
+    // Each field's candidates come back sorted by slot, so the two are
+    // merged keeping the better rank of a student found in both
+    vector<Match> found[FIELDS];
+    for (int field = 0; field < FIELDS; field++) {
+      for (uint32_t slot : candidates((Field)field, query)) {
+        int rank = rankIn(text[field][slot], query);
+        if (query.size() < 3 && rank == 3)
+          rank = -1; // Short keys only promise a word start
+        if (rank >= 0)
+          found[field].push_back(Match{slot, rank + field * 4});
+      }
+    }
+    size_t i = 0;
+    size_t j = 0;
+    const vector<Match> &byName = found[NAME];
+    const vector<Match> &byFather = found[FATHER_NAME];
+    while (i < byName.size() || j < byFather.size()) {
+      if (j == byFather.size() ||
+          (i < byName.size() && byName[i].slot < byFather[j].slot)) {
+        matches.push_back(byName[i++]);
+      } else if (i == byName.size() || byFather[j].slot < byName[i].slot) {
+        matches.push_back(byFather[j++]);
+      } else {
+        matches.push_back(byName[i++]); // Name ranks always win
+        j++;
+      }
+    }
+
+    size_t total = matches.size();
+    size_t kept = min(limit, total);
+    partial_sort(matches.begin(), matches.begin() + kept, matches.end(),
+                 [this](const Match &a, const Match &b) {
+                   return better(a, b);
+                 });
+    matches.resize(kept);
+    return total;
+  }
+};
+
+// Merit order of every class: one treap per class, ordered by percentage
+// (highest first) and then roll number, with subtree sizes so rank, top-K
+// and percentage-range queries take O(log n) plus the size of the answer.
+// Nodes live in an array indexed by store slot, so a student's node is
+// found without a search when its percentage or class changes.
+class MeritIndex {
+public:
+  static const int CLASSES = 12;
+
+private:
+  struct Node {
+    Student *student; // nullptr when the slot is not indexed
+    float percentage; // Key the node is filed under
+    int classNum;
+    int left;
+    int right;
+    uint32_t priority;
+    uint32_t size;
+  };
+
+  vector<Node> nodes;
+  int roots[CLASSES + 1]; // Indexed by class number; -1 for an empty tree
+  bool active;
+
+  uint32_t sizeOf(int t) const { return t < 0 ? 0 : nodes[t].size; }
+
+  void update(int t) {
+    nodes[t].size = 1 + sizeOf(nodes[t].left) + sizeOf(nodes[t].right);
+  }
+
+  // Merit order: higher percentage first, then lower roll number
+  bool before(float percentage, const string &rollNo, int t) const {
+    if (percentage != nodes[t].percentage)
+      return percentage > nodes[t].percentage;
+    return rollNo < nodes[t].student->rollNo;
+  }
+
+  // Split t into the nodes before `key` (left) and the rest (right)
+  void split(int t, float percentage, const string &rollNo, int &left,
+             int &right) {
+    if (t < 0) {
+      left = right = -1;
+    } else if (before(percentage, rollNo, t)) {
+      split(nodes[t].left, percentage, rollNo, left, nodes[t].left);
+      right = t;
+      update(t);
+    } else {
+      split(nodes[t].right, percentage, rollNo, nodes[t].right, right);
+      left = t;
+      update(t);
+    }
+  }
+
+  int merge(int left, int right) {
+    if (left < 0)
+      return right;
+    if (right < 0)
+      return left;
+    if (nodes[left].priority > nodes[right].priority) {
+      nodes[left].right = merge(nodes[left].right, right);
+      update(left);
+      return left;
+    }
+    nodes[right].left = merge(left, nodes[right].left);
+    update(right);
+    return right;
+  }
+
+  int erase(int t, int target) {
+    if (t == target)
+      return merge(nodes[t].left, nodes[t].right);
+    const Node &node = nodes[target];
+    if (before(node.percentage, node.student->rollNo, t))
+      nodes[t].left = erase(nodes[t].left, target);
+    else
+      nodes[t].right = erase(nodes[t].right, target);
+    update(t);
+    return t;
+  }
+
+  // Appends positions [first, last) of subtree t, in merit order
+  void collect(int t, size_t first, size_t last,
+               vector<Student *> &out) const {
+    if (t < 0 || first >= last)
+      return;
+    size_t leftSize = sizeOf(nodes[t].left);
+    if (first < leftSize)
+      collect(nodes[t].left, first, min(last, leftSize), out);
+    if (first <= leftSize && leftSize < last)
+      out.push_back(nodes[t].student);
+    if (last > leftSize + 1) {
+      size_t from = first > leftSize + 1 ? first - leftSize - 1 : 0;
+      collect(nodes[t].right, from, last - leftSize - 1, out);
+    }
+  }
+
+  static bool validClass(int classNum) {
+    return classNum >= 1 && classNum <= CLASSES;
+  }
+
+public:
+  static float keyOf(const Student *student) {
+    float percentage = student->getPercentage();
+    return percentage == percentage ? percentage : -1; // NaN sorts last
+  }
+
+  // Merit order across classes, for merging per-class answers
+  static bool meritBefore(const Student *a, const Student *b) {
+    float pa = keyOf(a);
+    float pb = keyOf(b);
+    return pa != pb ? pa > pb : a->rollNo < b->rollNo;
+  }
+
+  MeritIndex() : active(false) {
+    for (int &root : roots)
+      root = -1;
+  }
+
+  bool isActive() const { return active; }
+
+  // Build the index from the whole roster: each class is sorted once and
+  // turned into a treap in linear time, instead of n separate inserts
+  void build(const vector<Student *> &students) {
+    active = true;
+    vector<int> byClass[CLASSES + 1];
+    for (Student *student : students) {
+      if (fileNode(student))
+        byClass[student->getClassNumber()].push_back(student->getSlot());
+    }
+    vector<int> spine; // Right spine of the tree built so far
+    for (int c = 1; c <= CLASSES; c++) {
+      sort(byClass[c].begin(), byClass[c].end(), [this](int a, int b) {
+        return before(nodes[a].percentage, nodes[a].student->rollNo, b);
+      });
+      spine.clear();
+      for (int t : byClass[c]) {
+        int last = -1;
+        while (!spine.empty() &&
+               nodes[spine.back()].priority < nodes[t].priority) {
+          last = spine.back();
+          spine.pop_back();
+          update(last);
+        }
+        nodes[t].left = last;
+        if (!spine.empty())
+          nodes[spine.back()].right = t;
+        spine.push_back(t);
+      }
+      for (size_t i = spine.size(); i-- > 0;)
+        update(spine[i]);
+      roots[c] = spine.empty() ? -1 : spine[0];
+    }
+  }
+
+  // Fill in a student's node, unlinked; false if its class is not indexed
+  bool fileNode(Student *student) {
+    int classNum = student->getClassNumber();
+    if (!validClass(classNum))
+      return false;
+    uint32_t slot = student->getSlot();
+    if (slot >= nodes.size())
+      nodes.resize(slot + 1, Node{nullptr, 0, 0, -1, -1, 0, 0});
+    Node &node = nodes[slot];
+    node.student = student;
+    node.percentage = keyOf(student);
+    node.classNum = classNum;
+    node.left = node.right = -1;
+    node.size = 1;
+    // Fixed per-slot priority from an integer hash of the slot
+    uint32_t priority = slot + 1;
+    priority = (priority ^ (priority >> 16)) * 0x7feb352du;
+    priority = (priority ^ (priority >> 15)) * 0x846ca68bu;
+    node.priority = priority ^ (priority >> 16);
+    return true;
+  }
+
+  void insert(Student *student) {
+    if (!active || !fileNode(student))
+      return;
+    int classNum = student->getClassNumber();
+    uint32_t slot = student->getSlot();
+    const Node &node = nodes[slot];
+    int left, right;
+    split(roots[classNum], node.percentage, student->rollNo, left, right);
+    roots[classNum] = merge(merge(left, (int)slot), right);
+  }
+
+  void remove(const Student *student) {
+    uint32_t slot = student->getSlot();
+    if (slot >= nodes.size() || nodes[slot].student != student)
+      return;
+    int &root = roots[nodes[slot].classNum];
+    root = erase(root, (int)slot);
+    nodes[slot].student = nullptr;
+  }
+
+  // Re-file a student whose percentage or class may have changed
+  void refresh(Student *student) {
+    if (!active)
+      return;
+    remove(student);
+    insert(student);
+  }
+
+  size_t classSize(int classNum) const {
+    return validClass(classNum) ? sizeOf(roots[classNum]) : 0;
+  }
+
+  // 1-based position in the student's class, or 0 when not indexed
+  size_t rank(const Student *student) const {
+    uint32_t slot = student->getSlot();
+    if (slot >= nodes.size() || nodes[slot].student != student)
+      return 0;
+    const Node &node = nodes[slot];
+    size_t ahead = 0;
+    for (int t = roots[node.classNum]; t >= 0;) {
+      if ((uint32_t)t == slot)
+        return ahead + sizeOf(nodes[t].left) + 1;
+      if (before(node.percentage, student->rollNo, t)) {
+        t = nodes[t].left;
+      } else {
+        ahead += sizeOf(nodes[t].left) + 1;
+        t = nodes[t].right;
+      }
+    }
+    return 0;
+  }
+
+  // Number of students in a class at or above a percentage
+  size_t countAtLeast(int classNum, float percentage) const {
+    if (!validClass(classNum))
+      return 0;
+    size_t count = 0;
+    for (int t = roots[classNum]; t >= 0;) {
+      if (nodes[t].percentage >= percentage) {
+        count += sizeOf(nodes[t].left) + 1;
+        t = nodes[t].right;
+      } else {
+        t = nodes[t].left;
+      }
+    }
+    return count;
+  }
+
+  // Students at merit positions [first, last) of a class
+  void positions(int classNum, size_t first, size_t last,
+                 vector<Student *> &out) const {
+    if (validClass(classNum))
+      collect(roots[classNum], first, min(last, classSize(classNum)), out);
+  }
+};
+
+// Date-major copy of the attendance calendars: for every day of the calendar
+// range, one bitmap of the slots marked that day and one of those present.
+// "Who was absent on a date" is then a scan of two bitmaps instead of a
+// look into every student's calendar. A day's bitmaps are split into chunks
+// of CHUNK_SLOTS slots; a day and each of its chunks are only allocated
+// once a slot in them is marked, so unmarked days and slot ranges cost a
+// null pointer.
+class RollCall {
+  static const size_t CHUNK_WORDS = 64;
+  static const size_t CHUNK_SLOTS = CHUNK_WORDS * 64;
+
+  struct Chunk {
+    uint64_t marked[CHUNK_WORDS];  // Bit per store slot
+    uint64_t present[CHUNK_WORDS]; // Only meaningful where marked is set
+  };
+
+  struct Day {
+    vector<unique_ptr<Chunk>> chunks; // By slot / CHUNK_SLOTS
+  };
+
+  vector<unique_ptr<Day>> days; // Indexed by day number minus firstDay
+  int32_t firstDay;
+  bool active;
+
+  Day *dayAt(int32_t day) {
+    if (day < firstDay || day - firstDay >= (int32_t)days.size())
+      return nullptr;
+    return days[day - firstDay].get();
+  }
+
+  Chunk *chunkAt(Day *bits, uint32_t slot) {
+    size_t c = slot / CHUNK_SLOTS;
+    return bits == nullptr || c >= bits->chunks.size()
+               ? nullptr
+               : bits->chunks[c].get();
+  }
+
+public:
+  RollCall()
+      : firstDay(Calendar::dayNumber(Calendar::FIRST_YEAR, 1, 1)),
+        active(false) {
+    days.resize(Calendar::dayNumber(Calendar::LAST_YEAR + 1, 1, 1) -
+                firstDay);
+  }
+
+  // The bitmaps are filled on first use; until then mark/unmark are no-ops
+  bool isActive() const { return active; }
+  void activate() { active = true; }
+
+  void mark(uint32_t slot, int32_t day, bool present) {
+    if (!active || day < firstDay || day - firstDay >= (int32_t)days.size())
+      return;
+    unique_ptr<Day> &bits = days[day - firstDay];
+    if (!bits)
+      bits.reset(new Day());
+    size_t c = slot / CHUNK_SLOTS;
+    if (c >= bits->chunks.size())
+      bits->chunks.resize(c + 1);
+    if (!bits->chunks[c])
+      bits->chunks[c].reset(new Chunk());
+    Chunk &chunk = *bits->chunks[c];
+    size_t w = slot % CHUNK_SLOTS >> 6;
+    uint64_t bit = 1ULL << (slot & 63);
+    chunk.marked[w] |= bit;
+    if (present)
+      chunk.present[w] |= bit;
+    else
+      chunk.present[w] &= ~bit;
+  }
+
+  void unmark(uint32_t slot, int32_t day) {
+    Chunk *chunk = chunkAt(active ? dayAt(day) : nullptr, slot);
+    if (chunk == nullptr)
+      return;
+    size_t w = slot % CHUNK_SLOTS >> 6;
+    chunk->marked[w] &= ~(1ULL << (slot & 63));
+    chunk->present[w] &= ~(1ULL << (slot & 63));
+  }
+
+  // Visit the slots marked on `day`, with whether each was present
+  template <typename Visit> void forEachMarked(int32_t day, Visit visit) {
+    Day *bits = dayAt(day);
+    if (bits == nullptr)
+      return;
+    for (size_t c = 0; c < bits->chunks.size(); c++) {
+      const Chunk *chunk = bits->chunks[c].get();
+      if (chunk == nullptr)
+        continue;
+      for (size_t w = 0; w < CHUNK_WORDS; w++) {
+        for (uint64_t word = chunk->marked[w]; word != 0; word &= word - 1) {
+          int b = __builtin_ctzll(word);
+          visit((uint32_t)(c * CHUNK_SLOTS + (w << 6 | b)),
+                (chunk->present[w] >> b) & 1);
+        }
+      }
+    }
+  }
+};
+
+// Reads a text file line by line through a large buffer. Returned lines are
+// views into the buffer and stay valid until the next call to next().
+class LineReader {
+private:
+  ifstream owned;
+  istream *in;
+  vector<char> buffer;
+  size_t begin;
+  size_t end;
+  bool exhausted;
+
+  // Move the unread tail to the front and top the buffer up from the file
+  void refill() {
+    if (begin > 0) {
+      memmove(buffer.data(), buffer.data() + begin, end - begin);
+      end -= begin;
+      begin = 0;
+    }
+    if (end == buffer.size())
+      buffer.resize(buffer.size() * 2); // a single line larger than buffer
+    in->read(buffer.data() + end, buffer.size() - end);
+    size_t got = (size_t)in->gcount();
+    end += got;
+    if (got == 0)
+      exhausted = true;
+  }
+
+public:
+  explicit LineReader(const string &filename, size_t bufferSize = 1 << 20)
+      : owned(filename, ios::binary), in(&owned), buffer(bufferSize),
+        begin(0), end(0), exhausted(false) {}
+
+  explicit LineReader(istream &stream, size_t bufferSize = 1 << 20)
+      : in(&stream), buffer(bufferSize), begin(0), end(0), exhausted(false) {}
+
+  bool is_open() const { return in != &owned || owned.is_open(); }
+
+  bool next(string_view &line) {
+    size_t scanned = begin;
+    while (true) {
+      const char *newline = (const char *)memchr(
+          buffer.data() + scanned, '\n', end - scanned);
+      if (newline != nullptr) {
+        size_t pos = newline - buffer.data();
+        line = string_view(buffer.data() + begin, pos - begin);
+        begin = pos + 1;
+        return true;
+      }
+      if (exhausted) {
+        if (begin == end)
+          return false;
+        line = string_view(buffer.data() + begin, end - begin);
+        begin = end;
+        return true;
+      }
+      size_t unread = end - begin;
+      refill();
+      scanned = unread; // the old tail holds no newline
+    }
+  }
+};
+
+// Binary snapshot layout (host byte order). Every section starts on an
+// 8-byte boundary so the tables can be read in place from a mapped file.
+//
+//   SnapshotHeader
+//   SnapshotStudent[studentCount]
+//   SnapshotSubject[subjectCount]
+//   SnapshotYear[yearCount]        packed attendance, one entry per used year
+//   char[stringPoolSize]           every string field, back to back
+static const char SNAPSHOT_MAGIC[8] = {'S', 'R', 'M', 'S', 'N', 'A', 'P', 0};
+static const uint32_t SNAPSHOT_VERSION = 2; // 2 added the journal generation
+
+struct SnapshotString {
+  uint32_t offset; // into the string pool
+  uint32_t length;
+};
+
+struct SnapshotHeader {
+  char magic[8];
+  uint32_t version;
+  uint32_t studentCount;
+  uint32_t subjectCount;
+  uint32_t yearCount;
+  uint64_t studentOffset;
+  uint64_t subjectOffset;
+  uint64_t yearOffset;
+  uint64_t stringPoolOffset;
+  uint64_t stringPoolSize;
+  uint64_t journalGeneration; // version 2 and later
+};
+
+struct SnapshotStudent {
+  SnapshotString rollNo;
+  SnapshotString name;
+  SnapshotString fatherName;
+  SnapshotString className;
+  SnapshotString classCategory;
+  SnapshotString dateOfBirth;
+  SnapshotString cnicBForm;
+  SnapshotString address;
+  int32_t admissionYear;
+  int32_t currentYear;
+  uint32_t firstSubject;
+  uint32_t subjectCount;
+  uint32_t firstYear;
+  uint32_t yearCount;
+  uint8_t termsCompleted;
+  uint8_t boardMarksEntered;
+  uint8_t reserved[6];
+};
+
+struct SnapshotSubject {
+  SnapshotString subjectName;
+  SnapshotString marksStatus;
+};
+
+struct SnapshotYear {
+  int32_t year;
+  uint32_t reserved;
+  uint64_t marked[Calendar::WORDS_PER_YEAR];
+  uint64_t present[Calendar::WORDS_PER_YEAR];
+};
+
+// Read-only view of a whole file. Uses mmap where available and falls back
+// to reading the file into memory elsewhere.
+class MappedFile {
+private:
+  const char *data;
+  size_t length;
+#ifdef _WIN32
+  vector<char> buffer;
+#else
+  void *mapping;
+#endif
+
+public:
+  MappedFile() : data(nullptr), length(0) {
+#ifndef _WIN32
+    mapping = nullptr;
+#endif
+  }
+
+  bool open(const string &filename) {
+#ifdef _WIN32
+    ifstream file(filename, ios::binary | ios::ate);
+    if (!file.is_open())
+      return false;
+    length = (size_t)file.tellg();
+    buffer.resize(length);
+    file.seekg(0);
+    if (length > 0 && !file.read(buffer.data(), length))
+      return false;
+    data = buffer.data();
+    return true;
+#else
+    int fd = ::open(filename.c_str(), O_RDONLY);
+    if (fd < 0)
+      return false;
+    struct stat info;
+    if (fstat(fd, &info) != 0) {
+      ::close(fd);
+      return false;
+    }
+    length = (size_t)info.st_size;
+    if (length > 0) {
+      mapping = mmap(nullptr, length, PROT_READ, MAP_PRIVATE, fd, 0);
+      if (mapping == MAP_FAILED) {
+        mapping = nullptr;
+        ::close(fd);
+        return false;
+      }
+      madvise(mapping, length, MADV_SEQUENTIAL);
+      data = (const char *)mapping;
+    }
+    ::close(fd);
+    return true;
+#endif
+  }
+
+  const char *begin() const { return data; }
+  size_t size() const { return length; }
+
+  // Expect scattered reads rather than one pass from the start
+  void adviseRandom() {
+#ifndef _WIN32
+    if (mapping != nullptr)
+      madvise(mapping, length, MADV_RANDOM);
+#endif
+  }
+
+  ~MappedFile() {
+#ifndef _WIN32
+    if (mapping != nullptr)
+      munmap(mapping, length);
+#endif
+  }
+};
+
+// Size and modification time of a file, to tell whether something derived
+// from it is still current. False if the file cannot be read.
+static bool fileStamp(const string &filename, uint64_t &size,
+                      int64_t &modified) {
+#ifdef _WIN32
+  ifstream file(filename, ios::binary | ios::ate);
+  if (!file.is_open())
+    return false;
+  size = (uint64_t)file.tellg();
+  modified = 0; // size alone decides here
+#else
+  struct stat info;
+  if (stat(filename.c_str(), &info) != 0)
+    return false;
+  size = (uint64_t)info.st_size;
+  modified = (int64_t)info.st_mtim.tv_sec * 1000000000 + info.st_mtim.tv_nsec;
+#endif
+  return true;
+}
+
+// Flush a file through to the disk
+static bool syncFile(FILE *f) {
+  if (fflush(f) != 0)
+    return false;
+#ifdef _WIN32
+  return _commit(_fileno(f)) == 0;
+#else
+  return fsync(fileno(f)) == 0;
+#endif
+}
+
+// Flush the directory holding `path`, so a file just renamed into it
+// survives a power loss under its new name
+static bool syncDirectory(const string &path) {
+#ifdef _WIN32
+  (void)path; // NTFS logs the rename itself
+  return true;
+#else
+  size_t slash = path.rfind('/');
+  string directory = slash == string::npos ? "."
+                     : slash == 0           ? "/"
+                                            : path.substr(0, slash);
+  int fd = ::open(directory.c_str(), O_RDONLY);
+  if (fd < 0)
+    return false;
+  bool synced = fsync(fd) == 0;
+  ::close(fd);
+  return synced;
+#endif
+}
+
+// Archive index layout (host byte order), kept as <archive>.idx:
+//
+//   ArchiveIndexHeader
+//   ArchiveIndexEntry[entryCount]  sorted by hash, then offset
+//
+// The header records the archive's size and modification time; an index
+// that no longer matches them is rebuilt.
+static const char ARCHIVE_INDEX_MAGIC[8] = {'S', 'R', 'M', 'I', 'D', 'X',
+                                            '1', 0};
+
+struct ArchiveIndexHeader {
+  char magic[8];
+  uint64_t dataSize;
+  int64_t dataModified;
+  uint64_t entryCount;
+};
+
+struct ArchiveIndexEntry {
+  uint64_t hash;   // RollIndex::hashRoll of the roll number
+  uint64_t offset; // of the row in the archive
+};
+
+// A students.txt file read on demand (see StudentManager::attachArchive).
+// Opening it maps its roll number index and reads nothing else, so it takes
+// the same time for any number of rows; a row is read from the file only
+// when its student is looked up, so memory follows the students used
+// rather than the file. Roll numbers deleted since the archive was opened
+// are withdrawn, as the rows themselves never change.
+class RecordArchive {
+private:
+  string path;
+  ifstream file;
+  mutex readLock; // file; record operations look rows up too
+  unique_ptr<MappedFile> mappedIndex;
+  vector<ArchiveIndexEntry> builtIndex; // when the index was just built
+  const ArchiveIndexEntry *entries;
+  size_t count;
+  mutex withdrawnLock; // record operations withdraw roll numbers
+  unordered_set<string> withdrawn;
+
+  // The row starting at `offset`, without its line ending
+  void readRow(uint64_t offset, string &row) {
+    const size_t CHUNK = 1024;
+    lock_guard<mutex> hold(readLock);
+    row.clear();
+    file.clear();
+    file.seekg((streamoff)offset);
+    char chunk[CHUNK];
+    while (file.read(chunk, CHUNK) || file.gcount() > 0) {
+      size_t got = (size_t)file.gcount();
+      const char *newline = (const char *)memchr(chunk, '\n', got);
+      if (newline != nullptr) {
+        row.append(chunk, newline - chunk);
+        break;
+      }
+      row.append(chunk, got);
+    }
+    if (!row.empty() && row.back() == '\r')
+      row.pop_back();
+  }
+
+  // Map an index written for this very archive; false if there is none
+  bool mapIndex(const string &indexFile, uint64_t size, int64_t modified) {
+    unique_ptr<MappedFile> mapped(new MappedFile());
+    if (!mapped->open(indexFile) ||
+        mapped->size() < sizeof(ArchiveIndexHeader))
+      return false;
+    ArchiveIndexHeader header;
+    memcpy(&header, mapped->begin(), sizeof(header));
+    if (memcmp(header.magic, ARCHIVE_INDEX_MAGIC, sizeof(header.magic)) != 0 ||
+        header.dataSize != size || header.dataModified != modified ||
+        header.entryCount != (mapped->size() - sizeof(header)) /
+                                 sizeof(ArchiveIndexEntry))
+      return false;
+    mapped->adviseRandom();
+    entries = (const ArchiveIndexEntry *)(mapped->begin() + sizeof(header));
+    count = (size_t)header.entryCount;
+    mappedIndex = std::move(mapped);
+    return true;
+  }
+
+  // Index every row with a roll number and write the index out; it is used
+  // from memory even if it cannot be written
+  bool buildIndex(const string &indexFile, uint64_t size, int64_t modified) {
+    MappedFile data;
+    if (!data.open(path))
+      return false;
+    const char *begin = data.begin();
+    size_t length = data.size();
+    for (size_t offset = 0; offset < length;) {
+      const char *newline =
+          (const char *)memchr(begin + offset, '\n', length - offset);
+      size_t end = newline == nullptr ? length : newline - begin;
+      string_view row(begin + offset, end - offset);
+      string_view roll = row.substr(0, row.find('|'));
+      if (!roll.empty() && roll != "\r")
+        builtIndex.push_back({RollIndex::hashRoll(roll), offset});
+      offset = end + 1;
+    }
+    sort(builtIndex.begin(), builtIndex.end(),
+         [](const ArchiveIndexEntry &a, const ArchiveIndexEntry &b) {
+           return a.hash != b.hash ? a.hash < b.hash : a.offset < b.offset;
+         });
+    entries = builtIndex.data();
+    count = builtIndex.size();
+
+    ArchiveIndexHeader header;
+    memset(&header, 0, sizeof(header));
+    memcpy(header.magic, ARCHIVE_INDEX_MAGIC, sizeof(header.magic));
+    header.dataSize = size;
+    header.dataModified = modified;
+    header.entryCount = count;
+    string tempName = indexFile + ".tmp";
+    ofstream out(tempName, ios::binary | ios::trunc);
+    out.write((const char *)&header, sizeof(header));
+    out.write((const char *)entries, count * sizeof(ArchiveIndexEntry));
+    out.close();
+    if (!out) {
+      remove(tempName.c_str());
+      return true;
+    }
+#ifdef _WIN32
+    remove(indexFile.c_str());
+#endif
+    if (rename(tempName.c_str(), indexFile.c_str()) != 0)
+      remove(tempName.c_str());
+    return true;
+  }
+
+public:
+  RecordArchive() : entries(nullptr), count(0) {}
+
+  // Open `filename`, building its index if there is no current one (then
+  // `indexed` is set). False if the file cannot be read.
+  bool open(const string &filename, bool &indexed) {
+    close();
+    uint64_t size;
+    int64_t modified;
+    if (!fileStamp(filename, size, modified))
+      return false;
+    file.open(filename, ios::binary);
+    if (!file.is_open())
+      return false;
+    path = filename;
+    string indexFile = filename + ".idx";
+    indexed = !mapIndex(indexFile, size, modified);
+    if (indexed && !buildIndex(indexFile, size, modified)) {
+      close();
+      return false;
+    }
+    return true;
+  }
+
+  void close() {
+    if (file.is_open())
+      file.close();
+    mappedIndex.reset();
+    vector<ArchiveIndexEntry>().swap(builtIndex);
+    entries = nullptr;
+    count = 0;
+    withdrawn.clear();
+    path.clear();
+  }
+
+  bool isOpen() const { return file.is_open(); }
+  const string &filename() const { return path; }
+  size_t size() const { return count; } // rows indexed
+
+  // The first row for rollNo, unless the roll number has been withdrawn.
+  // Safe from any thread.
+  bool find(const string &rollNo, string &row) {
+    uint64_t h = RollIndex::hashRoll(rollNo);
+    const ArchiveIndexEntry *last = entries + count;
+    const ArchiveIndexEntry *entry =
+        lower_bound(entries, last, h,
+                    [](const ArchiveIndexEntry &e, uint64_t value) {
+                      return e.hash < value;
+                    });
+    for (; entry != last && entry->hash == h; ++entry) {
+      readRow(entry->offset, row);
+      if (string_view(row).substr(0, row.find('|')) == rollNo)
+        return !isWithdrawn(rollNo);
+    }
+    return false;
+  }
+
+  // The archived row of this roll number no longer counts; safe from any
+  // thread
+  void withdraw(const string &rollNo) {
+    lock_guard<mutex> hold(withdrawnLock);
+    withdrawn.insert(rollNo);
+  }
+
+  bool isWithdrawn(const string &rollNo) {
+    lock_guard<mutex> hold(withdrawnLock);
+    return withdrawn.count(rollNo) != 0;
+  }
+};
+
+// Case-insensitive check that text starts with a lowercase prefix
+static bool startsWithIgnoreCase(string_view text, const char *prefix) {
+  size_t length = strlen(prefix);
+  if (text.size() < length)
+    return false;
+  for (size_t i = 0; i < length; i++) {
+    if (tolower((unsigned char)text[i]) != prefix[i])
+      return false;
+  }
+  return true;
+}
+
+// Per-slot outputs of a recompute, the StudentStore columns themselves
+struct GradeColumns {
+  float *totalMarks;
+  float *maxMarks;
+  float *percentage;
+  char *grade;
+};
+
+// Reference kernel for slots [first, last). Sums run in subject order and
+// the percentage/grade formulas match Student::recalculateMarks, including
+// leaving percentage and grade alone when nothing is scored.
+static void recomputeGradesScalar(const MarksColumns &in, GradeColumns out,
+                                  size_t first, size_t last) {
+  for (size_t i = first; i < last; i++) {
+    const float *marks = in.marks.data() + in.offset[i];
+    const float *maxMarks = in.maxMarks.data() + in.offset[i];
+    float total = 0;
+    float maxTotal = 0;
+    for (uint32_t j = 0; j < in.count[i]; j++) {
+      total += marks[j];
+      maxTotal += maxMarks[j];
+    }
+    out.totalMarks[i] = total;
+    out.maxMarks[i] = maxTotal;
+    if (maxTotal > 0) {
+      out.percentage[i] = (total / maxTotal) * 100.0;
+      out.grade[i] = Student::calculateGrade(out.percentage[i]);
+    }
+  }
+}
+
+#ifdef HAVE_AVX2_KERNEL
+// Eight students per vector, one lane each, so every lane still adds its
+// own marks in subject order and the results are bit-identical to the
+// scalar kernel. The percentage goes through double like the scalar
+// `* 100.0`, and the grade is 'F' minus the number of thresholds reached.
+__attribute__((target("avx2"))) static void
+recomputeGradesAVX2(const MarksColumns &in, GradeColumns out, size_t first,
+                    size_t last) {
+  const __m256 zero = _mm256_setzero_ps();
+  const __m256d hundred = _mm256_set1_pd(100.0);
+  const float thresholds[] = {50, 60, 70, 80, 90};
+  size_t i = first;
+  for (; i + 8 <= last; i += 8) {
+    __m256i offset =
+        _mm256_loadu_si256((const __m256i *)(in.offset.data() + i));
+    __m256i count = _mm256_loadu_si256((const __m256i *)(in.count.data() + i));
+    uint32_t longest = 0;
+    for (size_t k = i; k < i + 8; k++)
+      longest = max(longest, in.count[k]);
+
+    __m256 total = zero;
+    __m256 maxMarks = zero;
+    for (uint32_t j = 0; j < longest; j++) {
+      __m256i step = _mm256_set1_epi32((int)j);
+      __m256 active = _mm256_castsi256_ps(_mm256_cmpgt_epi32(count, step));
+      __m256i index = _mm256_add_epi32(offset, step);
+      total = _mm256_add_ps(
+          total, _mm256_mask_i32gather_ps(zero, in.marks.data(), index,
+                                          active, 4));
+      maxMarks = _mm256_add_ps(
+          maxMarks, _mm256_mask_i32gather_ps(zero, in.maxMarks.data(), index,
+                                             active, 4));
+    }
+    _mm256_storeu_ps(out.totalMarks + i, total);
+    _mm256_storeu_ps(out.maxMarks + i, maxMarks);
+
+    int scored = _mm256_movemask_ps(_mm256_cmp_ps(maxMarks, zero, _CMP_GT_OQ));
+    if (scored == 0)
+      continue;
+    __m256 ratio = _mm256_div_ps(total, maxMarks);
+    __m128 low = _mm256_cvtpd_ps(
+        _mm256_mul_pd(_mm256_cvtps_pd(_mm256_castps256_ps128(ratio)), hundred));
+    __m128 high = _mm256_cvtpd_ps(_mm256_mul_pd(
+        _mm256_cvtps_pd(_mm256_extractf128_ps(ratio, 1)), hundred));
+    __m256 percentage = _mm256_set_m128(high, low);
+    __m256i reached = _mm256_setzero_si256();
+    for (float threshold : thresholds) {
+      __m256 hit =
+          _mm256_cmp_ps(percentage, _mm256_set1_ps(threshold), _CMP_GE_OQ);
+      reached = _mm256_sub_epi32(reached, _mm256_castps_si256(hit));
+    }
+
+    alignas(32) float lanePercentage[8];
+    alignas(32) int32_t laneReached[8];
+    _mm256_store_ps(lanePercentage, percentage);
+    _mm256_store_si256((__m256i *)laneReached, reached);
+    for (int k = 0; k < 8; k++) {
+      if (scored & (1 << k)) {
+        out.percentage[i + k] = lanePercentage[k];
+        out.grade[i + k] = (char)('F' - laneReached[k]);
+      }
+    }
+  }
+  recomputeGradesScalar(in, out, i, last);
+}
+#endif
+
+// Recompute every slot, in parallel blocks, with the widest kernel the CPU
+// supports
+static void recomputeGrades(const MarksColumns &in, GradeColumns out) {
+  const size_t BLOCK = 1 << 14;
+  size_t slots = in.count.size();
+#ifdef HAVE_AVX2_KERNEL
+  bool useAVX2 = __builtin_cpu_supports("avx2");
+#endif
+  parallelFor((slots + BLOCK - 1) / BLOCK, [&](size_t block) {
+    size_t first = block * BLOCK;
+    size_t last = min(slots, first + BLOCK);
+#ifdef HAVE_AVX2_KERNEL
+    if (useAVX2) {
+      recomputeGradesAVX2(in, out, first, last);
+      return;
+    }
+#endif
+    recomputeGradesScalar(in, out, first, last);
+  });
+}
+
+// Append-only write-ahead journal of roster mutations. Each record is
+//
+//   uint32 length | payload (op byte + fields) | uint32 checksum
+//
+// Strings are a uint32 length followed by the bytes; integers are int32.
+// The file starts with a header carrying a generation number. A snapshot
+// written by compaction records the generation it folds in, so a journal
+// left behind from an older generation is ignored on startup.
+class Journal {
+public:
+  enum Op : uint8_t {
+    ADD_STUDENT = 1,
+    UPDATE_MARKS = 2,
+    MARK_ATTENDANCE = 3,
+    UPDATE_TERMS = 4,
+    DELETE_STUDENT = 5,
+    PROMOTE_STUDENT = 6,
+    OPEN_ARCHIVE = 7
+  };
+
+  // Group commit: appended records reach the OS immediately, and one sync
+  // makes every record appended so far durable. Batch and server mode sync
+  // just before sending the responses that acknowledge a burst of changes,
+  // so the whole burst, and whatever other threads appended meanwhile,
+  // shares one fsync.
+
+  class Record {
+  private:
+    string bytes;
+
+  public:
+    explicit Record(Op op) {
+      bytes.append(4, '\0'); // length, filled in by finish()
+      bytes.push_back((char)op);
+    }
+
+    void putInt(int32_t value) {
+      bytes.append((const char *)&value, sizeof(value));
+    }
+
+    void putString(const string &value) {
+      putInt((int32_t)value.size());
+      bytes += value;
+    }
+
+    const string &finish() {
+      uint32_t length = (uint32_t)bytes.size() - 4;
+      memcpy(&bytes[0], &length, sizeof(length));
+      uint32_t sum = checksum(bytes.data() + 4, length);
+      bytes.append((const char *)&sum, sizeof(sum));
+      return bytes;
+    }
+  };
+
+  class Reader {
+  private:
+    const char *cursor;
+    const char *end;
+    bool failed;
+
+  public:
+    Reader(const char *data, size_t size)
+        : cursor(data), end(data + size), failed(false) {}
+
+    bool ok() const { return !failed; }
+
+    int32_t getInt() {
+      int32_t value = 0;
+      if (end - cursor < (ptrdiff_t)sizeof(value)) {
+        failed = true;
+        return 0;
+      }
+      memcpy(&value, cursor, sizeof(value));
+      cursor += sizeof(value);
+      return value;
+    }
+
+    string getString() {
+      int32_t length = getInt();
+      if (length < 0 || end - cursor < length) {
+        failed = true;
+        return string();
+      }
+      string value(cursor, length);
+      cursor += length;
+      return value;
+    }
+  };
+
+private:
+  static const char MAGIC[8];
+  static const uint32_t VERSION = 1;
+
+  struct Header {
+    char magic[8];
+    uint32_t version;
+    uint32_t reserved;
+    uint64_t generation;
+  };
+
+  FILE *file;
+  string path;
+  int unsynced;
+  // A write or sync went wrong. Records after a torn one would never be
+  // replayed, so nothing more is appended until the next reset.
+  bool failed;
+  mutex lock; // Appends and syncs from concurrent record operations
+
+  static uint32_t checksum(const char *data, size_t size) {
+    uint32_t h = 2166136261u; // FNV-1a
+    for (size_t i = 0; i < size; i++) {
+      h ^= (unsigned char)data[i];
+      h *= 16777619u;
+    }
+    return h;
+  }
+
+  // sync with the lock already held
+  bool syncHeld() {
+    if (file == nullptr)
+      return true;
+    if (failed)
+      return false;
+    if (unsynced == 0)
+      return true;
+    // After a failed fsync the kernel may drop the dirty pages, so a later
+    // one succeeding proves nothing
+    if (!syncFile(file)) {
+      failed = true;
+      return false;
+    }
+    unsynced = 0;
+    return true;
+  }
+
+  // Write a journal holding only the header plus `records`, then rename it
+  // over `filename`
+  static bool writeFresh(const string &filename, uint64_t generation,
+                         const char *records, size_t size) {
+    string tempName = filename + ".tmp";
+    FILE *out = fopen(tempName.c_str(), "wb");
+    if (out == nullptr)
+      return false;
+    Header header;
+    memset(&header, 0, sizeof(header));
+    memcpy(header.magic, MAGIC, sizeof(header.magic));
+    header.version = VERSION;
+    header.generation = generation;
+    bool written = fwrite(&header, sizeof(header), 1, out) == 1 &&
+                   (size == 0 || fwrite(records, size, 1, out) == 1) &&
+                   syncFile(out);
+    written = fclose(out) == 0 && written;
+    if (!written) {
+      remove(tempName.c_str());
+      return false;
+    }
+#ifdef _WIN32
+    remove(filename.c_str());
+#endif
+    return rename(tempName.c_str(), filename.c_str()) == 0 &&
+           syncDirectory(filename);
+  }
+
+public:
+  Journal() : file(nullptr), unsynced(0), failed(false) {}
+
+  bool isOpen() const { return file != nullptr; }
+
+  // Replay every intact record of `filename` through `apply`. A torn or
+  // corrupt tail left by a crash is cut off so appends continue after the
+  // last good record. Returns the number of records replayed, or -1 if the
+  // file exists but is not a journal.
+  static long replay(const string &filename, uint64_t &generation,
+                     function<void(Op, Reader &)> apply) {
+    MappedFile mapped;
+    if (!mapped.open(filename))
+      return 0; // no journal yet
+
+    const char *base = mapped.begin();
+    size_t size = mapped.size();
+    Header header;
+    if (size < sizeof(header))
+      return -1;
+    memcpy(&header, base, sizeof(header));
+    if (memcmp(header.magic, MAGIC, sizeof(header.magic)) != 0 ||
+        header.version != VERSION)
+      return -1;
+    if (header.generation < generation)
+      return 0; // already folded into the snapshot
+    generation = header.generation;
+
+    size_t offset = sizeof(header);
+    long replayed = 0;
+    while (size - offset >= 8) {
+      uint32_t length;
+      memcpy(&length, base + offset, sizeof(length));
+      if (length == 0 || length > size - offset - 8)
+        break;
+      const char *payload = base + offset + 4;
+      uint32_t sum;
+      memcpy(&sum, payload + length, sizeof(sum));
+      if (sum != checksum(payload, length))
+        break;
+      Reader reader(payload + 1, length - 1);
+      apply((Op)payload[0], reader);
+      offset += 8 + length;
+      replayed++;
+    }
+
+    if (offset != size) {
+      cout << "[WARNING] " << filename << ": discarding " << size - offset
+           << " bytes of incomplete journal data.\n";
+      writeFresh(filename, generation, base + sizeof(header),
+                 offset - sizeof(header));
+    }
+    return replayed;
+  }
+
+  // Open for appending, creating a fresh journal if none exists
+  bool open(const string &filename, uint64_t generation) {
+    close();
+    path = filename;
+    FILE *existing = fopen(filename.c_str(), "rb");
+    bool valid = false;
+    if (existing != nullptr) {
+      Header header;
+      valid = fread(&header, sizeof(header), 1, existing) == 1 &&
+              memcmp(header.magic, MAGIC, sizeof(header.magic)) == 0 &&
+              header.generation == generation;
+      fclose(existing);
+    }
+    if (!valid && !writeFresh(filename, generation, nullptr, 0))
+      return false;
+    file = fopen(filename.c_str(), "ab");
+    unsynced = 0;
+    failed = false;
+    return file != nullptr;
+  }
+
+  // Start a new, empty journal generation (after compaction)
+  bool reset(uint64_t generation) {
+    string filename = path;
+    close();
+    if (!writeFresh(filename, generation, nullptr, 0))
+      return false;
+    return open(filename, generation);
+  }
+
+  // False if the record could not be written; it is then not logged
+  bool append(Record &record) {
+    if (file == nullptr)
+      return true;
+    const string &bytes = record.finish();
+    lock_guard<mutex> hold(lock);
+    if (failed)
+      return false;
+    // The fflush lets the record survive a process crash even before the
+    // fsync
+    if (fwrite(bytes.data(), 1, bytes.size(), file) != bytes.size() ||
+        fflush(file) != 0) {
+      failed = true;
+      return false;
+    }
+    unsynced++;
+    return true;
+  }
+
+  // Make every appended record durable. False if the journal has failed.
+  bool sync() {
+    lock_guard<mutex> hold(lock);
+    return syncHeld();
+  }
+
+  void close() {
+    if (file == nullptr)
+      return;
+    sync();
+    fclose(file);
+    file = nullptr;
+  }
+
+  ~Journal() { close(); }
+};
+
+const char Journal::MAGIC[8] = {'S', 'R', 'M', 'J', 'R', 'N', 'L', 0};
+
+class StudentManager {
+  friend class Benchmarks; // Student Record Benchmarks.cpp
+
+public:
+  // Status codes reported by batch mode, one per command
+  enum BatchStatus {
+    BATCH_OK = 0,
+    BATCH_NOT_FOUND = 1,
+    BATCH_DUPLICATE = 2,
+    BATCH_INVALID = 3,
+    BATCH_UNKNOWN = 4,
+    BATCH_FAILED = 5
+  };
+
+  // Unchanged archived students kept loaded, unless ATTACH says otherwise
+  static const size_t ARCHIVE_CACHE = 4096;
+
+  // A copy of one student's record, taken by lookupStudent
+  struct StudentView {
+    string rollNo, name, fatherName, category;
+    string dateOfBirth, cnicBForm, address;
+    int classNum, admissionYear, currentYear, termsCompleted;
+    bool boardMarks;
+    vector<Subject> subjects;
+    float totalMarks, maxMarks, percentage;
+    char grade;
+    int daysMarked, daysPresent;
+    int termPresent, termMarked, sessionPresent, sessionMarked;
+  };
+
+  // Holds the roster for a roster operation while other threads may be
+  // running record operations; see below
+  class RosterLock {
+  public:
+    explicit RosterLock(StudentManager &manager) : hold(manager.epochs) {}
+
+  private:
+    EpochDomain::Exclusive hold;
+  };
+
+private:
+  // Record operations (lookupStudent, countAttendance, setMarks,
+  // setAttendance, removeStudent) may run on any number of threads at once.
+  // Each runs inside an epoch section and works on one student. Readers
+  // take no lock: they find the student in its roll shard and copy one
+  // version of its record. Writers hold the shard's lock while they publish
+  // a new version (see changeRecord), and take the journal's lock to append
+  // and the lock of any shared index they update (merit order, roll call,
+  // roster structure), each for a few hundred nanoseconds. Everything else
+  // is a roster operation and needs the roster to itself: a RosterLock, or
+  // no other threads.
+  Student *head;
+  Student *tail; // Last student, so appends need no walk
+  atomic<int> totalStudents;
+  StudentStore store;    // Columns and cold strings behind every Student
+  RollShards hashTable;  // Roll number index, sharded for record operations
+  NameIndex nameIndex;   // Name and father's name search
+  MeritIndex meritIndex; // Per-class merit order, built on first use
+  CnicIndex cnicIndex;   // Normalized CNIC/B-Form to its holders
+  RollCall rollCall;     // Attendance by date and slot, built on first use
+  Journal journal;     // Write-ahead log of mutations since the snapshot
+  uint64_t journalGeneration;
+  string snapshotPath;
+  EpochDomain epochs;   // Sections of record operations, retired students
+  mutex structureLock;  // Roster list, class, name and CNIC indexes
+  mutex meritLock;      // meritIndex during record operations
+  mutex rollCallLock;   // rollCall during record operations
+  uint64_t nextListOrder;
+
+  // A text save running on its own thread. It writes the roster as it was
+  // when the save began: each student is written either by the save's own
+  // pass or, copy-on-write, by whichever mutator is about to change it
+  // first (preserved below until the pass reaches its place).
+  struct BackgroundSave {
+    uint32_t generation;
+    string filename;
+    uint32_t slotLimit; // Slots in use when the save began
+    chrono::steady_clock::time_point started;
+    mutex lock;
+    unordered_map<uint64_t, string> preserved; // List order to record line
+    thread worker;
+  };
+  unique_ptr<BackgroundSave> backgroundSave;
+  atomic<uint32_t> savingGeneration; // The running save's number, or 0
+  uint32_t lastSaveGeneration;
+
+  // Students read from the archive on demand (see attachArchive). Those
+  // not changed since are cached, most recently used first; a change takes
+  // a student out of the cache for good, as its row is then out of date.
+  RecordArchive archive;
+  list<Student *> archiveCache;
+  unordered_map<Student *, list<Student *>::iterator> archiveCached;
+  size_t archiveCapacity;
+  mutex archiveLock; // archiveCache and archiveCached in record operations
+
+  // Students of one class and category, linked through classNext/classPrev
+  // in the order they joined the group
+  struct ClassGroup {
+    Student *head;
+    Student *tail;
+    int count;
+  };
+  map<pair<int, string>, ClassGroup> classIndex; // (class, category) groups
+
+  void addToClassIndex(Student *student) {
+    ClassGroup &group =
+        classIndex[{student->getClassNumber(), student->classCategory}];
+    student->classPrev = group.tail;
+    student->classNext = nullptr;
+    if (group.tail == nullptr)
+      group.head = student;
+    else
+      group.tail->classNext = student;
+    group.tail = student;
+    group.count++;
+  }
+
+  void removeFromClassIndex(Student *student) {
+    ClassGroup &group =
+        classIndex[{student->getClassNumber(), student->classCategory}];
+    if (student->classPrev == nullptr)
+      group.head = student->classNext;
+    else
+      student->classPrev->classNext = student->classNext;
+    if (student->classNext == nullptr)
+      group.tail = student->classPrev;
+    else
+      student->classNext->classPrev = student->classPrev;
+    student->classPrev = student->classNext = nullptr;
+    group.count--;
+  }
+
+  // Students of a class, limited to one category unless `category` is empty.
+  // Groups are visited in category order, each in the order it was joined.
+  vector<Student *> classMembers(int classNum, const string &category) {
+    vector<Student *> members;
+    auto it = category.empty() ? classIndex.lower_bound({classNum, ""})
+                               : classIndex.find({classNum, category});
+    for (; it != classIndex.end() && it->first.first == classNum; ++it) {
+      if (!category.empty() && it->first.second != category)
+        break;
+      for (Student *student = it->second.head; student != nullptr;
+           student = student->classNext)
+        members.push_back(student);
+    }
+    return members;
+  }
+
+  // Ranked name search. The index is kept as students are loaded and
+  // added, so the first search costs no more than the next.
+  size_t findByName(const string &query, size_t limit,
+                    vector<Student *> &results) {
+    vector<NameIndex::Match> matches;
+    size_t total = nameIndex.search(query, limit, matches);
+    results.clear();
+    for (const NameIndex::Match &match : matches)
+      results.push_back(store.owner[match.slot]);
+    return total;
+  }
+
+  // Promote one student, moving it to its new class group
+  bool promoteStudent(Student *student) {
+    beforeChange(student);
+    removeFromClassIndex(student);
+    bool promoted = student->promoteToNextClass();
+    addToClassIndex(student);
+    meritIndex.refresh(student);
+    return promoted;
+  }
+
+  // Add every marked day of a student to the roll call, or take them out
+  void fileAttendance(Student *student, bool add) {
+    uint32_t slot = student->getSlot();
+    student->record().attendance.forEachMarked(
+        [&](int year, int month, int day, bool present) {
+          int32_t days = Calendar::dayNumber(year, month, day);
+          if (add)
+            rollCall.mark(slot, days, present);
+          else
+            rollCall.unmark(slot, days);
+        });
+  }
+
+  void ensureRollCall() {
+    if (rollCall.isActive())
+      return;
+    rollCall.activate();
+    for (Student *current = head; current != nullptr; current = current->next)
+      fileAttendance(current, true);
+  }
+
+  // Mark one student's calendar and the roll call together. Returns false
+  // if the date falls outside the calendar range.
+  bool recordAttendance(Student *student, int year, int month, int day,
+                        bool present) {
+    beforeChange(student);
+    if (!Calendar::inRange(year, month, day))
+      return false;
+    changeRecord(student, year, [&](RecordVersion &version) {
+      version.attendance.markAttendance(year, month, day, present);
+    });
+    if (rollCall.isActive()) {
+      lock_guard<mutex> hold(rollCallLock);
+      rollCall.mark(student->getSlot(), Calendar::dayNumber(year, month, day),
+                    present);
+    }
+    return true;
+  }
+
+  void ensureMeritIndex() {
+    if (meritIndex.isActive())
+      return;
+    vector<Student *> students;
+    students.reserve(totalStudents);
+    for (Student *current = head; current != nullptr; current = current->next)
+      students.push_back(current);
+    meritIndex.build(students);
+  }
+
+  // With an archive open, a student not loaded yet is read from it here
+  Student *searchInHashTable(const string &rollNo) {
+    Student *student = hashTable.find(rollNo);
+    if (!archive.isOpen())
+      return student;
+    if (student == nullptr)
+      return loadArchived(rollNo);
+    auto cached = archiveCached.find(student);
+    if (cached != archiveCached.end())
+      archiveCache.splice(archiveCache.begin(), archiveCache, cached->second);
+    return student;
+  }
+
+  // Whether a roll number is in use, loaded or in the open archive. Unlike
+  // searchInHashTable it loads nothing, so duplicate checks leave the
+  // archive cache as it was.
+  bool rollTaken(const string &rollNo) {
+    if (hashTable.find(rollNo) != nullptr)
+      return true;
+    string row;
+    return archive.isOpen() && archive.find(rollNo, row);
+  }
+
+  // Read one student from the archive into the roster and the cache;
+  // nullptr if the archive has no usable row for it
+  Student *loadArchived(const string &rollNo) {
+    string row;
+    if (!archive.find(rollNo, row))
+      return nullptr;
+    vector<string_view> tokens;
+    bool repaired;
+    Student *student = parseRecord(
+        row, tokens, [](const char *, const string &) {},
+        [&](const string &roll) { return roll == rollNo; }, repaired);
+    if (student == nullptr)
+      return nullptr;
+    insertStudent(student);
+    archiveCache.push_front(student);
+    archiveCached[student] = archiveCache.begin();
+    return student;
+  }
+
+  // A changed student stays loaded from now on
+  void keepLoaded(Student *student) {
+    lock_guard<mutex> hold(archiveLock);
+    auto cached = archiveCached.find(student);
+    if (cached == archiveCached.end())
+      return;
+    archiveCache.erase(cached->second);
+    archiveCached.erase(cached);
+  }
+
+  void addToHashTable(Student *student) { hashTable.insert(student); }
+
+  void removeFromHashTable(const string &rollNo) { hashTable.erase(rollNo); }
+
+  void showStudentInfo(Student *student) {
+    if (student == nullptr)
+      return;
+    StudentView view;
+    fillView(student, view);
+    showStudentInfo(view);
+  }
+
+  void showStudentInfo(const StudentView &student) {
+    cout << "\n+------------------------------------------------------+\n";
+    cout << "  Roll Number          : " << student.rollNo << "\n";
+    cout << "  Name                 : " << student.name << "\n";
+    cout << "  Father's Name        : " << student.fatherName << "\n";
+    cout << "  Class                : " << student.classNum << "\n";
+    if (!student.category.empty()) {
+      cout << "  Category             : " << student.category << "\n";
+    }
+    cout << "  Admission Year       : " << student.admissionYear << "\n";
+    cout << "  Current Year         : " << student.currentYear << "\n";
+    cout << "  Date of Birth        : " << student.dateOfBirth << "\n";
+    cout << "  CNIC/B-Form          : " << student.cnicBForm << "\n";
+    cout << "  Address              : " << student.address << "\n";
+
+    // Attendance info
+    cout << "  ---------------------------------------------------\n";
+    cout << "  ATTENDANCE SUMMARY:\n";
+    cout << "  Total Days Marked    : " << student.daysMarked << "\n";
+    cout << "  Present Days         : " << student.daysPresent << "\n";
+    cout << "  Absent Days          : "
+         << student.daysMarked - student.daysPresent << "\n";
+    cout << "  This Term            : "
+         << attendanceLine(student.termPresent, student.termMarked) << "\n";
+    cout << "  This Session         : "
+         << attendanceLine(student.sessionPresent, student.sessionMarked)
+         << "\n";
+
+    cout << "  ---------------------------------------------------\n";
+    cout << "  SUBJECT DETAILS:\n";
+    cout << "  ---------------------------------------------------\n";
+
+    int count = 1;
+    for (const Subject &current : student.subjects) {
+      cout << "  " << count << ". " << current.name() << " : ";
+      if (current.status == Subject::ABSENT) {
+        cout << "Absent\n";
+      } else if (current.status == Subject::LEAVE) {
+        cout << "Leave\n";
+      } else if (current.status == Subject::NOT_ENTERED) {
+        cout << "Not Entered\n";
+      } else {
+        int maxMarksForSub =
+            subjectCatalog.maxMarks(current.id, student.classNum);
+        cout << current.marksStatus() << " / " << maxMarksForSub << "\n";
+      }
+      count++;
+    }
+
+    cout << "  ---------------------------------------------------\n";
+    cout << "  Total Subjects       : " << student.subjects.size() << "\n";
+    if (student.maxMarks > 0) {
+      cout << "  Total Marks          : " << fixed << setprecision(2)
+           << student.totalMarks << " / " << student.maxMarks << "\n";
+      cout << "  Percentage           : " << student.percentage << "%\n";
+      cout << "  Grade                : " << student.grade << "\n";
+    } else {
+      cout << "  Total Marks          : Not Calculated\n";
+    }
+    cout << "  ---------------------------------------------------\n";
+    cout << "  Terms Completed      : " << student.termsCompleted << "/3\n";
+    if (student.classNum >= 8 && student.classNum <= 12) {
+      cout << "  Board Marks Entered  : " << (student.boardMarks ? "Yes" : "No")
+           << "\n";
+    }
+    cout << "+------------------------------------------------------+\n";
+  }
+
+  string getValidInput(string prompt, bool canSkip,
+                       function<bool(string)> validator = nullptr) {
+    string input;
+    while (true) {
+      cout << prompt;
+      if (canSkip)
+        cout << " (Press Enter to skip)";
+      cout << ": ";
+      getline(cin, input);
+
+      if (input.empty() && canSkip) {
+        return "";
+      }
+
+      if (input.empty() && !canSkip) {
+        cout << "[ERROR] This field cannot be empty! Please try again.\n";
+        continue;
+      }
+
+      if (validator && !validator(input)) {
+        cout << "[ERROR] Invalid input! Please try again.\n";
+        continue;
+      }
+
+      return input;
+    }
+  }
+
+  // Parse a whole field as a number; trailing characters make it invalid
+  template <typename T> static bool parseNumber(string_view field, T &value) {
+    const char *first = field.data();
+    const char *last = first + field.size();
+    from_chars_result result = from_chars(first, last, value);
+    return !field.empty() && result.ec == errc() && result.ptr == last;
+  }
+
+  static bool validateCNIC(string cnic) {
+    if (cnic.length() != 13)
+      return false;
+    for (char c : cnic) {
+      if (c < '0' || c > '9')
+        return false;
+    }
+    return true;
+  }
+
+  static bool validateDOB(string dob) {
+    if (dob.length() != 8)
+      return false;
+    for (char c : dob) {
+      if (c < '0' || c > '9')
+        return false;
+    }
+    return true;
+  }
+
+  static bool validateYear(string year) {
+    try {
       int y = stoi(year);
       return y >= 1900 && y <= 2100;
     } catch (...) {
@@ -405,672 +4090,4759 @@ private:
     }
   }
 
-  static bool validateMarks(string marks, int maxMarks = 100) {
-    if (marks == "A" || marks == "L" || marks == "-")
+  static bool validateClass(string className) {
+    int classNum;
+    return parseNumber(className, classNum) && classNum >= 1 && classNum <= 12;
+  }
+
+  static bool validateMarks(string marks, int maxMarks = 100) {
+    if (marks == "A" || marks == "L" || marks == "-")
+      return true;
+    try {
+      float m = stof(marks);
+      return m >= 0 && m <= maxMarks;
+    } catch (...) {
+      return false;
+    }
+  }
+
+  // Validate admission date based on class and academic year rules
+  bool validateAdmissionDate(int classNum, int admissionYear, int currentMonth,
+                             int currentYear) {
+    // Classes 1-7: Papers in February, new session starts in March
+    // Classes 8-10: Papers in February/March, new session in April
+    // Classes 11-12: Papers in May/June, new session in June/July
+
+    if (classNum >= 1 && classNum <= 7) {
+      // For classes 1-7, admission should be in March (month 3) or later in the
+      // year If current month is before March, admission year should be
+      // previous year
+      if (currentMonth < 3) {
+        // If it's Jan/Feb, admission year should be previous year
+        return (admissionYear == currentYear - 1);
+      } else {
+        // If it's March or later, admission year should be current year
+        return (admissionYear == currentYear);
+      }
+    } else if (classNum >= 8 && classNum <= 10) {
+      // For classes 8-10, papers in Feb/March, new session in April
+      if (currentMonth < 4) {
+        // If it's Jan/Feb/March, admission year should be previous year
+        return (admissionYear == currentYear - 1);
+      } else {
+        // If it's April or later, admission year should be current year
+        return (admissionYear == currentYear);
+      }
+    } else if (classNum >= 11 && classNum <= 12) {
+      // For classes 11-12, papers in May/June, new session in June/July
+      if (currentMonth < 6) {
+        // If it's before June, admission year should be previous year
+        return (admissionYear == currentYear - 1);
+      } else {
+        // If it's June or later, admission year should be current year
+        return (admissionYear == currentYear);
+      }
+    }
+    return true; // Default validation
+  }
+
+  // Get current date components
+  void getCurrentDate(int &year, int &month, int &day) {
+    // Get current system date; localtime's shared buffer is avoided since
+    // record operations ask for it from several threads
+    time_t now = time(0);
+    tm ltm;
+#ifdef _WIN32
+    localtime_s(&ltm, &now);
+#else
+    localtime_r(&now, &ltm);
+#endif
+    year = 1900 + ltm.tm_year;
+    month = 1 + ltm.tm_mon;
+    day = ltm.tm_mday;
+  }
+
+  // Today's day number
+  int32_t today() {
+    int year, month, day;
+    getCurrentDate(year, month, day);
+    return Calendar::dayNumber(year, month, day);
+  }
+
+  string formatCNIC(string input) {
+    return input.substr(0, 5) + "-" + input.substr(5, 7) + "-" +
+           input.substr(12, 1);
+  }
+
+  string formatDOB(string input) {
+    return input.substr(0, 2) + "-" + input.substr(2, 2) + "-" +
+           input.substr(4, 4);
+  }
+
+  vector<string> getSubjectsForClass(string className, string category) {
+    vector<string> subjects;
+
+    if (className == "8" || className == "9" || className == "10") {
+      if (category == "Computer Science") {
+        subjects = {
+            "English",      "Urdu",     "Maths",       "Physics",
+            "Chemistry",    "Islamiat", "Pak Studies", "Computer Science",
+            "Mutaila Quran"};
+      } else if (category == "Biology") {
+        subjects = {"English",     "Urdu",      "Maths",
+                    "Physics",     "Chemistry", "Islamiat",
+                    "Pak Studies", "Biology",   "Mutaila Quran"};
+      }
+    } else if (className == "11") {
+      if (category == "Computer Science") {
+        subjects = {"English",      "Urdu",     "Maths",
+                    "Physics",      "Islamiat", "Computer Science",
+                    "Mutaila Quran"};
+      } else if (category == "Pre-Engineering") {
+        subjects = {"English",   "Urdu",     "Maths",        "Physics",
+                    "Chemistry", "Islamiat", "Mutaila Quran"};
+      } else if (category == "Pre-Medical") {
+        subjects = {"English",   "Urdu",     "Physics",      "Biology",
+                    "Chemistry", "Islamiat", "Mutaila Quran"};
+      }
+    } else if (className == "12") {
+      if (category == "Computer Science") {
+        subjects = {"English",      "Urdu",        "Maths",
+                    "Physics",      "Pak Studies", "Computer Science",
+                    "Mutaila Quran"};
+      } else if (category == "Pre-Engineering") {
+        subjects = {"English",   "Urdu",        "Maths",        "Physics",
+                    "Chemistry", "Pak Studies", "Mutaila Quran"};
+      } else if (category == "Pre-Medical") {
+        subjects = {"English",   "Urdu",        "Physics",      "Biology",
+                    "Chemistry", "Pak Studies", "Mutaila Quran"};
+      }
+    }
+
+    return subjects;
+  }
+
+  // Write the roster as a binary snapshot. The file is built next to the
+  // target, synced, renamed over it and the directory synced, so a failed
+  // save never leaves it truncated and a true return means it is on disk.
+  bool writeSnapshot(const string &filename, uint64_t generation) {
+    vector<SnapshotStudent> students;
+    vector<SnapshotSubject> subjects;
+    vector<SnapshotYear> years;
+    string pool;
+    students.reserve(totalStudents);
+
+    auto intern = [&pool](const string &value) {
+      SnapshotString ref;
+      ref.offset = (uint32_t)pool.size();
+      ref.length = (uint32_t)value.size();
+      pool += value;
+      return ref;
+    };
+
+    for (Student *current = head; current != nullptr;
+         current = current->next) {
+      SnapshotStudent record;
+      memset(&record, 0, sizeof(record));
+      record.rollNo = intern(current->rollNo);
+      record.name = intern(current->getName());
+      record.fatherName = intern(current->getFatherName());
+      record.className = intern(current->getClassName());
+      record.classCategory = intern(current->classCategory);
+      record.dateOfBirth = intern(current->getDateOfBirth());
+      record.cnicBForm = intern(current->getCnicBForm());
+      record.address = intern(current->getAddress());
+      record.admissionYear = current->admissionYear;
+      record.currentYear = current->getCurrentYear();
+      record.termsCompleted = (uint8_t)current->getTermsCompleted();
+      record.boardMarksEntered = current->hasBoardMarks() ? 1 : 0;
+
+      record.firstSubject = (uint32_t)subjects.size();
+      for (const Subject &sub : current->record().subjects) {
+        SnapshotSubject entry;
+        entry.subjectName = intern(sub.name());
+        entry.marksStatus = intern(sub.marksStatus());
+        subjects.push_back(entry);
+      }
+      record.subjectCount = (uint32_t)subjects.size() - record.firstSubject;
+
+      record.firstYear = (uint32_t)years.size();
+      for (int year = Calendar::FIRST_YEAR; year <= Calendar::LAST_YEAR;
+           year++) {
+        SnapshotYear entry;
+        entry.year = year;
+        entry.reserved = 0;
+        if (current->record().attendance.exportYear(year, entry.marked,
+                                                    entry.present))
+          years.push_back(entry);
+      }
+      record.yearCount = (uint32_t)years.size() - record.firstYear;
+
+      students.push_back(record);
+    }
+
+    if (pool.size() > UINT32_MAX) {
+      cout << "[ERROR] Roster too large for snapshot format!\n";
+      return false;
+    }
+
+    auto align8 = [](uint64_t offset) { return (offset + 7) & ~7ULL; };
+
+    SnapshotHeader header;
+    memset(&header, 0, sizeof(header));
+    memcpy(header.magic, SNAPSHOT_MAGIC, sizeof(header.magic));
+    header.version = SNAPSHOT_VERSION;
+    header.studentCount = (uint32_t)students.size();
+    header.subjectCount = (uint32_t)subjects.size();
+    header.yearCount = (uint32_t)years.size();
+    header.studentOffset = align8(sizeof(SnapshotHeader));
+    header.subjectOffset = align8(header.studentOffset +
+                                  students.size() * sizeof(SnapshotStudent));
+    header.yearOffset = align8(header.subjectOffset +
+                               subjects.size() * sizeof(SnapshotSubject));
+    header.stringPoolOffset =
+        align8(header.yearOffset + years.size() * sizeof(SnapshotYear));
+    header.stringPoolSize = pool.size();
+    header.journalGeneration = generation;
+
+    string tempName = filename + ".tmp";
+    FILE *file = fopen(tempName.c_str(), "wb");
+    if (file == nullptr) {
+      cout << "[ERROR] Cannot open file!\n";
+      return false;
+    }
+
+    uint64_t written = 0;
+    bool ok = true;
+    auto writeSection = [&](uint64_t offset, const void *bytes, size_t size) {
+      static const char padding[8] = {0};
+      size_t gap = (size_t)(offset - written);
+      ok = ok && (gap == 0 || fwrite(padding, gap, 1, file) == 1) &&
+           (size == 0 || fwrite(bytes, size, 1, file) == 1);
+      written = offset + size;
+    };
+    writeSection(0, &header, sizeof(header));
+    writeSection(header.studentOffset, students.data(),
+                 students.size() * sizeof(SnapshotStudent));
+    writeSection(header.subjectOffset, subjects.data(),
+                 subjects.size() * sizeof(SnapshotSubject));
+    writeSection(header.yearOffset, years.data(),
+                 years.size() * sizeof(SnapshotYear));
+    writeSection(header.stringPoolOffset, pool.data(), pool.size());
+    ok = ok && syncFile(file);
+    ok = fclose(file) == 0 && ok;
+
+    if (!ok) {
+      cout << "[ERROR] Failed to write snapshot!\n";
+      remove(tempName.c_str());
+      return false;
+    }
+#ifdef _WIN32
+    remove(filename.c_str());
+#endif
+    if (rename(tempName.c_str(), filename.c_str()) != 0) {
+      cout << "[ERROR] Failed to replace " << filename << "!\n";
+      return false;
+    }
+    if (!syncDirectory(filename)) {
+      cout << "[ERROR] Cannot flush the directory of " << filename << "!\n";
+      return false;
+    }
+    return true;
+  }
+
+  // Load a binary snapshot written by writeSnapshot. Students whose roll
+  // number is already present are skipped, as with loadFromFile. Reports the
+  // journal generation the snapshot folds in through `generation`.
+  bool readSnapshot(const string &filename, uint64_t &generation) {
+    NameIndex::Bulk bulk(nameIndex); // postings built once, at the end
+    MappedFile mapped;
+    if (!mapped.open(filename)) {
+      cout << "[ERROR] Cannot open file!\n";
+      return false;
+    }
+
+    // Version 1 headers end before journalGeneration
+    const size_t V1_HEADER_SIZE = offsetof(SnapshotHeader, journalGeneration);
+    const char *base = mapped.begin();
+    size_t size = mapped.size();
+    SnapshotHeader header;
+    memset(&header, 0, sizeof(header));
+    if (size < V1_HEADER_SIZE) {
+      cout << "[ERROR] " << filename << " is not a snapshot file!\n";
+      return false;
+    }
+    memcpy(&header, base, min(size, sizeof(header)));
+    if (memcmp(header.magic, SNAPSHOT_MAGIC, sizeof(header.magic)) != 0) {
+      cout << "[ERROR] " << filename << " is not a snapshot file!\n";
+      return false;
+    }
+    if (header.version < 1 || header.version > SNAPSHOT_VERSION) {
+      cout << "[ERROR] Unsupported snapshot version " << header.version
+           << "!\n";
+      return false;
+    }
+    if (header.version < 2)
+      header.journalGeneration = 0;
+
+    auto sectionFits = [size](uint64_t offset, uint64_t count,
+                              uint64_t width) {
+      return offset % 8 == 0 && offset <= size &&
+             count <= (size - offset) / width;
+    };
+    if (!sectionFits(header.studentOffset, header.studentCount,
+                     sizeof(SnapshotStudent)) ||
+        !sectionFits(header.subjectOffset, header.subjectCount,
+                     sizeof(SnapshotSubject)) ||
+        !sectionFits(header.yearOffset, header.yearCount,
+                     sizeof(SnapshotYear)) ||
+        !sectionFits(header.stringPoolOffset, header.stringPoolSize, 1)) {
+      cout << "[ERROR] Snapshot " << filename << " is truncated or corrupt!\n";
+      return false;
+    }
+
+    const SnapshotStudent *students =
+        (const SnapshotStudent *)(base + header.studentOffset);
+    const SnapshotSubject *subjects =
+        (const SnapshotSubject *)(base + header.subjectOffset);
+    const SnapshotYear *years =
+        (const SnapshotYear *)(base + header.yearOffset);
+    const char *pool = base + header.stringPoolOffset;
+
+    bool corrupt = false;
+    auto text = [&](const SnapshotString &ref) {
+      if ((uint64_t)ref.offset + ref.length > header.stringPoolSize) {
+        corrupt = true;
+        return string();
+      }
+      return string(pool + ref.offset, ref.length);
+    };
+
+    // A class outside 1-12 would wrap in the class column, so a snapshot
+    // holding one is rejected before any student is loaded
+    for (uint32_t i = 0; i < header.studentCount; i++) {
+      string className = text(students[i].className);
+      int classNum;
+      if (corrupt) {
+        cout << "[ERROR] Snapshot " << filename
+             << " is truncated or corrupt!\n";
+        return false;
+      }
+      if (!parseNumber(className, classNum) || classNum < 1 ||
+          classNum > 12) {
+        cout << "[ERROR] Snapshot " << filename << " has a student in class '"
+             << className << "'; nothing was loaded.\n";
+        return false;
+      }
+    }
+
+    hashTable.reserve(totalStudents + header.studentCount);
+    int loadedCount = 0;
+    size_t catalogFull = 0;
+    for (uint32_t i = 0; i < header.studentCount && !corrupt; i++) {
+      const SnapshotStudent &record = students[i];
+      if ((uint64_t)record.firstSubject + record.subjectCount >
+              header.subjectCount ||
+          (uint64_t)record.firstYear + record.yearCount > header.yearCount) {
+        corrupt = true;
+        break;
+      }
+
+      string rollNo = text(record.rollNo);
+      if (corrupt || rollTaken(rollNo))
+        continue;
+
+      Student *newStudent = new (&store) Student(
+          &store, rollNo, text(record.name), text(record.fatherName),
+          text(record.className), text(record.classCategory),
+          record.admissionYear, text(record.dateOfBirth),
+          text(record.cnicBForm), text(record.address));
+      newStudent->setCurrentYear(record.currentYear);
+      newStudent->setTermsCompleted(record.termsCompleted);
+      newStudent->setBoardMarksEntered(record.boardMarksEntered != 0);
+
+      bool added = true;
+      for (uint32_t j = 0; j < record.subjectCount; j++) {
+        const SnapshotSubject &sub = subjects[record.firstSubject + j];
+        string subjectName = text(sub.subjectName);
+        string marksStatus = text(sub.marksStatus);
+        if (!corrupt && added)
+          added = newStudent->addSubject(subjectName, marksStatus);
+      }
+      for (uint32_t j = 0; j < record.yearCount; j++) {
+        const SnapshotYear &entry = years[record.firstYear + j];
+        newStudent->record().attendance.importYear(
+            entry.year, entry.marked, entry.present);
+      }
+
+      if (corrupt) {
+        delete newStudent;
+        break;
+      }
+      if (!added) {
+        delete newStudent;
+        catalogFull++;
+        continue;
+      }
+
+      linkAtTail(newStudent);
+
+      addToHashTable(newStudent);
+      totalStudents++;
+      loadedCount++;
+    }
+
+    if (corrupt) {
+      cout << "[ERROR] Snapshot " << filename
+           << " is corrupt; loading stopped early.\n";
+    }
+    if (catalogFull > 0) {
+      cout << "[ERROR] " << catalogFull << " students not loaded: "
+           << SubjectCatalog::FULL << ".\n";
+    }
+    cout << "[SUCCESS] " << loadedCount << " students loaded!\n";
+    generation = header.journalGeneration;
+    return !corrupt;
+  }
+
+  // Split a pipe-delimited line into fields
+  static void splitFields(string_view line, vector<string_view> &fields) {
+    fields.clear();
+    while (true) {
+      size_t pos = line.find('|');
+      fields.push_back(line.substr(0, pos));
+      if (pos == string_view::npos)
+        return;
+      line.remove_prefix(pos + 1);
+    }
+  }
+
+  // Field values of a student that is not yet part of the roster
+  struct StudentRecord {
+    string rollNo;
+    string name;
+    string fatherName;
+    string className;
+    string classCategory;
+    int admissionYear;
+    string dateOfBirth;
+    string cnicBForm;
+    string address;
+    vector<string> subjects;
+  };
+
+  // Category by name or by its number in the interactive menu; classes 1-7
+  // have no category
+  static string resolveCategory(int classNum, string_view value) {
+    static const char *const lower[] = {"Computer Science", "Biology"};
+    static const char *const upper[] = {"Computer Science", "Pre-Engineering",
+                                        "Pre-Medical"};
+    if (classNum <= 7)
+      return "";
+    int choice;
+    if (parseNumber(value, choice)) {
+      if (classNum <= 10 && choice >= 1 && choice <= 2)
+        return lower[choice - 1];
+      if (classNum >= 11 && choice >= 1 && choice <= 3)
+        return upper[choice - 1];
+    }
+    return string(value);
+  }
+
+  // Validate one student's fields into `record`. The fields are
+  //   roll, name, father, class, category, admissionYear, dob, cnic, address,
+  //   subjects (classes 1-7 only, split on subjectSeparator)
+  // Returns false with a reason in `error` when a field is invalid. Touches
+  // no roster state, so bulk import calls it from worker threads.
+  bool parseStudent(const string_view *fields, size_t count,
+                    char subjectSeparator, StudentRecord &record,
+                    string &error) {
+    auto field = [fields, count](size_t i) {
+      return i < count ? string(fields[i]) : string();
+    };
+    if (count < 6) {
+      error = "expected at least 6 fields";
+      return false;
+    }
+
+    string rollNo = field(0);
+    if (rollNo.empty() || fields[1].empty() || fields[2].empty()) {
+      error = "roll, name and father's name are required";
+      return false;
+    }
+
+    int classNum;
+    if (!parseNumber(fields[3], classNum) || classNum < 1 || classNum > 12) {
+      error = "class must be 1-12";
+      return false;
+    }
+    string className = to_string(classNum);
+
+    string classCategory;
+    vector<string> subjects;
+    if (classNum <= 7) {
+      string_view list = count > 9 ? fields[9] : string_view();
+      while (!list.empty()) {
+        size_t pos = list.find(subjectSeparator);
+        if (!list.substr(0, pos).empty())
+          subjects.push_back(string(list.substr(0, pos)));
+        list.remove_prefix(pos == string_view::npos ? list.size() : pos + 1);
+      }
+      if (subjects.empty()) {
+        error = "at least 1 subject required";
+        return false;
+      }
+    } else {
+      classCategory = resolveCategory(classNum, fields[4]);
+      subjects = getSubjectsForClass(className, classCategory);
+      if (subjects.empty()) {
+        error = "invalid category for class " + className;
+        return false;
+      }
+    }
+
+    if (!validateYear(field(5))) {
+      error = "admission year must be 1900-2100";
+      return false;
+    }
+    string dob = field(6);
+    string cnic = field(7);
+    if ((!dob.empty() && !validateDOB(dob)) ||
+        (!cnic.empty() && !validateCNIC(cnic))) {
+      error = "dob must be DDMMYYYY and cnic 13 digits";
+      return false;
+    }
+
+    record.rollNo = rollNo;
+    record.name = field(1);
+    record.fatherName = field(2);
+    record.className = className;
+    record.classCategory = classCategory;
+    record.admissionYear = stoi(field(5));
+    record.dateOfBirth = dob.empty() ? "" : formatDOB(dob);
+    record.cnicBForm = cnic.empty() ? "" : formatCNIC(cnic);
+    record.address = field(8);
+    record.subjects.swap(subjects);
+    return true;
+  }
+
+  // nullptr if the subject catalog is full
+  Student *createStudent(const StudentRecord &record) {
+    Student *newStudent = new (&store) Student(
+        &store, record.rollNo, record.name, record.fatherName,
+        record.className, record.classCategory, record.admissionYear,
+        record.dateOfBirth, record.cnicBForm, record.address);
+    for (const string &sub : record.subjects) {
+      if (!newStudent->addSubject(sub, "-")) {
+        delete newStudent;
+        return nullptr;
+      }
+    }
+    return newStudent;
+  }
+
+  // ADD|roll|name|father|class|category|admissionYear|dob|cnic|address|subjects
+  BatchStatus batchAdd(const vector<string_view> &fields, string &detail) {
+    if (fields.size() < 7) {
+      detail = "usage: ADD|roll|name|father|class|category|admissionYear"
+               "[|dob|cnic|address|subjects]";
+      return BATCH_INVALID;
+    }
+    if (!fields[1].empty() && rollTaken(string(fields[1]))) {
+      detail = "roll " + string(fields[1]);
+      return BATCH_DUPLICATE;
+    }
+
+    StudentRecord record;
+    if (!parseStudent(fields.data() + 1, fields.size() - 1, ',', record,
+                      detail))
+      return BATCH_INVALID;
+    Student *holder = cnicHolder(record.cnicBForm);
+    if (holder != nullptr) {
+      detail = "cnic " + record.cnicBForm + " held by roll " + holder->rollNo;
+      return BATCH_DUPLICATE;
+    }
+    Student *newStudent = createStudent(record);
+    if (newStudent == nullptr) {
+      detail = SubjectCatalog::FULL;
+      return BATCH_FAILED;
+    }
+    insertStudent(newStudent);
+    logAddStudent(newStudent);
+    return BATCH_OK;
+  }
+
+  // Split one CSV line into fields. Fields may be quoted, with "" standing
+  // for a literal quote; quoted fields cannot span lines.
+  static bool splitCSV(string_view line, vector<string> &fields) {
+    fields.clear();
+    size_t i = 0;
+    while (true) {
+      string value;
+      if (i < line.size() && line[i] == '"') {
+        i++;
+        while (true) {
+          if (i >= line.size())
+            return false; // unterminated quote
+          if (line[i] == '"') {
+            if (i + 1 < line.size() && line[i + 1] == '"') {
+              value += '"';
+              i += 2;
+              continue;
+            }
+            i++;
+            break;
+          }
+          value += line[i++];
+        }
+        if (i < line.size() && line[i] != ',')
+          return false; // text after closing quote
+      } else {
+        size_t pos = line.find(',', i);
+        size_t length = pos == string_view::npos ? string_view::npos : pos - i;
+        value = string(line.substr(i, length));
+        i = pos == string_view::npos ? line.size() : pos;
+      }
+      fields.push_back(value);
+      if (i >= line.size())
+        return true;
+      i++; // skip the comma
+    }
+  }
+
+  // MARKS|roll|m1,m2,...[|Y]  (an empty entry keeps the current marks)
+  BatchStatus batchMarks(Student *student, const vector<string_view> &fields,
+                         string &detail) {
+    if (fields.size() < 3) {
+      detail = "usage: MARKS|roll|m1,m2,...[|Y/N]";
+      return BATCH_INVALID;
+    }
+    vector<string> statuses;
+    string_view list = fields[2];
+    for (const Subject &current : student->record().subjects) {
+      size_t pos = list.find(',');
+      string marks(list.substr(0, pos));
+      list.remove_prefix(pos == string_view::npos ? list.size() : pos + 1);
+      if (marks.empty()) {
+        statuses.push_back(current.marksStatus());
+        continue;
+      }
+      int maxMarksForSub = student->getMaxMarksForSubject(current);
+      if (!validateMarks(marks, maxMarksForSub)) {
+        detail = "invalid marks '" + marks + "' for " + current.name();
+        return BATCH_INVALID;
+      }
+      statuses.push_back(marks);
+    }
+    if (!list.empty()) {
+      detail = "more marks than subjects";
+      return BATCH_INVALID;
+    }
+
+    bool boardMarks = student->hasBoardMarks();
+    int classNum = student->getClassNumber();
+    if (classNum >= 8 && classNum <= 12 && fields.size() > 3 &&
+        (fields[3] == "Y" || fields[3] == "y"))
+      boardMarks = true;
+
+    if (!applyMarks(student, statuses, boardMarks)) {
+      detail = SubjectCatalog::FULL;
+      return BATCH_FAILED;
+    }
+    logMarks(student);
+    return BATCH_OK;
+  }
+
+  // ATTEND|roll|YYYY-MM-DD|P/A
+  BatchStatus batchAttend(Student *student, const vector<string_view> &fields,
+                          string &detail) {
+    int year, month, day;
+    string_view date = fields.size() > 2 ? fields[2] : string_view();
+    if (fields.size() < 4 || date.size() != 10 || date[4] != '-' ||
+        date[7] != '-' || !parseNumber(date.substr(0, 4), year) ||
+        !parseNumber(date.substr(5, 2), month) ||
+        !parseNumber(date.substr(8, 2), day) ||
+        (fields[3] != "P" && fields[3] != "A" && fields[3] != "p" &&
+         fields[3] != "a")) {
+      detail = "usage: ATTEND|roll|YYYY-MM-DD|P/A";
+      return BATCH_INVALID;
+    }
+    bool present = fields[3] == "P" || fields[3] == "p";
+    if (!recordAttendance(student, year, month, day, present)) {
+      detail = "date must be a valid day in 2024-2034";
+      return BATCH_INVALID;
+    }
+    logAttendance(student, year, month, day, present);
+    return BATCH_OK;
+  }
+
+  // STATS: allocation counts and bytes held by the roster
+  string memoryStats() {
+    auto pool = [](const char *label, const BlockPool &blocks) {
+      BlockPool::Stats stats = blocks.stats();
+      return string(label) + "=" + to_string(stats.liveBlocks) + "/" +
+             to_string(stats.allocations) + "x" + to_string(stats.blockSize) +
+             "B," + to_string(stats.slabs) + "slabs";
+    };
+    size_t slabs = store.studentBlocks.stats().slabs +
+                   store.recordBlocks.stats().slabs +
+                   store.yearBlocks.stats().slabs;
+    return "students=" + to_string(totalStudents) + " " +
+           pool("studentPool", store.studentBlocks) + " " +
+           pool("recordPool", store.recordBlocks) + " " +
+           pool("yearPool", store.yearBlocks) +
+           " slabBytes=" + to_string(slabs * BlockPool::SLAB_BYTES) +
+           " columnBytes=" + to_string(store.columnBytes()) +
+           " arenaBytes=" + to_string(store.arenaBytes()) +
+           " deadArenaBytes=" + to_string(store.deadArenaBytes());
+  }
+
+  enum PromotionDecision { SKIP, NOT_TIME, NOT_ELIGIBLE, PROMOTE };
+
+  // Month in which the session of a class starts, 0 for an unknown class
+  static int sessionStartMonth(int classNum) {
+    if (classNum >= 1 && classNum <= 7) {
+      // Classes 1-7: Papers in February, new session starts in March
+      return 3;
+    } else if (classNum >= 8 && classNum <= 10) {
+      // Classes 8-10: Papers in February/March, new session in April
+      return 4;
+    } else if (classNum >= 11 && classNum <= 12) {
+      // Classes 11-12: Papers in May/June, new session in June/July
+      return 6;
+    }
+    return 0;
+  }
+
+  // Whether the new session of a class has started in `month`
+  static bool isPromotionTime(int classNum, int month) {
+    int start = sessionStartMonth(classNum);
+    return start != 0 && month >= start;
+  }
+
+  enum AttendanceScope { MONTH, TERM, SESSION };
+
+  // First and last day number of the month, term or session of a class
+  // that `day` falls in. A session is the twelve months from the class's
+  // start month; its three terms are four months each.
+  static void attendanceRange(int classNum, int32_t day, AttendanceScope scope,
+                              int32_t &from, int32_t &to) {
+    int year, month, date;
+    Calendar::fromDayNumber(day, year, month, date);
+    int start = sessionStartMonth(classNum);
+    int elapsed = (month - (start == 0 ? 1 : start) + 12) % 12;
+    int back = 0, length = 1;
+    if (scope == TERM) {
+      back = elapsed % 4;
+      length = 4;
+    } else if (scope == SESSION) {
+      back = elapsed;
+      length = 12;
+    }
+    int first = year * 12 + (month - 1) - back; // months since year 0
+    from = Calendar::dayNumber(first / 12, first % 12 + 1, 1);
+    int next = first + length;
+    to = Calendar::dayNumber(next / 12, next % 12 + 1, 1) - 1;
+  }
+
+  // Promote every eligible student whose new session has started, or only
+  // those of one class (and category, when not empty) if classNum is set.
+  // The rollover runs in phases:
+  //   1. decide every outcome from the hot columns, in parallel
+  //   2. one walk in the serial order (roster, or class members) that
+  //      journals promotions, unfiles them from their class group and
+  //      buffers the report
+  //   3. promote the students, in parallel; each touches only itself
+  //   4. file them under their new class
+  // The report, when one is given, is written in one piece at the end.
+  void promoteStudents(int &promoted, int &notEligible, ostream *report,
+                       int classNum = 0, const string &category = "") {
+    const size_t BLOCK = 1 << 14;
+    // Check current date to determine if it's promotion time
+    int currentYear, currentMonth, currentDay;
+    getCurrentDate(currentYear, currentMonth, currentDay);
+
+    vector<Student *> scope;
+    if (classNum != 0)
+      scope = classMembers(classNum, category);
+    size_t count = classNum == 0 ? store.slotCount() : scope.size();
+
+    // Phase 1: outcome per slot
+    vector<uint8_t> decisions(store.slotCount(), SKIP);
+    parallelFor((count + BLOCK - 1) / BLOCK, [&](size_t block) {
+      size_t last = min(count, (block + 1) * BLOCK);
+      for (size_t i = block * BLOCK; i < last; i++) {
+        uint32_t slot = classNum == 0 ? (uint32_t)i : scope[i]->getSlot();
+        int currentClass = store.classNumber[slot];
+        if (store.owner[slot] == nullptr || currentClass >= 12)
+          continue;
+        if (!isPromotionTime(currentClass, currentMonth))
+          decisions[slot] = NOT_TIME;
+        else if (store.canBePromoted(slot))
+          decisions[slot] = PROMOTE;
+        else
+          decisions[slot] = NOT_ELIGIBLE;
+      }
+    });
+
+    // Phase 2: journal and report in the order a serial walk visits
+    ostringstream buffer;
+    map<int, int> waiting; // class -> students whose session has not started
+    vector<Student *> toPromote;
+    auto visit = [&](Student *current) {
+      uint8_t decision = decisions[current->getSlot()];
+      if (decision == PROMOTE) {
+        removeFromClassIndex(current);
+        logRollOnly(Journal::PROMOTE_STUDENT, current->rollNo);
+        toPromote.push_back(current);
+      } else if (decision == NOT_TIME) {
+        waiting[current->getClassNumber()]++;
+      } else if (decision == NOT_ELIGIBLE) {
+        notEligible++;
+        if (report != nullptr) {
+          buffer << "[INFO] Student " << current->getName()
+                 << " (Roll: " << current->rollNo
+                 << ") cannot be promoted yet.\n";
+          buffer << "  - Terms completed: " << current->getTermsCompleted()
+                 << "/3\n";
+          buffer << "  - Board marks entered: "
+                 << (current->hasBoardMarks() ? "Yes" : "No") << "\n";
+          buffer << "  - Percentage calculated: "
+                 << (current->getPercentage() > 0 ? "Yes" : "No") << "\n";
+        }
+      }
+    };
+    if (classNum == 0) {
+      for (Student *current = head; current != nullptr;
+           current = current->next)
+        visit(current);
+    } else {
+      for (Student *current : scope)
+        visit(current);
+    }
+
+    // Phase 3: the promotions themselves
+    parallelFor((toPromote.size() + BLOCK - 1) / BLOCK, [&](size_t block) {
+      size_t last = min(toPromote.size(), (block + 1) * BLOCK);
+      for (size_t i = block * BLOCK; i < last; i++) {
+        beforeChange(toPromote[i]);
+        toPromote[i]->promoteToNextClass();
+      }
+    });
+
+    // Phase 4: file under the new class
+    for (Student *student : toPromote) {
+      addToClassIndex(student);
+      meritIndex.refresh(student);
+    }
+    promoted += (int)toPromote.size();
+
+    if (report != nullptr) {
+      for (const pair<const int, int> &entry : waiting) {
+        buffer << "[INFO] It's not promotion time for class " << entry.first
+               << " yet (" << entry.second << " students).\n";
+      }
+      *report << buffer.str();
+    }
+  }
+
+  // Append a student's scored marks to `columns`; nullptr appends an empty
+  // entry for a free slot
+  static void gatherMarks(MarksColumns &columns, const Student *student) {
+    uint32_t offset = (uint32_t)columns.marks.size();
+    if (student != nullptr) {
+      for (const Subject &sub : student->record().subjects) {
+        if (!sub.scored())
+          continue;
+        columns.marks.push_back(sub.marks());
+        columns.maxMarks.push_back(
+            (float)student->getMaxMarksForSubject(sub));
+      }
+    }
+    columns.offset.push_back(offset);
+    columns.count.push_back((uint32_t)columns.marks.size() - offset);
+  }
+
+  // One line of the students.txt format
+  void writeRecord(ostream &file, Student *current) {
+    const RecordVersion &record = current->record();
+    file << current->rollNo << "|" << current->getName() << "|"
+         << current->getFatherName() << "|" << current->getClassName() << "|"
+         << current->classCategory << "|" << current->admissionYear << "|"
+         << current->getCurrentYear() << "|" << current->getDateOfBirth() << "|"
+         << current->getCnicBForm() << "|" << current->getAddress() << "|"
+         << record.subjects.size() << "|"
+         << (int)record.summary.termsCompleted << "|"
+         << (record.summary.boardMarks ? "1" : "0") << "|";
+
+    bool first = true;
+    for (const Subject &sub : record.subjects) {
+      if (!first)
+        file << ",";
+      file << sub.name() << ":" << sub.marksStatus();
+      first = false;
+    }
+    file << "|";
+
+    // Save attendance data
+    record.attendance.forEachMarked(
+        [&](int year, int month, int day, bool present) {
+          file << Calendar::getDateKey(year, month, day) << ":"
+               << (present ? "P" : "A") << ",";
+        });
+  }
+
+  // Roster list maintenance, including the class index; both are O(1)
+  void linkAtTail(Student *student) {
+    addToClassIndex(student);
+    nameIndex.add(student->getSlot(), student->getName(),
+                  student->getFatherName());
+    meritIndex.insert(student);
+    uint64_t key;
+    if (store.cnicKey(student->getSlot(), key))
+      cnicIndex.add(student, key);
+    if (rollCall.isActive())
+      fileAttendance(student, true);
+    store.listOrder[student->getSlot()] = nextListOrder++;
+    student->prev = tail;
+    student->next = nullptr;
+    if (tail == nullptr)
+      head = student;
+    else
+      tail->next = student;
+    tail = student;
+  }
+
+  void unlink(Student *student) {
+    removeFromClassIndex(student);
+    nameIndex.remove(student->getSlot());
+    {
+      lock_guard<mutex> hold(meritLock);
+      meritIndex.remove(student);
+    }
+    uint64_t key;
+    if (store.cnicKey(student->getSlot(), key))
+      cnicIndex.remove(student, key);
+    if (rollCall.isActive()) {
+      lock_guard<mutex> hold(rollCallLock);
+      fileAttendance(student, false);
+    }
+    if (student->prev == nullptr)
+      head = student->next;
+    else
+      student->prev->next = student->next;
+    if (student->next == nullptr)
+      tail = student->prev;
+    else
+      student->next->prev = student->prev;
+    student->prev = student->next = nullptr;
+  }
+
+  // Student already enrolled with this CNIC/B-Form (in any format), or
+  // nullptr
+  Student *cnicHolder(const string &cnic) {
+    uint64_t key;
+    if (!StudentStore::normalizeCnic(cnic, key))
+      return nullptr;
+    return cnicIndex.find(key);
+  }
+
+  // Append a new student to the roster; fails if the roll number is taken
+  bool insertStudent(Student *student) {
+    if (!hashTable.insert(student))
+      return false;
+    linkAtTail(student);
+    totalStudents++;
+    return true;
+  }
+
+  // Record operation. The student leaves its shard first, so no new
+  // reader or writer can reach it, then the roster structures. The object
+  // itself is retired and destroyed once no reader can still hold it.
+  bool removeStudent(const string &rollNo) {
+    EpochDomain::Section section(epochs);
+    RollShards::Shard &shard = hashTable.shardOf(rollNo);
+    Student *toDelete;
+    {
+      lock_guard<mutex> hold(shard.lock);
+      toDelete = shard.index.find(rollNo);
+      if (toDelete == nullptr)
+        return false;
+      beforeChange(toDelete);
+      shard.index.erase(rollNo);
+    }
+    if (archive.isOpen())
+      archive.withdraw(rollNo); // or the archived row would come back
+    {
+      lock_guard<mutex> hold(structureLock);
+      unlink(toDelete);
+      totalStudents--;
+    }
+    epochs.retire([toDelete] { delete toDelete; });
+    return true;
+  }
+
+  // Replace every subject's marks status and recompute the totals. False,
+  // changing nothing, if the subject catalog has no room for a marks text.
+  bool applyMarks(Student *student, const vector<string> &statuses,
+                  bool boardMarks) {
+    const SubjectList &subjects = student->record().subjects;
+    size_t count = min(subjects.size(), statuses.size());
+    vector<Subject> updated(subjects.begin(), subjects.begin() + count);
+    for (size_t i = 0; i < count; i++) {
+      if (!updated[i].setStatus(statuses[i]))
+        return false;
+    }
+    beforeChange(student);
+    changeRecord(student, 0, [&](RecordVersion &version) {
+      copy(updated.begin(), updated.end(), version.subjects.begin());
+      student->recalculateMarks(version);
+      student->setBoardMarksEntered(boardMarks, version);
+    });
+    lock_guard<mutex> hold(meritLock);
+    meritIndex.refresh(student);
+    return true;
+  }
+
+  // Change the student's record: in place when this thread holds the
+  // roster, which keeps readers out, and otherwise on a copy that shares
+  // the attendance bits of every year but `year` (0 for none). The copy is
+  // published once `change` returns and the version it replaces retired;
+  // that version keeps only its own bits of `year`. The caller holds the
+  // student's shard or the roster, so writers of one student take turns.
+  template <typename Change>
+  void changeRecord(Student *student, int year, Change change) {
+    if (epochs.exclusive()) {
+      change(student->record());
+      return;
+    }
+    RecordVersion *next = student->copyRecord(year);
+    change(*next);
+    RecordVersion *old = student->publish(next);
+    epochs.retire([old, year] {
+      old->attendance.forget(year);
+      delete old;
+    });
+  }
+
+  // Copy a student's record from one version of it
+  void fillView(Student *student, StudentView &view) {
+    const RecordVersion &record = student->record();
+    view.rollNo = student->rollNo;
+    view.name = student->getName();
+    view.fatherName = student->getFatherName();
+    view.category = student->classCategory;
+    view.dateOfBirth = student->getDateOfBirth();
+    view.cnicBForm = student->getCnicBForm();
+    view.address = student->getAddress();
+    view.classNum = student->getClassNumber();
+    view.admissionYear = student->admissionYear;
+    view.currentYear = student->getCurrentYear();
+    view.termsCompleted = record.summary.termsCompleted;
+    view.boardMarks = record.summary.boardMarks;
+    view.subjects.assign(record.subjects.begin(), record.subjects.end());
+    view.totalMarks = record.summary.totalMarks;
+    view.maxMarks = record.summary.maxMarks;
+    view.percentage = record.summary.percentage;
+    view.grade = record.summary.grade;
+    view.daysMarked = record.attendance.getTotalDays();
+    view.daysPresent = record.attendance.getTotalPresent();
+    int present[3], marked[3];
+    termAttendance(view.classNum, record.attendance, today(), present,
+                   marked);
+    view.termPresent = present[1];
+    view.termMarked = marked[1];
+    view.sessionPresent = present[2];
+    view.sessionMarked = marked[2];
+  }
+
+  // Run `read` on the student with this roll number (nullptr if there is
+  // none) without taking a lock. The caller's epoch section keeps the
+  // student and any version of its record alive, and writers never change
+  // a version readers can reach, so `read` takes the record from one
+  // Student::record() and must not change anything.
+  template <typename Read> void readStudent(const string &rollNo, Read read) {
+    read(hashTable.find(rollNo));
+  }
+
+  // Run `write` on the student with this roll number with its shard held
+  // exclusively; false if there is none
+  template <typename Write>
+  bool writeStudent(const string &rollNo, Write write) {
+    RollShards::Shard &shard = hashTable.shardOf(rollNo);
+    lock_guard<mutex> hold(shard.lock);
+    Student *student = shard.index.find(rollNo);
+    if (student == nullptr)
+      return false;
+    write(student);
+    return true;
+  }
+
+  // Journal writes made by the command running on this thread. Batch and
+  // server mode hold its response until they are synced, and answer FAILED
+  // if one could not be written.
+  struct JournalWrites {
+    size_t appended = 0;
+    bool failed = false;
+  };
+
+  static JournalWrites &journalWrites() {
+    thread_local JournalWrites writes;
+    return writes;
+  }
+
+  void logRecord(Journal::Record &record) {
+    if (journal.append(record))
+      journalWrites().appended++;
+    else
+      journalWrites().failed = true;
+  }
+
+  // Start counting the journal writes of a command
+  static void beginJournalWrites() { journalWrites() = JournalWrites(); }
+
+  // After a command: turn a failed journal write into its status, since
+  // the change is made in memory but would be lost in a crash. True if the
+  // command logged changes that still have to be synced before its
+  // response goes out.
+  static bool endJournalWrites(BatchStatus &status, string &detail) {
+    const JournalWrites &writes = journalWrites();
+    if (writes.failed) {
+      status = BATCH_FAILED;
+      detail = "journal write failed; SNAPSHOT saves the change";
+      return false;
+    }
+    return writes.appended > 0 && status == BATCH_OK;
+  }
+
+  // Journal records for each mutation. These are no-ops until openJournal
+  // has run, so replaying the journal does not log it again.
+  void logAddStudent(Student *student) {
+    Journal::Record record(Journal::ADD_STUDENT);
+    record.putString(student->rollNo);
+    record.putString(student->getName());
+    record.putString(student->getFatherName());
+    record.putString(student->getClassName());
+    record.putString(student->classCategory);
+    record.putInt(student->admissionYear);
+    record.putString(student->getDateOfBirth());
+    record.putString(student->getCnicBForm());
+    record.putString(student->getAddress());
+    record.putInt((int)student->record().subjects.size());
+    for (const Subject &sub : student->record().subjects)
+      record.putString(sub.name());
+    logRecord(record);
+  }
+
+  void logMarks(Student *student) {
+    Journal::Record record(Journal::UPDATE_MARKS);
+    record.putString(student->rollNo);
+    record.putInt((int)student->record().subjects.size());
+    for (const Subject &sub : student->record().subjects)
+      record.putString(sub.marksStatus());
+    record.putInt(student->hasBoardMarks() ? 1 : 0);
+    logRecord(record);
+  }
+
+  void logAttendance(Student *student, int year, int month, int day,
+                     bool present) {
+    Journal::Record record(Journal::MARK_ATTENDANCE);
+    record.putString(student->rollNo);
+    record.putInt(year);
+    record.putInt(month);
+    record.putInt(day);
+    record.putInt(present ? 1 : 0);
+    logRecord(record);
+  }
+
+  void logRollOnly(Journal::Op op, const string &rollNo) {
+    Journal::Record record(op);
+    record.putString(rollNo);
+    logRecord(record);
+  }
+
+  void logTerms(Student *student) {
+    Journal::Record record(Journal::UPDATE_TERMS);
+    record.putString(student->rollNo);
+    record.putInt(student->getTermsCompleted());
+    logRecord(record);
+  }
+
+  void replayRecord(Journal::Op op, Journal::Reader &in) {
+    if (op == Journal::OPEN_ARCHIVE) {
+      string filename = in.getString();
+      int capacity = in.getInt();
+      if (in.ok())
+        attachArchive(filename, (size_t)max(0, capacity));
+      return;
+    }
+
+    string rollNo = in.getString();
+    if (op == Journal::ADD_STUDENT) {
+      string name = in.getString();
+      string fatherName = in.getString();
+      string className = in.getString();
+      string classCategory = in.getString();
+      int admissionYear = in.getInt();
+      string dob = in.getString();
+      string cnic = in.getString();
+      string address = in.getString();
+      int subjectCount = in.getInt();
+      Student *student =
+          new (&store) Student(&store, rollNo, name, fatherName, className,
+                               classCategory, admissionYear, dob, cnic,
+                               address);
+      bool added = true;
+      for (int i = 0; i < subjectCount && in.ok() && added; i++)
+        added = student->addSubject(in.getString(), "-");
+      if (!in.ok() || !added || !insertStudent(student))
+        delete student;
+      return;
+    }
+
+    Student *student = searchInHashTable(rollNo);
+    if (student == nullptr || !in.ok())
+      return;
+
+    if (op == Journal::UPDATE_MARKS) {
+      int count = in.getInt();
+      vector<string> statuses;
+      for (int i = 0; i < count && in.ok(); i++)
+        statuses.push_back(in.getString());
+      bool boardMarks = in.getInt() != 0;
+      if (in.ok())
+        applyMarks(student, statuses, boardMarks);
+    } else if (op == Journal::MARK_ATTENDANCE) {
+      int year = in.getInt();
+      int month = in.getInt();
+      int day = in.getInt();
+      bool present = in.getInt() != 0;
+      if (in.ok())
+        recordAttendance(student, year, month, day, present);
+    } else if (op == Journal::UPDATE_TERMS) {
+      int terms = in.getInt();
+      if (in.ok()) {
+        beforeChange(student);
+        student->setTermsCompleted(terms);
+      }
+    } else if (op == Journal::DELETE_STUDENT) {
+      removeStudent(rollNo);
+    } else if (op == Journal::PROMOTE_STUDENT) {
+      promoteStudent(student);
+    }
+  }
+
+public:
+  StudentManager() {
+    head = nullptr;
+    tail = nullptr;
+    totalStudents = 0;
+    journalGeneration = 0;
+    nextListOrder = 0;
+    savingGeneration = 0;
+    lastSaveGeneration = 0;
+    archiveCapacity = ARCHIVE_CACHE;
+  }
+
+  // Restore the roster from the last snapshot plus the journal written since,
+  // then keep the journal open so every further change is logged
+  void openJournal(string snapshotFile, string journalFile) {
+    NameIndex::Bulk bulk(nameIndex); // postings built once, at the end
+    snapshotPath = snapshotFile;
+    ifstream probe(snapshotFile, ios::binary);
+    if (probe.is_open()) {
+      probe.close();
+      readSnapshot(snapshotFile, journalGeneration);
+    }
+
+    long replayed = Journal::replay(
+        journalFile, journalGeneration,
+        [this](Journal::Op op, Journal::Reader &in) { replayRecord(op, in); });
+    if (replayed < 0) {
+      cout << "[ERROR] " << journalFile
+           << " is not a journal file; changes will not be logged.\n";
+      return;
+    }
+    if (replayed > 0) {
+      cout << "[INFO] Replayed " << replayed << " journal records from "
+           << journalFile << ".\n";
+    }
+    trimArchiveCache();
+
+    if (!journal.open(journalFile, journalGeneration)) {
+      cout << "[ERROR] Cannot open " << journalFile
+           << "; changes will not be logged.\n";
+    }
+  }
+
+  // Fold the journal into a fresh snapshot and start an empty journal. The
+  // journal is only reset once the snapshot is durable under its final
+  // name; until then a crash recovers from the old snapshot plus journal.
+  bool compactJournal() {
+    if (!journal.isOpen())
+      return saveSnapshot(snapshotPath.empty() ? "students.dat"
+                                               : snapshotPath);
+    journal.sync();
+    if (!writeSnapshot(snapshotPath, journalGeneration + 1))
+      return false;
+    journalGeneration++;
+    if (!journal.reset(journalGeneration)) {
+      cout << "[ERROR] Cannot start a new journal; changes will not be "
+              "logged.\n";
+      return false;
+    }
+    cout << "[SUCCESS] Snapshot of " << totalStudents
+         << " students saved to " << snapshotPath << "; journal compacted.\n";
+    return true;
+  }
+
+  // Force any batched journal records to disk. False if the journal has
+  // failed and changes are no longer logged.
+  bool syncJournal() { return journal.sync(); }
+
+  void addStudent() {
+    cout << "\n--- Adding Student ---\n";
+
+    string rollNo = getValidInput("Enter Roll Number", false);
+    if (rollTaken(rollNo)) {
+      cout << "[ERROR] Roll number already exists!\n";
+      return;
+    }
+
+    string name = getValidInput("Enter Name", false);
+    string fatherName = getValidInput("Enter Father's Name", false);
+    string className =
+        getValidInput("Enter Class (1-12)", false, validateClass);
+
+    string classCategory = "";
+    vector<string> subjects;
+
+    int classNum = stoi(className);
+
+    if (classNum >= 1 && classNum <= 7) {
+      string numStr = getValidInput("How many subjects? (minimum 1)", false);
+      int numSubjects = stoi(numStr);
+
+      if (numSubjects < 1) {
+        cout << "[ERROR] At least 1 subject required!\n";
+        return;
+      }
+
+      for (int i = 0; i < numSubjects; i++) {
+        string subName =
+            getValidInput("Subject " + to_string(i + 1) + " Name", false);
+        subjects.push_back(subName);
+      }
+    } else if (classNum >= 8 && classNum <= 12) {
+      cout << "\nSelect Category:\n";
+      if (classNum >= 8 && classNum <= 10) {
+        cout << "1. Computer Science\n2. Biology\n";
+      } else {
+        cout << "1. Computer Science\n2. Pre-Engineering\n3. Pre-Medical\n";
+      }
+
+      string choiceStr = getValidInput("Enter choice", false);
+      int choice = stoi(choiceStr);
+
+      if (classNum >= 8 && classNum <= 10) {
+        if (choice == 1)
+          classCategory = "Computer Science";
+        else if (choice == 2)
+          classCategory = "Biology";
+      } else {
+        if (choice == 1)
+          classCategory = "Computer Science";
+        else if (choice == 2)
+          classCategory = "Pre-Engineering";
+        else if (choice == 3)
+          classCategory = "Pre-Medical";
+      }
+
+      subjects = getSubjectsForClass(className, classCategory);
+    }
+
+    string admissionYearStr =
+        getValidInput("Enter Admission Year", false, validateYear);
+    int admissionYear = stoi(admissionYearStr);
+
+    string dob =
+        getValidInput("Enter Date of Birth (DDMMYYYY)", true, validateDOB);
+    string formattedDOB = dob.empty() ? "" : formatDOB(dob);
+
+    string cnic =
+        getValidInput("Enter CNIC/B-Form (13 digits)", true, validateCNIC);
+    string formattedCNIC = cnic.empty() ? "" : formatCNIC(cnic);
+    Student *holder = cnicHolder(cnic);
+    if (holder != nullptr) {
+      cout << "[ERROR] CNIC/B-Form already enrolled under roll number "
+           << holder->rollNo << "!\n";
+      return;
+    }
+
+    string address = getValidInput("Enter Address", true);
+
+    Student *newStudent = new (&store)
+        Student(&store, rollNo, name, fatherName, className, classCategory,
+                admissionYear, formattedDOB, formattedCNIC, address);
+
+    for (const string &sub : subjects) {
+      if (!newStudent->addSubject(sub, "-")) {
+        cout << "[ERROR] Student not added: " << SubjectCatalog::FULL
+             << "!\n";
+        delete newStudent;
+        return;
+      }
+    }
+
+    insertStudent(newStudent);
+    logAddStudent(newStudent);
+
+    cout << "[SUCCESS] Student added successfully!\n";
+    cout << "Total students: " << totalStudents << "\n";
+  }
+
+  // Mark every listed student present or absent on one date, each
+  // journaled as its own attendance mark. Returns false, marking nobody,
+  // if the date falls outside the calendar range.
+  bool markAttendanceFor(const vector<Student *> &students, int year,
+                         int month, int day, bool present) {
+    if (year < Calendar::FIRST_YEAR || year > Calendar::LAST_YEAR ||
+        !Calendar::isValidDate(year, month, day))
+      return false;
+    for (Student *student : students) {
+      recordAttendance(student, year, month, day, present);
+      logAttendance(student, year, month, day, present);
+    }
+    return true;
+  }
+
+  // Students marked on a day, split into present and absent and sorted by
+  // roll number. Limited to one class (and category, when not empty) unless
+  // classNum is 0. Read from the date-major roll call.
+  void attendanceOn(int32_t day, int classNum, const string &category,
+                    vector<Student *> &present, vector<Student *> &absent) {
+    ensureRollCall();
+    present.clear();
+    absent.clear();
+    rollCall.forEachMarked(day, [&](uint32_t slot, bool here) {
+      Student *student = store.owner[slot];
+      if (student == nullptr ||
+          (classNum != 0 && store.classNumber[slot] != classNum) ||
+          (!category.empty() && student->classCategory != category))
+        return;
+      (here ? present : absent).push_back(student);
+    });
+    auto byRoll = [](Student *a, Student *b) { return a->rollNo < b->rollNo; };
+    sort(present.begin(), present.end(), byRoll);
+    sort(absent.begin(), absent.end(), byRoll);
+  }
+
+  // Split a comma-separated list of roll numbers, dropping spaces around
+  // each entry and empty entries
+  static vector<string> splitRolls(string_view list) {
+    vector<string> rolls;
+    while (!list.empty()) {
+      size_t comma = list.find(',');
+      string_view roll = list.substr(0, comma);
+      list.remove_prefix(comma == string_view::npos ? list.size() : comma + 1);
+      while (!roll.empty() && roll.front() == ' ')
+        roll.remove_prefix(1);
+      while (!roll.empty() && roll.back() == ' ')
+        roll.remove_suffix(1);
+      if (!roll.empty())
+        rolls.emplace_back(roll);
+    }
+    return rolls;
+  }
+
+  // Record operations: safe to call from many threads at once (see the
+  // members). Each returns false if there is no such student.
+  bool lookupStudent(const string &rollNo, StudentView &view) {
+    EpochDomain::Section section(epochs);
+    bool found = false;
+    readStudent(rollNo, [&](Student *student) {
+      found = student != nullptr;
+      if (found)
+        fillView(student, view);
+    });
+    return found;
+  }
+
+  bool countAttendance(const string &rollNo, int &marked, int &present) {
+    EpochDomain::Section section(epochs);
+    bool found = false;
+    readStudent(rollNo, [&](Student *student) {
+      found = student != nullptr;
+      if (found) {
+        const Calendar &attendance = student->record().attendance;
+        marked = attendance.getTotalDays();
+        present = attendance.getTotalPresent();
+      }
+    });
+    return found;
+  }
+
+  // `statuses` holds one marks status per subject, as in updateMarks. False
+  // if the student is not found or the subject catalog is full.
+  bool setMarks(const string &rollNo, const vector<string> &statuses,
+                bool boardMarks) {
+    EpochDomain::Section section(epochs);
+    bool applied = false;
+    bool found = writeStudent(rollNo, [&](Student *student) {
+      applied = applyMarks(student, statuses, boardMarks);
+      if (applied)
+        logMarks(student);
+    });
+    return found && applied;
+  }
+
+  // Also false for a date outside the calendar
+  bool setAttendance(const string &rollNo, int year, int month, int day,
+                     bool present) {
+    EpochDomain::Section section(epochs);
+    bool marked = false;
+    bool found = writeStudent(rollNo, [&](Student *student) {
+      marked = recordAttendance(student, year, month, day, present);
+      if (marked)
+        logAttendance(student, year, month, day, present);
+    });
+    return found && marked;
+  }
+
+  // removeStudent, journaled; inside one section so no roster operation
+  // can reuse the roll number before the deletion is logged
+  bool deleteRecord(const string &rollNo) {
+    EpochDomain::Section section(epochs);
+    if (!removeStudent(rollNo))
+      return false;
+    logRollOnly(Journal::DELETE_STUDENT, rollNo);
+    return true;
+  }
+
+  // "found=N", then the record of each roll number found on a line of its
+  // own, in the order asked. A record operation.
+  string queryMany(const vector<string> &rolls) {
+    EpochDomain::Section section(epochs);
+    string result;
+    size_t found = 0;
+    ostringstream record;
+    for (const string &roll : rolls) {
+      bool present = false;
+      readStudent(roll, [&](Student *student) {
+        record.str("");
+        present = student != nullptr;
+        if (present)
+          writeRecord(record, student);
+      });
+      if (present) {
+        found++;
+        result += '\n';
+        result += record.str();
+      }
+    }
+    return "found=" + to_string(found) + result;
+  }
+
+  // Resolve roll numbers to students; on an unknown roll number, returns
+  // false with it in `missing`
+  bool findStudents(const vector<string> &rolls, vector<Student *> &students,
+                    string &missing) {
+    students.clear();
+    for (const string &roll : rolls) {
+      Student *student = searchInHashTable(roll);
+      if (student == nullptr) {
+        missing = roll;
+        return false;
+      }
+      students.push_back(student);
+    }
+    return true;
+  }
+
+  // Mark one student, or several given as a comma-separated list, for the
+  // same date
+  void markAttendance(string rollNo) {
+    cout << "\n--- Mark Attendance ---\n";
+
+    vector<Student *> students;
+    string missing;
+    if (!findStudents(splitRolls(rollNo), students, missing) ||
+        students.empty()) {
+      cout << "[ERROR] Student not found!";
+      if (!missing.empty())
+        cout << " (" << missing << ")";
+      cout << "\n";
+      return;
+    }
+
+    if (students.size() == 1)
+      cout << "Student: " << students[0]->getName() << "\n";
+    else
+      cout << "Students: " << students.size() << "\n";
+
+    string yearStr = getValidInput("Enter Year (2024-2034)", false);
+    int year = stoi(yearStr);
+    if (year < 2024 || year > 2034) {
+      cout << "[ERROR] Year must be between 2024-2034!\n";
+      return;
+    }
+
+    string monthStr = getValidInput("Enter Month (1-12)", false);
+    int month = stoi(monthStr);
+    if (month < 1 || month > 12) {
+      cout << "[ERROR] Invalid month!\n";
+      return;
+    }
+
+    string dayStr = getValidInput("Enter Day", false);
+    int day = stoi(dayStr);
+    int maxDays = Calendar::getDaysInMonth(month, year);
+    if (day < 1 || day > maxDays) {
+      cout << "[ERROR] Invalid day for this month!\n";
+      return;
+    }
+
+    string status = getValidInput("Mark as (P=Present, A=Absent)", false);
+    bool present = (status == "P" || status == "p");
+
+    markAttendanceFor(students, year, month, day, present);
+    if (students.size() == 1)
+      cout << "[SUCCESS] Attendance marked!\n";
+    else
+      cout << "[SUCCESS] Attendance marked for " << students.size()
+           << " students!\n";
+  }
+
+  static bool validateDateKey(string value) {
+    int32_t day;
+    return Calendar::parseDateKey(value, day);
+  }
+
+  // Mark a whole class for one date: everyone gets the same status except
+  // the roll numbers listed, who get the other one
+  void classRollCall(int classNum, const string &category) {
+    vector<Student *> members = classMembers(classNum, category);
+    if (members.empty()) {
+      cout << "[INFO] No students in that class!\n";
+      return;
+    }
+    int32_t days;
+    Calendar::parseDateKey(
+        getValidInput("Enter Date (YYYY-MM-DD)", false, validateDateKey), days);
+    int year, month, day;
+    Calendar::fromDayNumber(days, year, month, day);
+    if (year < Calendar::FIRST_YEAR || year > Calendar::LAST_YEAR) {
+      cout << "[ERROR] Year must be between 2024-2034!\n";
+      return;
+    }
+    string status = getValidInput("Mark class as (P=Present, A=Absent)", false);
+    bool present = (status == "P" || status == "p");
+    string others;
+    cout << "Roll numbers to mark " << (present ? "absent" : "present")
+         << " (comma-separated, Press Enter for none): ";
+    getline(cin, others);
+
+    vector<Student *> exceptions;
+    string missing;
+    if (!findStudents(splitRolls(others), exceptions, missing)) {
+      cout << "[ERROR] Student not found! (" << missing << ")\n";
+      return;
+    }
+    vector<uint8_t> flipped(store.slotCount(), 0); // By slot
+    for (Student *student : exceptions) {
+      if (student->getClassNumber() != classNum ||
+          (!category.empty() && student->classCategory != category)) {
+        cout << "[ERROR] " << student->rollNo << " is not in this class!\n";
+        return;
+      }
+      flipped[student->getSlot()] = 1;
+    }
+    vector<Student *> same, other;
+    for (Student *student : members)
+      (flipped[student->getSlot()] ? other : same).push_back(student);
+    markAttendanceFor(same, year, month, day, present);
+    markAttendanceFor(other, year, month, day, !present);
+    size_t presentCount = present ? same.size() : other.size();
+    cout << "[SUCCESS] Attendance marked for " << members.size()
+         << " students (" << presentCount << " present, "
+         << members.size() - presentCount << " absent).\n";
+  }
+
+  // Present/absent counts and the absentees of a class on one date
+  void showRollCall(int classNum, const string &category) {
+    int32_t day;
+    Calendar::parseDateKey(
+        getValidInput("Enter Date (YYYY-MM-DD)", false, validateDateKey), day);
+    vector<Student *> present, absent;
+    attendanceOn(day, classNum, category, present, absent);
+    size_t members = classMembers(classNum, category).size();
+    cout << "  Present    : " << present.size() << "\n";
+    cout << "  Absent     : " << absent.size() << "\n";
+    cout << "  Not Marked : " << members - present.size() - absent.size()
+         << "\n";
+    for (Student *student : absent)
+      cout << "    " << student->rollNo << "  " << student->getName() << "\n";
+  }
+
+  void promoteAllStudents() {
+    cout << "\n--- Promoting All Students ---\n";
+    int promoted = 0;
+    int notEligible = 0;
+    promoteStudents(promoted, notEligible, &cout);
+
+    cout << "[SUCCESS] " << promoted << " students promoted!\n";
+    if (notEligible > 0) {
+      cout << "[INFO] " << notEligible
+           << " students were not eligible for promotion.\n";
+    }
+  }
+
+  // Class-scoped operations on one class, optionally one category of it
+  void manageClass() {
+    cout << "\n--- Class Operations ---\n";
+    string className =
+        getValidInput("Enter Class (1-12)", false, validateClass);
+    int classNum = stoi(className);
+    string category;
+    if (classNum >= 8) {
+      cout << "Categories (Press Enter for all):\n";
+      if (classNum <= 10)
+        cout << "1. Computer Science\n2. Biology\n";
+      else
+        cout << "1. Computer Science\n2. Pre-Engineering\n3. Pre-Medical\n";
+      string categoryChoice;
+      cout << "Enter category: ";
+      getline(cin, categoryChoice);
+      category = resolveCategory(classNum, categoryChoice);
+    }
+
+    cout << "1. Display Students\n2. Promote Students\n3. Save to File\n"
+            "4. Recompute Grades\n5. Mark Attendance (Roll Call)\n"
+            "6. Attendance on a Date\n7. Save Class Segments\n"
+            "8. Load Class Segments\n";
+    string choice = getValidInput("Enter choice", false);
+    if (choice == "1") {
+      displayClass(classNum, category);
+    } else if (choice == "2") {
+      cout << "\n--- Promoting Class " << classNum << " ---\n";
+      int promoted = 0;
+      int notEligible = 0;
+      promoteStudents(promoted, notEligible, &cout, classNum, category);
+      cout << "[SUCCESS] " << promoted << " students promoted!\n";
+      if (notEligible > 0) {
+        cout << "[INFO] " << notEligible
+             << " students were not eligible for promotion.\n";
+      }
+    } else if (choice == "3") {
+      string defaultName = "class" + to_string(classNum) + ".txt";
+      string filename;
+      cout << "Enter file name (Press Enter for " << defaultName << "): ";
+      getline(cin, filename);
+      saveClassToFile(classNum, category,
+                      filename.empty() ? defaultName : filename);
+    } else if (choice == "4") {
+      cout << "[SUCCESS] Grades recomputed for "
+           << recomputeClassGrades(classNum, category) << " students.\n";
+    } else if (choice == "5") {
+      classRollCall(classNum, category);
+    } else if (choice == "6") {
+      showRollCall(classNum, category);
+    } else if (choice == "7" || choice == "8") {
+      string manifest = askManifest();
+      if (choice == "7")
+        saveSegments(manifest, classNum, category);
+      else
+        loadSegments(manifest, classNum, category);
+    } else {
+      cout << "[ERROR] Invalid choice!\n";
+    }
+  }
+
+  static string askManifest() {
+    string manifest;
+    cout << "Enter manifest file name (Press Enter for students.manifest): ";
+    getline(cin, manifest);
+    return manifest.empty() ? "students.manifest" : manifest;
+  }
+
+  // Save or load the whole roster as class segment files
+  void manageSegments() {
+    cout << "\n--- Class Segment Files ---\n";
+    cout << "1. Save All Classes\n2. Load All Classes\n";
+    string choice = getValidInput("Enter choice", false);
+    if (choice == "1") {
+      saveSegments(askManifest(), 0, "");
+    } else if (choice == "2") {
+      loadSegments(askManifest(), 0, "");
+    } else {
+      cout << "[ERROR] Invalid choice!\n";
+    }
+  }
+
+  void updateMarks(string rollNo) {
+    cout << "\n--- Update Marks ---\n";
+
+    Student *student = searchInHashTable(rollNo);
+    if (student == nullptr) {
+      cout << "[ERROR] Student not found!\n";
+      return;
+    }
+
+    if (student->record().subjects.empty()) {
+      cout << "[ERROR] No subjects found!\n";
+      return;
+    }
+
+    cout << "\nStudent: " << student->getName() << "\n";
+
+    vector<string> statuses;
+    for (const Subject &current : student->record().subjects) {
+      int maxMarksForSub = student->getMaxMarksForSubject(current);
+      // Create a lambda function for validation with specific max marks
+      auto validateMarksForSub = [maxMarksForSub](string marks) -> bool {
+        return validateMarks(marks, maxMarksForSub);
+      };
+      string marks =
+          getValidInput("Enter marks for " + current.name() + " (0-" +
+                            to_string(maxMarksForSub) + ", A=Absent, L=Leave)",
+                        true, validateMarksForSub);
+
+      if (marks.empty()) {
+        statuses.push_back(current.marksStatus());
+        continue;
+      }
+      if (marks != "A" && marks != "L" && marks != "-" &&
+          stof(marks) > maxMarksForSub) {
+        cout << "[WARNING] Marks exceed maximum (" << maxMarksForSub
+             << "). Setting to maximum.\n";
+        marks = to_string(maxMarksForSub);
+      }
+      statuses.push_back(marks);
+    }
+
+    // Ask if these are board marks (for classes 8-12)
+    bool boardMarks = student->hasBoardMarks();
+    int classNum = student->getClassNumber();
+    if (classNum >= 8 && classNum <= 12) {
+      string answer = getValidInput("Are these board marks? (Y/N)", false);
+      if (answer == "Y" || answer == "y") {
+        boardMarks = true;
+      }
+    }
+
+    if (!setMarks(rollNo, statuses, boardMarks)) {
+      cout << "[ERROR] Marks not updated: " << SubjectCatalog::FULL << "!\n";
+      return;
+    }
+    cout << "[SUCCESS] Marks updated!\n";
+  }
+
+  void updateTerms(string rollNo) {
+    cout << "\n--- Update Terms ---\n";
+
+    Student *student = searchInHashTable(rollNo);
+    if (student == nullptr) {
+      cout << "[ERROR] Student not found!\n";
+      return;
+    }
+
+    cout << "Student: " << student->getName() << "\n";
+    cout << "Current terms completed: " << student->getTermsCompleted()
+         << "/3\n";
+
+    string termsStr =
+        getValidInput("Enter number of terms completed (0-3)", false);
+    int terms = stoi(termsStr);
+    if (terms < 0 || terms > 3) {
+      cout << "[ERROR] Terms must be between 0 and 3!\n";
+      return;
+    }
+
+    beforeChange(student);
+    student->setTermsCompleted(terms);
+    logTerms(student);
+    cout << "[SUCCESS] Terms updated!\n";
+  }
+
+  void manageSubjects(string rollNo) {
+    cout << "\n--- Manage Subjects ---\n";
+
+    Student *student = searchInHashTable(rollNo);
+    if (student == nullptr) {
+      cout << "[ERROR] Student not found!\n";
+      return;
+    }
+
+    cout << "Student: " << student->getName()
+         << " (Class: " << student->getClassName() << ")\n";
+    cout << "\nCurrent Subjects:\n";
+
+    int count = 1;
+    for (const Subject &current : student->record().subjects) {
+      cout << "  " << count << ". " << current.name() << "\n";
+      count++;
+    }
+
+    cout << "\n[INFO] Subjects are managed automatically based on class and "
+            "category.\n";
+    cout << "To modify subjects, please delete and re-add the student with "
+            "correct category.\n";
+  }
+
+  void deleteStudent(string rollNo) {
+    cout << "\n--- Deleting Student ---\n";
+
+    if (head == nullptr && !archive.isOpen()) {
+      cout << "[ERROR] No students in system!\n";
+      return;
+    }
+
+    searchInHashTable(rollNo); // loads it from an open archive
+    if (!deleteRecord(rollNo)) {
+      cout << "[ERROR] Student not found!\n";
+      return;
+    }
+    cout << "[SUCCESS] Student deleted!\n";
+  }
+
+  void searchStudent(string rollNo) {
+    cout << "\n--- Search Student ---\n";
+    StudentView view;
+    searchInHashTable(rollNo); // loads it from an open archive
+    if (lookupStudent(rollNo, view)) {
+      cout << "[FOUND] Student Details:\n";
+      showStudentInfo(view);
+    } else {
+      cout << "[NOT FOUND] No student with roll number " << rollNo << "\n";
+    }
+  }
+
+  void displayAll() {
+    if (head == nullptr) {
+      cout << "\n[INFO] No students in system!\n";
+      return;
+    }
+
+    cout << "\n========================================\n";
+    cout << "       ALL STUDENT RECORDS\n";
+    cout << "========================================\n";
+    cout << "Total Students: " << totalStudents << "\n\n";
+
+    Student *current = head;
+    while (current != nullptr) {
+      showStudentInfo(current);
+      current = current->next;
+    }
+  }
+
+  void searchByName(string query) {
+    cout << "\n--- Search by Name ---\n";
+    const size_t MAX_SHOWN = 20;
+    vector<Student *> results;
+    size_t total = findByName(query, MAX_SHOWN, results);
+    if (total == 0) {
+      cout << "[INFO] No student or father's name matches \"" << query
+           << "\".\n";
+      return;
+    }
+
+    cout << left << setw(14) << "Roll Number" << setw(24) << "Name"
+         << setw(24) << "Father's Name"
+         << "Class\n";
+    for (Student *student : results) {
+      cout << setw(14) << student->rollNo << setw(24) << student->getName()
+           << setw(24) << student->getFatherName() << student->getClassName();
+      if (!student->classCategory.empty())
+        cout << " " << student->classCategory;
+      cout << "\n";
+    }
+    cout << right;
+    if (total > results.size()) {
+      cout << "[INFO] " << total - results.size()
+           << " more matches not shown; refine the search.\n";
+    }
+  }
+
+  void displayClass(int classNum, const string &category) {
+    vector<Student *> members = classMembers(classNum, category);
+    if (members.empty()) {
+      cout << "\n[INFO] No students in class " << classNum
+           << (category.empty() ? "" : " " + category) << "!\n";
+      return;
+    }
+
+    cout << "\n========================================\n";
+    cout << "       CLASS " << classNum
+         << (category.empty() ? "" : " " + category) << " RECORDS\n";
+    cout << "========================================\n";
+    cout << "Total Students: " << members.size() << "\n\n";
+
+    for (Student *student : members)
+      showStudentInfo(student);
+  }
+
+  void saveToFile(string filename) {
+    if (head == nullptr) {
+      cout << "\n[WARNING] No data to save!\n";
+      return;
+    }
+
+    ofstream file(filename);
+    if (!file.is_open()) {
+      cout << "[ERROR] Cannot open file!\n";
+      return;
+    }
+
+    for (Student *current = head; current != nullptr;
+         current = current->next) {
+      writeRecord(file, current);
+      file << "\n";
+    }
+
+    file.close();
+    cout << "[SUCCESS] Data saved to " << filename << "\n";
+  }
+
+  // Save one class (and category, when not empty) in the students.txt format
+  void saveClassToFile(int classNum, const string &category,
+                       string filename) {
+    vector<Student *> members = classMembers(classNum, category);
+    if (members.empty()) {
+      cout << "\n[WARNING] No data to save!\n";
+      return;
+    }
+
+    ofstream file(filename);
+    if (!file.is_open()) {
+      cout << "[ERROR] Cannot open file!\n";
+      return;
+    }
+
+    for (Student *student : members) {
+      writeRecord(file, student);
+      file << "\n";
+    }
+
+    file.close();
+    cout << "[SUCCESS] " << members.size() << " students saved to "
+         << filename << "\n";
+  }
+
+  // Start writing the roster, as it is now, to `filename` on a background
+  // thread and return at once; the thread reports on the console when it is
+  // done. False if the previous background save is still running. A roster
+  // operation.
+  bool saveInBackground(const string &filename) {
+    if (savingGeneration.load() != 0) {
+      cout << "[WARNING] A background save is still running!\n";
+      return false;
+    }
+    if (head == nullptr) {
+      cout << "\n[WARNING] No data to save!\n";
+      return true;
+    }
+    if (backgroundSave && backgroundSave->worker.joinable())
+      backgroundSave->worker.join();
+
+    backgroundSave.reset(new BackgroundSave());
+    BackgroundSave &job = *backgroundSave;
+    job.generation = ++lastSaveGeneration;
+    job.filename = filename;
+    job.slotLimit = (uint32_t)store.slotCount();
+    job.started = chrono::steady_clock::now();
+    store.captureGeneration = job.generation;
+    savingGeneration.store(job.generation);
+    job.worker = thread([this, &job] { writeBackgroundSave(job); });
+    cout << "[INFO] Saving to " << filename << " in the background.\n";
+    return true;
+  }
+
+  // Called before a student is changed or deleted: if a background save
+  // has not written it yet, preserve the record as it is now for the save.
+  // An archived student also leaves the cache.
+  // The caller keeps the student from changing meanwhile (its shard lock,
+  // or the roster to itself).
+  void beforeChange(Student *student) {
+    if (archive.isOpen())
+      keepLoaded(student);
+    uint32_t generation = savingGeneration.load(memory_order_acquire);
+    if (generation == 0 ||
+        store.captured[student->getSlot()].load(memory_order_acquire) ==
+            generation)
+      return;
+    ostringstream record;
+    writeRecord(record, student);
+    uint32_t slot = student->getSlot();
+    {
+      lock_guard<mutex> hold(backgroundSave->lock);
+      backgroundSave->preserved[store.listOrder[slot]] = record.str();
+    }
+    store.captured[slot].store(generation, memory_order_release);
+  }
+
+  // The background save's thread. It works in sections of CHUNK students,
+  // so roster operations only wait for the chunk in hand.
+  void writeBackgroundSave(BackgroundSave &job) {
+    const uint32_t CHUNK = 256;
+    const uint32_t PRESERVED = UINT32_MAX;
+    uint32_t generation = job.generation;
+
+    // Pass 1: roster positions of the students not yet preserved. The
+    // others are all in `preserved` once the pass is over.
+    vector<pair<uint64_t, uint32_t>> order; // (list order, slot)
+    for (uint32_t first = 0; first < job.slotLimit; first += CHUNK) {
+      EpochDomain::Section section(epochs);
+      for (uint32_t slot = first; slot < min(job.slotLimit, first + CHUNK);
+           slot++) {
+        if (store.captured[slot].load(memory_order_acquire) != generation &&
+            store.owner[slot] != nullptr)
+          order.push_back({store.listOrder[slot], slot});
+      }
+    }
+    {
+      lock_guard<mutex> hold(job.lock);
+      for (const auto &entry : job.preserved)
+        order.push_back({entry.first, PRESERVED});
+    }
+    sort(order.begin(), order.end());
+
+    // Pass 2: write in roster order, each student as preserved or, if it
+    // is still unchanged, as it is now
+    string tempName = job.filename + ".tmp";
+    ofstream file(tempName);
+    size_t written = 0;
+    string line;
+    auto takePreserved = [&](uint64_t position) {
+      lock_guard<mutex> hold(job.lock);
+      auto found = job.preserved.find(position);
+      if (found == job.preserved.end())
+        return false;
+      line.swap(found->second);
+      job.preserved.erase(found);
       return true;
-    try {
-      float m = stof(marks);
-      return m >= 0 && m <= maxMarks;
-    } catch (...) {
-      return false;
+    };
+    for (size_t first = 0; first < order.size(); first += CHUNK) {
+      EpochDomain::Section section(epochs);
+      for (size_t i = first; i < min(order.size(), first + CHUNK); i++) {
+        if (i > 0 && order[i].first == order[i - 1].first)
+          continue; // Preserved after pass 1 listed it
+        uint32_t slot = order[i].second;
+        bool found = false;
+        // A student deleted since pass 1 was preserved first, so `captured`
+        // is checked before its slot is read
+        Student *student = nullptr;
+        if (slot != PRESERVED &&
+            store.captured[slot].load(memory_order_acquire) != generation)
+          student = store.owner[slot];
+        if (student != nullptr) {
+          lock_guard<mutex> hold(
+              hashTable.shardOf(student->rollNo).lock);
+          if (store.captured[slot].load(memory_order_relaxed) != generation) {
+            ostringstream record;
+            writeRecord(record, student);
+            line = record.str();
+            store.captured[slot].store(generation, memory_order_release);
+            found = true;
+          }
+        }
+        if (!found)
+          found = takePreserved(order[i].first);
+        if (found) {
+          file << line << "\n";
+          written++;
+        }
+      }
     }
+    savingGeneration.store(0); // Every student has been written
+
+    file.close();
+    bool saved = !file.fail();
+#ifdef _WIN32
+    if (saved)
+      remove(job.filename.c_str());
+#endif
+    saved = saved && rename(tempName.c_str(), job.filename.c_str()) == 0;
+    if (!saved)
+      remove(tempName.c_str());
+    long long micros = chrono::duration_cast<chrono::microseconds>(
+                           chrono::steady_clock::now() - job.started)
+                           .count();
+    ostringstream report;
+    if (saved)
+      report << "\n[SUCCESS] Background save: " << written
+             << " students saved to " << job.filename << " in "
+             << micros / 1000 << " ms.\n";
+    else
+      report << "\n[ERROR] Background save to " << job.filename
+             << " failed!\n";
+    cout << report.str() << flush;
   }
 
-  // Validate admission date based on class and academic year rules
-  bool validateAdmissionDate(int classNum, int admissionYear, int currentMonth,
-                             int currentYear) {
-    // Classes 1-7: Papers in February, new session starts in March
-    // Classes 8-10: Papers in February/March, new session in April
-    // Classes 11-12: Papers in May/June, new session in June/July
+  // A students.txt row checked and decoded, not yet a student. The text
+  // fields point into the row.
+  struct ParsedRow {
+    string_view rollNo, name, fatherName, category;
+    string_view dateOfBirth, cnicBForm, address;
+    int classNum, admissionYear, currentYear, termsCompleted;
+    bool hasCurrentYear, boardMarks;
+    vector<pair<string_view, string_view>> subjects; // name, marks status
+    Calendar attendance;
+  };
+
+  // Check and decode one row of a students.txt file. Rows that cannot be
+  // used are reported as errors and give false, as do those whose roll
+  // number `keep` turns down; fields that had to be fixed are reported as
+  // warnings and set `repaired`. `tokens` is scratch space. Touches nothing
+  // shared but the attendance block pool, so rows can be decoded on many
+  // threads at once.
+  template <typename Report, typename Keep>
+  bool decodeRecord(string_view line, vector<string_view> &tokens,
+                    Report &&report, Keep &&keep, ParsedRow &row,
+                    bool &repaired) {
+    auto repair = [&](const string &message) {
+      report("WARNING", message);
+      repaired = true;
+    };
+
+    tokens.clear();
+    string_view rest = line;
+    while (true) {
+      size_t pos = rest.find('|');
+      tokens.push_back(rest.substr(0, pos));
+      if (pos == string_view::npos)
+        break;
+      rest.remove_prefix(pos + 1);
+    }
 
-    if (classNum >= 1 && classNum <= 7) {
-      // For classes 1-7, admission should be in March (month 3) or later in the
-      // year If current month is before March, admission year should be
-      // previous year
-      if (currentMonth < 3) {
-        // If it's Jan/Feb, admission year should be previous year
-        return (admissionYear == currentYear - 1);
+    if (tokens.size() < 12) {
+      report("ERROR", "expected at least 12 fields, found " +
+                          to_string(tokens.size()) + "; row skipped");
+      return false;
+    }
+    if (tokens[0].empty()) {
+      report("ERROR", "missing roll number; row skipped");
+      return false;
+    }
+    int admissionYear;
+    if (!parseNumber(tokens[5], admissionYear)) {
+      report("ERROR", "invalid admission year '" + string(tokens[5]) +
+                          "'; row skipped");
+      return false;
+    }
+    int classNum;
+    if (!parseNumber(tokens[3], classNum) || classNum < 1 || classNum > 12) {
+      report("ERROR",
+             "invalid class '" + string(tokens[3]) + "'; row skipped");
+      return false;
+    }
+
+    if (!keep(string(tokens[0])))
+      return false;
+
+    repaired = false;
+    row.rollNo = tokens[0];
+    row.name = tokens[1];
+    row.fatherName = tokens[2];
+    row.category = tokens[4];
+    row.dateOfBirth = tokens[7];
+    row.cnicBForm = tokens[8];
+    row.address = tokens[9];
+    row.classNum = classNum;
+    row.admissionYear = admissionYear;
+    row.termsCompleted = 0;
+    row.boardMarks = false;
+    row.subjects.clear();
+    row.attendance = Calendar();
+    row.attendance.usePool(&store.yearBlocks);
+    row.hasCurrentYear = parseNumber(tokens[6], row.currentYear);
+    if (!row.hasCurrentYear) {
+      repair("invalid current year '" + string(tokens[6]) +
+             "', using admission year");
+    }
+
+    // Three layouts exist:
+    //   current: ...|totalSubjects|terms|board|subjects|attendance
+    //   interim: ...|totalSubjects|subjects|terms|board|attendance
+    //   old:     ...|totalSubjects|subjects|attendance
+    string_view subjectsData, attendanceData, termsField, boardField;
+    bool hasTerms = false;
+    if (tokens.size() >= 15 && !tokens[11].empty() &&
+        tokens[11].find(':') == string_view::npos &&
+        tokens[12].find(':') == string_view::npos) {
+      termsField = tokens[11];
+      boardField = tokens[12];
+      subjectsData = tokens[13];
+      attendanceData = tokens[14];
+      hasTerms = true;
+    } else if (tokens.size() >= 14 &&
+               tokens[12].find(':') == string_view::npos) {
+      subjectsData = tokens[11];
+      termsField = tokens[12];
+      boardField = tokens[13];
+      if (tokens.size() > 14)
+        attendanceData = tokens[14];
+      hasTerms = true;
+    } else {
+      subjectsData = tokens[11];
+      if (tokens.size() > 12)
+        attendanceData = tokens[12];
+    }
+
+    if (hasTerms) {
+      int terms;
+      if (parseNumber(termsField, terms) && terms >= 0 && terms <= 3) {
+        row.termsCompleted = terms;
       } else {
-        // If it's March or later, admission year should be current year
-        return (admissionYear == currentYear);
+        repair("invalid terms completed '" + string(termsField) +
+               "', using 0");
       }
-    } else if (classNum >= 8 && classNum <= 10) {
-      // For classes 8-10, papers in Feb/March, new session in April
-      if (currentMonth < 4) {
-        // If it's Jan/Feb/March, admission year should be previous year
-        return (admissionYear == currentYear - 1);
-      } else {
-        // If it's April or later, admission year should be current year
-        return (admissionYear == currentYear);
+      if (boardField == "1") {
+        row.boardMarks = true;
+      } else if (boardField != "0") {
+        repair("invalid board marks flag '" + string(boardField) +
+               "', using 0");
       }
-    } else if (classNum >= 11 && classNum <= 12) {
-      // For classes 11-12, papers in May/June, new session in June/July
-      if (currentMonth < 6) {
-        // If it's before June, admission year should be previous year
-        return (admissionYear == currentYear - 1);
-      } else {
-        // If it's June or later, admission year should be current year
-        return (admissionYear == currentYear);
+    }
+
+    while (!subjectsData.empty()) {
+      size_t pos = subjectsData.find(',');
+      string_view subPair = subjectsData.substr(0, pos);
+      subjectsData.remove_prefix(
+          pos == string_view::npos ? subjectsData.size() : pos + 1);
+      if (subPair.empty())
+        continue;
+
+      size_t colonPos = subPair.find(':');
+      if (colonPos == string_view::npos || colonPos == 0) {
+        repair("malformed subject '" + string(subPair) + "' dropped");
+        continue;
+      }
+      string_view marks = subPair.substr(colonPos + 1);
+      float value;
+      if (marks != "A" && marks != "L" && marks != "-" &&
+          !parseNumber(marks, value)) {
+        repair("invalid marks '" + string(marks) + "' for " +
+               string(subPair.substr(0, colonPos)) + ", using -");
+        marks = "-";
       }
+      row.subjects.push_back({subPair.substr(0, colonPos), marks});
     }
-    return true; // Default validation
+
+    while (!attendanceData.empty()) {
+      size_t pos = attendanceData.find(',');
+      string_view attPair = attendanceData.substr(0, pos);
+      attendanceData.remove_prefix(
+          pos == string_view::npos ? attendanceData.size() : pos + 1);
+      if (attPair.empty())
+        continue;
+
+      // YYYY-MM-DD:P
+      int year, month, day;
+      if (attPair.size() != 12 || attPair[4] != '-' || attPair[7] != '-' ||
+          attPair[10] != ':' || !parseNumber(attPair.substr(0, 4), year) ||
+          !parseNumber(attPair.substr(5, 2), month) ||
+          !parseNumber(attPair.substr(8, 2), day) ||
+          (attPair[11] != 'P' && attPair[11] != 'A') ||
+          !row.attendance.markAttendance(year, month, day,
+                                         attPair[11] == 'P')) {
+        repair("invalid attendance entry '" + string(attPair) +
+               "' dropped");
+      }
+    }
+
+    return true;
   }
 
-  // Get current date components
-  void getCurrentDate(int &year, int &month, int &day) {
-    // Get current system date
-    time_t now = time(0);
-    tm *ltm = localtime(&now);
-    year = 1900 + ltm->tm_year;
-    month = 1 + ltm->tm_mon;
-    day = ltm->tm_mday;
+  // The student for a decoded row, not yet in the roster; nullptr if the
+  // subject catalog is full
+  Student *buildStudent(ParsedRow &row) {
+    Student *student = new (&store) Student(
+        &store, string(row.rollNo), string(row.name), string(row.fatherName),
+        to_string(row.classNum), string(row.category), row.admissionYear,
+        string(row.dateOfBirth), string(row.cnicBForm), string(row.address));
+    if (row.hasCurrentYear)
+      student->setCurrentYear(row.currentYear);
+    student->setTermsCompleted(row.termsCompleted);
+    student->setBoardMarksEntered(row.boardMarks);
+    for (const pair<string_view, string_view> &subject : row.subjects) {
+      if (!student->addSubject(subject.first, subject.second)) {
+        delete student;
+        return nullptr;
+      }
+    }
+    student->record().attendance = std::move(row.attendance);
+    return student;
   }
 
-  string formatCNIC(string input) {
-    return input.substr(0, 5) + "-" + input.substr(5, 7) + "-" +
-           input.substr(12, 1);
+  // decodeRecord and buildStudent in one step; nullptr for a row that
+  // decodeRecord turns down
+  template <typename Report, typename Keep>
+  Student *parseRecord(string_view line, vector<string_view> &tokens,
+                       Report &&report, Keep &&keep, bool &repaired) {
+    ParsedRow row;
+    if (!decodeRecord(line, tokens, report, keep, row, repaired))
+      return nullptr;
+    Student *student = buildStudent(row);
+    if (student == nullptr)
+      report("ERROR", string(SubjectCatalog::FULL) + "; row skipped");
+    return student;
   }
 
-  string formatDOB(string input) {
-    return input.substr(0, 2) + "-" + input.substr(2, 2) + "-" +
-           input.substr(4, 4);
+  void loadFromFile(string filename) {
+    NameIndex::Bulk bulk(nameIndex); // postings built once, at the end
+    LineReader file(filename);
+    if (!file.is_open()) {
+      cout << "[ERROR] Cannot open file!\n";
+      return;
+    }
+
+    const int MAX_DIAGNOSTICS = 20;
+    int diagnostics = 0;
+    int rejected = 0;
+    int repaired = 0;
+    int duplicates = 0;
+    int sharedCnic = 0;
+    int loadedCount = 0;
+    size_t lineNo = 0;
+    bool rowRepaired = false;
+
+    auto report = [&](const char *level, const string &message) {
+      if (diagnostics++ < MAX_DIAGNOSTICS) {
+        cout << "[" << level << "] " << filename << ":" << lineNo << ": "
+             << message << "\n";
+      }
+    };
+
+    string_view line;
+    vector<string_view> tokens;
+    while (file.next(line)) {
+      lineNo++;
+      if (!line.empty() && line.back() == '\r')
+        line.remove_suffix(1);
+      if (line.empty())
+        continue;
+
+      bool duplicate = false;
+      Student *newStudent = parseRecord(
+          line, tokens, report,
+          [&](const string &rollNo) {
+            duplicate = rollTaken(rollNo);
+            return !duplicate;
+          },
+          rowRepaired);
+      if (newStudent == nullptr) {
+        if (duplicate)
+          duplicates++;
+        else
+          rejected++;
+        continue;
+      }
+
+      if (rowRepaired)
+        repaired++;
+
+      // Kept, since the file is the only copy of the row; DUPLICATES lists
+      // every student sharing a CNIC
+      Student *holder = cnicHolder(newStudent->getCnicBForm());
+      if (holder != nullptr) {
+        report("WARNING", "CNIC " + newStudent->getCnicBForm() +
+                              " is also enrolled under roll " +
+                              holder->rollNo);
+        sharedCnic++;
+      }
+
+      linkAtTail(newStudent);
+
+      addToHashTable(newStudent);
+      totalStudents++;
+      loadedCount++;
+    }
+
+    if (diagnostics > MAX_DIAGNOSTICS) {
+      cout << "[INFO] " << diagnostics - MAX_DIAGNOSTICS
+           << " further diagnostics not shown.\n";
+    }
+    if (rejected > 0)
+      cout << "[INFO] " << rejected << " malformed rows skipped.\n";
+    if (repaired > 0)
+      cout << "[INFO] " << repaired << " rows repaired.\n";
+    if (duplicates > 0) {
+      cout << "[INFO] " << duplicates
+           << " rows skipped for roll numbers already loaded.\n";
+    }
+    if (sharedCnic > 0) {
+      cout << "[WARNING] " << sharedCnic
+           << " rows share a CNIC/B-Form with another student; list them "
+              "with Find Duplicate CNICs (menu 19) or DUPLICATES.\n";
+    }
+    cout << "[SUCCESS] " << loadedCount << " students loaded!\n";
+
+    if (loadedCount > 0 && journal.isOpen())
+      compactJournal(); // bulk loads are not journaled record by record
   }
 
-  vector<string> getSubjectsForClass(string className, string category) {
-    vector<string> subjects;
+  // Open a students.txt file for loading on demand, for sessions that only
+  // touch some of its students. Each student is read from the file the first
+  // time it is looked up; up to `capacity` of them are kept loaded while
+  // unchanged, and a changed one stays loaded. Operations on the whole
+  // roster first load the rest of the file and close it (loadArchive). The
+  // roll number index is kept in <filename>.idx, so opening the same file
+  // again costs the same whatever its size. Logged in the journal, so a
+  // restart opens the archive again rather than loading it. A roster
+  // operation.
+  bool attachArchive(const string &filename, size_t capacity) {
+    loadArchive(); // one archive at a time
+    auto started = chrono::steady_clock::now();
+    bool indexed;
+    if (!archive.open(filename, indexed)) {
+      cout << "[ERROR] Cannot open file!\n";
+      return false;
+    }
+    archiveCapacity = capacity;
+    auto elapsed = chrono::duration_cast<chrono::milliseconds>(
+        chrono::steady_clock::now() - started);
+    if (indexed)
+      cout << "[INFO] Indexed " << filename << " into " << filename
+           << ".idx.\n";
+    cout << "[SUCCESS] Archive " << filename << " opened in "
+         << elapsed.count() << " ms: " << archive.size()
+         << " rows loaded on demand, up to " << capacity
+         << " unchanged students kept.\n";
+
+    Journal::Record record(Journal::OPEN_ARCHIVE);
+    record.putString(filename);
+    record.putInt((int32_t)min(capacity, (size_t)INT32_MAX));
+    logRecord(record);
+    return true;
+  }
 
-    if (className == "8" || className == "9" || className == "10") {
-      if (category == "Computer Science") {
-        subjects = {
-            "English",      "Urdu",     "Maths",       "Physics",
-            "Chemistry",    "Islamiat", "Pak Studies", "Computer Science",
-            "Mutaila Quran"};
-      } else if (category == "Biology") {
-        subjects = {"English",     "Urdu",      "Maths",
-                    "Physics",     "Chemistry", "Islamiat",
-                    "Pak Studies", "Biology",   "Mutaila Quran"};
+  // Load every student of the open archive not loaded yet and close it, so
+  // that an operation on the whole roster sees all of it. Rows are checked
+  // as loadFromFile checks them. A roster operation.
+  void loadArchive() {
+    if (!archive.isOpen())
+      return;
+    NameIndex::Bulk bulk(nameIndex); // postings built once, at the end
+
+    const int MAX_DIAGNOSTICS = 20;
+    int diagnostics = 0;
+    int loadedCount = 0;
+    size_t lineNo = 0;
+    bool rowRepaired;
+    auto report = [&](const char *level, const string &message) {
+      if (diagnostics++ < MAX_DIAGNOSTICS) {
+        cout << "[" << level << "] " << archive.filename() << ":" << lineNo
+             << ": " << message << "\n";
+      }
+    };
+    auto notLoaded = [&](const string &rollNo) {
+      return hashTable.find(rollNo) == nullptr &&
+             !archive.isWithdrawn(rollNo);
+    };
+
+    LineReader file(archive.filename());
+    string_view line;
+    vector<string_view> tokens;
+    while (file.next(line)) {
+      lineNo++;
+      if (!line.empty() && line.back() == '\r')
+        line.remove_suffix(1);
+      if (line.empty())
+        continue;
+      Student *student =
+          parseRecord(line, tokens, report, notLoaded, rowRepaired);
+      if (student != nullptr) {
+        insertStudent(student);
+        loadedCount++;
+      }
+    }
+
+    if (diagnostics > MAX_DIAGNOSTICS) {
+      cout << "[INFO] " << diagnostics - MAX_DIAGNOSTICS
+           << " further diagnostics not shown.\n";
+    }
+    cout << "[INFO] Loaded the remaining " << loadedCount << " students of "
+         << archive.filename() << ".\n";
+    archiveCache.clear();
+    archiveCached.clear();
+    archive.close();
+  }
+
+  // Drop the least recently used unchanged archived students beyond the
+  // cache's capacity; they are read again if looked up. A roster
+  // operation, run between commands so no caller still holds one.
+  void trimArchiveCache() {
+    while (archiveCache.size() > archiveCapacity) {
+      Student *student = archiveCache.back();
+      archiveCache.pop_back();
+      archiveCached.erase(student);
+      beforeChange(student); // a background save may not have it yet
+      hashTable.erase(student->rollNo);
+      unlink(student);
+      totalStudents--;
+      delete student;
+    }
+  }
+
+  // Load the archived students among `rolls` ahead of a record operation,
+  // which cannot read the archive itself. Takes the roster briefly if it
+  // has to, so it must not be called inside a section or a roster
+  // operation.
+  void faultIn(const vector<string> &rolls) {
+    vector<string> missing;
+    {
+      EpochDomain::Section section(epochs);
+      if (!archive.isOpen())
+        return;
+      for (const string &roll : rolls) {
+        bool loaded = false;
+        readStudent(roll,
+                    [&](Student *student) { loaded = student != nullptr; });
+        string row;
+        if (!loaded && archive.find(roll, row))
+          missing.push_back(roll);
+      }
+    }
+    if (missing.empty())
+      return;
+    RosterLock roster(*this);
+    trimArchiveCache(); // before, so the students asked for stay
+    for (const string &roll : missing)
+      searchInHashTable(roll);
+  }
+
+  // One class (and category) segment listed in a manifest
+  struct Segment {
+    int classNum;
+    string category;
+    string filename; // beside the manifest
+    size_t count;
+  };
+
+  // Segment manifest, a text file:
+  //
+  //   SRMSEGMENTS 1 <generation>
+  //   <class>|<category>|<file>|<students>    one line per segment
+  //
+  // Segments hold students.txt rows and sit beside the manifest as
+  // <manifest stem>.<generation>.<class>[.<category>].txt. Each save takes a
+  // new generation, so it never writes over a file the manifest names.
+  static bool readManifest(const string &manifest, uint64_t &generation,
+                           vector<Segment> &segments) {
+    ifstream file(manifest);
+    string magic, line;
+    int version;
+    if (!(file >> magic >> version >> generation) ||
+        magic != "SRMSEGMENTS" || version != 1)
+      return false;
+    getline(file, line); // rest of the header line
+    segments.clear();
+    while (getline(file, line)) {
+      if (!line.empty() && line.back() == '\r')
+        line.pop_back();
+      if (line.empty())
+        continue;
+      size_t first = line.find('|');
+      size_t second = line.find('|', first + 1);
+      size_t third = line.rfind('|');
+      Segment segment;
+      if (first == string::npos || second == string::npos ||
+          third <= second ||
+          !parseNumber(string_view(line).substr(0, first),
+                       segment.classNum) ||
+          !parseNumber(string_view(line).substr(third + 1), segment.count))
+        return false;
+      segment.category = line.substr(first + 1, second - first - 1);
+      segment.filename = line.substr(second + 1, third - second - 1);
+      segments.push_back(std::move(segment));
+    }
+    return true;
+  }
+
+  static string manifestDirectory(const string &manifest) {
+    size_t slash = manifest.find_last_of("/\\");
+    return slash == string::npos ? "" : manifest.substr(0, slash + 1);
+  }
+
+  static string segmentName(const string &manifest, uint64_t generation,
+                            int classNum, const string &category) {
+    string name = manifest.substr(manifestDirectory(manifest).size());
+    size_t dot = name.rfind('.');
+    if (dot != string::npos && dot > 0)
+      name.resize(dot);
+    name += "." + to_string(generation) + (classNum < 10 ? ".0" : ".") +
+            to_string(classNum);
+    if (!category.empty()) {
+      name += '.';
+      for (char c : category)
+        name += isalnum((unsigned char)c) ? c : '_';
+    }
+    return name + ".txt";
+  }
+
+  // Save the roster as one segment file per class, and per category in
+  // classes 8-12, listed in `manifest`; each segment is written on its own
+  // worker thread. Given a class (and category), only its segments are
+  // written and the manifest keeps the others. Segments are synced before
+  // the new manifest is renamed over the old one, so a crash at any point
+  // leaves one whole set; files no longer listed are removed afterwards. A
+  // roster operation.
+  bool saveSegments(const string &manifest, int classNum,
+                    const string &category) {
+    auto started = chrono::steady_clock::now();
+    uint64_t generation = 0;
+    vector<Segment> listed;
+    if (ifstream(manifest).is_open() &&
+        !readManifest(manifest, generation, listed)) {
+      cout << "[ERROR] " << manifest << " is not a segment manifest!\n";
+      return false;
+    }
+    auto inScope = [&](int segmentClass, const string &segmentCategory) {
+      return classNum == 0 ||
+             (segmentClass == classNum &&
+              (category.empty() || segmentCategory == category));
+    };
+    generation++;
+
+    vector<Segment> written;
+    vector<Student *> firsts;
+    for (const auto &group : classIndex) {
+      if (group.second.head == nullptr ||
+          !inScope(group.first.first, group.first.second))
+        continue;
+      written.push_back(Segment{
+          group.first.first, group.first.second,
+          segmentName(manifest, generation, group.first.first,
+                      group.first.second),
+          (size_t)group.second.count});
+      firsts.push_back(group.second.head);
+    }
+    if (written.empty()) {
+      cout << "\n[WARNING] No data to save!\n";
+      return true;
+    }
+
+    string directory = manifestDirectory(manifest);
+    vector<char> saved(written.size(), 0);
+    parallelFor(written.size(), [&](size_t index) {
+      FILE *out = fopen((directory + written[index].filename).c_str(), "wb");
+      if (out == nullptr)
+        return;
+      const streamoff BUFFERED = 1 << 20;
+      ostringstream rows;
+      bool ok = true;
+      auto flushRows = [&] {
+        string text = rows.str();
+        ok = ok && fwrite(text.data(), 1, text.size(), out) == text.size();
+        rows.str("");
+      };
+      for (Student *student = firsts[index]; student != nullptr;
+           student = student->classNext) {
+        writeRecord(rows, student);
+        rows << "\n";
+        if (rows.tellp() >= BUFFERED)
+          flushRows();
+      }
+      flushRows();
+      ok = syncFile(out) && ok && ferror(out) == 0;
+      saved[index] = fclose(out) == 0 && ok;
+    });
+
+    auto discard = [&] {
+      for (const Segment &segment : written)
+        remove((directory + segment.filename).c_str());
+    };
+    for (size_t i = 0; i < written.size(); i++) {
+      if (!saved[i]) {
+        cout << "[ERROR] Cannot write " << directory << written[i].filename
+             << "!\n";
+        discard();
+        return false;
+      }
+    }
+
+    // The new manifest: the segments just written plus those out of scope
+    vector<Segment> replaced;
+    vector<Segment> next = written;
+    for (Segment &segment : listed)
+      (inScope(segment.classNum, segment.category) ? replaced : next)
+          .push_back(std::move(segment));
+    sort(next.begin(), next.end(), [](const Segment &a, const Segment &b) {
+      return a.classNum != b.classNum ? a.classNum < b.classNum
+                                      : a.category < b.category;
+    });
+    ostringstream text;
+    text << "SRMSEGMENTS 1 " << generation << "\n";
+    size_t savedCount = 0;
+    for (const Segment &segment : next)
+      text << segment.classNum << "|" << segment.category << "|"
+           << segment.filename << "|" << segment.count << "\n";
+    for (const Segment &segment : written)
+      savedCount += segment.count;
+
+    string tempName = manifest + ".tmp";
+    FILE *out = fopen(tempName.c_str(), "wb");
+    bool swapped = false;
+    if (out != nullptr) {
+      string body = text.str();
+      swapped = fwrite(body.data(), 1, body.size(), out) == body.size() &&
+                syncFile(out);
+      swapped = fclose(out) == 0 && swapped;
+#ifdef _WIN32
+      if (swapped)
+        remove(manifest.c_str());
+#endif
+      swapped = swapped && rename(tempName.c_str(), manifest.c_str()) == 0;
+      if (!swapped)
+        remove(tempName.c_str());
+      // The replaced segments go only once the new manifest is durable
+      swapped = swapped && syncDirectory(manifest);
+    }
+    if (!swapped) {
+      cout << "[ERROR] Cannot write " << manifest << "!\n";
+      discard();
+      return false;
+    }
+    for (const Segment &segment : replaced)
+      remove((directory + segment.filename).c_str());
+
+    auto elapsed = chrono::duration_cast<chrono::milliseconds>(
+        chrono::steady_clock::now() - started);
+    cout << "[SUCCESS] " << savedCount << " students saved to "
+         << written.size() << " segments of " << manifest << " in "
+         << elapsed.count() << " ms.\n";
+    return true;
+  }
+
+  // Load the students of the segments listed in `manifest`, or of one
+  // class (and category) of them. Each segment is read and decoded on its
+  // own worker thread; the rows then join the roster one segment at a time
+  // in manifest order, checked as loadFromFile checks them. A roster
+  // operation.
+  bool loadSegments(const string &manifest, int classNum,
+                    const string &category) {
+    NameIndex::Bulk bulk(nameIndex); // postings built once, at the end
+    auto started = chrono::steady_clock::now();
+    uint64_t generation;
+    vector<Segment> segments;
+    if (!readManifest(manifest, generation, segments)) {
+      cout << "[ERROR] Cannot open segment manifest " << manifest << "!\n";
+      return false;
+    }
+    if (classNum != 0) {
+      segments.erase(
+          remove_if(segments.begin(), segments.end(),
+                    [&](const Segment &segment) {
+                      return segment.classNum != classNum ||
+                             (!category.empty() &&
+                              segment.category != category);
+                    }),
+          segments.end());
+    }
+
+    struct SegmentLoad {
+      MappedFile file;
+      bool opened;
+      vector<pair<size_t, ParsedRow>> rows; // line, row
+      vector<string> diagnostics;
+      size_t rejected;
+      size_t repaired;
+      size_t duplicates;
+    };
+    string directory = manifestDirectory(manifest);
+    vector<SegmentLoad> loads(segments.size());
+    parallelFor(segments.size(), [&](size_t index) {
+      SegmentLoad &load = loads[index];
+      string path = directory + segments[index].filename;
+      load.rejected = load.repaired = load.duplicates = 0;
+      load.opened = load.file.open(path);
+      if (!load.opened)
+        return;
+      size_t lineNo = 0;
+      auto report = [&](const char *level, const string &message) {
+        load.diagnostics.push_back(string("[") + level + "] " + path + ":" +
+                                   to_string(lineNo) + ": " + message);
+      };
+      // The roster does not change until the merge, so it can be read here;
+      // a roll number repeated across segments is caught by the merge
+      unordered_set<string> seen;
+      bool duplicate = false;
+      auto notLoaded = [&](const string &rollNo) {
+        duplicate = hashTable.find(rollNo) != nullptr ||
+                    !seen.insert(rollNo).second;
+        return !duplicate;
+      };
+      vector<string_view> tokens;
+      const char *p = load.file.begin();
+      const char *end = p + load.file.size();
+      while (p < end) {
+        const char *newline = (const char *)memchr(p, '\n', end - p);
+        const char *lineEnd = newline == nullptr ? end : newline;
+        string_view line(p, lineEnd - p);
+        p = lineEnd + 1;
+        lineNo++;
+        if (!line.empty() && line.back() == '\r')
+          line.remove_suffix(1);
+        if (line.empty())
+          continue;
+        ParsedRow row;
+        bool rowRepaired = false;
+        duplicate = false;
+        if (!decodeRecord(line, tokens, report, notLoaded, row,
+                          rowRepaired)) {
+          (duplicate ? load.duplicates : load.rejected)++;
+          continue;
+        }
+        if (rowRepaired)
+          load.repaired++;
+        load.rows.push_back({lineNo, std::move(row)});
+      }
+    });
+
+    // Single merge pass in manifest order
+    size_t total = 0;
+    for (const SegmentLoad &load : loads)
+      total += load.rows.size();
+    hashTable.reserve(totalStudents + total);
+
+    const size_t MAX_DIAGNOSTICS = 20;
+    size_t diagnostics = 0;
+    size_t rejected = 0;
+    size_t repaired = 0;
+    size_t duplicates = 0;
+    size_t sharedCnic = 0;
+    size_t missing = 0;
+    int loadedCount = 0;
+    auto show = [&](const string &diagnostic) {
+      if (diagnostics++ < MAX_DIAGNOSTICS)
+        cout << diagnostic << "\n";
+    };
+    for (size_t i = 0; i < loads.size(); i++) {
+      SegmentLoad &load = loads[i];
+      string path = directory + segments[i].filename;
+      if (!load.opened) {
+        cout << "[ERROR] Cannot open " << path << "!\n";
+        missing++;
+        continue;
+      }
+      for (const string &diagnostic : load.diagnostics)
+        show(diagnostic);
+      rejected += load.rejected;
+      repaired += load.repaired;
+      duplicates += load.duplicates;
+      for (pair<size_t, ParsedRow> &row : load.rows) {
+        if (hashTable.find(string(row.second.rollNo)) != nullptr) {
+          duplicates++;
+          continue;
+        }
+        Student *newStudent = buildStudent(row.second);
+        if (newStudent == nullptr) {
+          show("[ERROR] " + path + ":" + to_string(row.first) + ": " +
+               SubjectCatalog::FULL + "; row skipped");
+          rejected++;
+          continue;
+        }
+        Student *holder = cnicHolder(newStudent->getCnicBForm());
+        if (holder != nullptr) {
+          show("[WARNING] " + path + ":" + to_string(row.first) + ": CNIC " +
+               newStudent->getCnicBForm() + " is also enrolled under roll " +
+               holder->rollNo);
+          sharedCnic++;
+        }
+        insertStudent(newStudent);
+        loadedCount++;
+      }
+    }
+
+    if (diagnostics > MAX_DIAGNOSTICS) {
+      cout << "[INFO] " << diagnostics - MAX_DIAGNOSTICS
+           << " further diagnostics not shown.\n";
+    }
+    if (rejected > 0)
+      cout << "[INFO] " << rejected << " malformed rows skipped.\n";
+    if (repaired > 0)
+      cout << "[INFO] " << repaired << " rows repaired.\n";
+    if (duplicates > 0) {
+      cout << "[INFO] " << duplicates
+           << " rows skipped for roll numbers already loaded.\n";
+    }
+    if (sharedCnic > 0) {
+      cout << "[WARNING] " << sharedCnic
+           << " rows share a CNIC/B-Form with another student; list them "
+              "with Find Duplicate CNICs (menu 19) or DUPLICATES.\n";
+    }
+    auto elapsed = chrono::duration_cast<chrono::milliseconds>(
+        chrono::steady_clock::now() - started);
+    cout << "[SUCCESS] " << loadedCount << " students loaded from "
+         << segments.size() - missing << " segments of " << manifest
+         << " in " << elapsed.count() << " ms.\n";
+
+    if (loadedCount > 0 && journal.isOpen())
+      compactJournal(); // bulk loads are not journaled record by record
+    return missing == 0;
+  }
+
+  // Bulk-enroll students from a CSV file with the columns
+  //   roll,name,father,class,category,admissionYear,dob,cnic,address,subjects
+  // (subjects separated by ';', classes 1-7 only). The file is split into
+  // chunks that are parsed and validated in parallel; valid rows are then
+  // merged into the roster in file order in a single pass.
+  void importCSV(string filename) {
+    NameIndex::Bulk bulk(nameIndex); // postings built once, at the end
+    MappedFile mapped;
+    if (!mapped.open(filename)) {
+      cout << "[ERROR] Cannot open file!\n";
+      return;
+    }
+
+    struct Chunk {
+      const char *begin;
+      const char *end;
+      size_t lines;
+      vector<pair<size_t, StudentRecord>> rows; // chunk-local line, record
+      vector<pair<size_t, string>> errors;  // chunk-local line, reason
+      size_t outOfSession;
+    };
+
+    // Cut the file into roughly equal chunks on line boundaries
+    const char *data = mapped.begin();
+    const char *fileEnd = data + mapped.size();
+    size_t chunkCount = max<size_t>(1, min<size_t>(mapped.size() / (1 << 16),
+                                                    4 * workerCount()));
+    vector<Chunk> chunks;
+    const char *cursor = data;
+    for (size_t i = 1; i <= chunkCount && cursor < fileEnd; i++) {
+      const char *cut = i == chunkCount
+                            ? fileEnd
+                            : data + mapped.size() * i / chunkCount;
+      if (cut < cursor)
+        cut = cursor;
+      const char *newline =
+          (const char *)memchr(cut, '\n', fileEnd - cut);
+      const char *chunkEnd = newline == nullptr ? fileEnd : newline + 1;
+      chunks.push_back(Chunk{cursor, chunkEnd, 0, {}, {}, 0});
+      cursor = chunkEnd;
+    }
+
+    int currentYear, currentMonth, currentDay;
+    getCurrentDate(currentYear, currentMonth, currentDay);
+
+    parallelFor(chunks.size(), [&](size_t index) {
+      Chunk &chunk = chunks[index];
+      vector<string> values;
+      vector<string_view> fields;
+      string error;
+      const char *p = chunk.begin;
+      while (p < chunk.end) {
+        const char *newline = (const char *)memchr(p, '\n', chunk.end - p);
+        const char *lineEnd = newline == nullptr ? chunk.end : newline;
+        string_view line(p, lineEnd - p);
+        p = lineEnd + 1;
+        size_t lineNo = chunk.lines++;
+
+        if (!line.empty() && line.back() == '\r')
+          line.remove_suffix(1);
+        if (line.empty())
+          continue;
+        if (index == 0 && lineNo == 0 && startsWithIgnoreCase(line, "roll"))
+          continue; // header row
+
+        if (!splitCSV(line, values)) {
+          chunk.errors.push_back({lineNo, "unbalanced quotes"});
+          continue;
+        }
+        fields.assign(values.begin(), values.end());
+        StudentRecord record;
+        if (!parseStudent(fields.data(), fields.size(), ';', record, error)) {
+          chunk.errors.push_back({lineNo, error});
+          continue;
+        }
+        if (!validateAdmissionDate(stoi(record.className),
+                                   record.admissionYear, currentMonth,
+                                   currentYear))
+          chunk.outOfSession++;
+        chunk.rows.push_back({lineNo, std::move(record)});
       }
-    } else if (className == "11") {
-      if (category == "Computer Science") {
-        subjects = {"English",      "Urdu",     "Maths",
-                    "Physics",      "Islamiat", "Computer Science",
-                    "Mutaila Quran"};
-      } else if (category == "Pre-Engineering") {
-        subjects = {"English",   "Urdu",     "Maths",        "Physics",
-                    "Chemistry", "Islamiat", "Mutaila Quran"};
-      } else if (category == "Pre-Medical") {
-        subjects = {"English",   "Urdu",     "Physics",      "Biology",
-                    "Chemistry", "Islamiat", "Mutaila Quran"};
+    });
+
+    // Single merge pass in file order
+    size_t total = 0;
+    for (const Chunk &chunk : chunks)
+      total += chunk.rows.size();
+    hashTable.reserve(totalStudents + total);
+
+    const size_t MAX_SHOWN = 20;
+    vector<pair<size_t, string>> duplicates; // file line, roll or CNIC
+    size_t invalid = 0;
+    size_t outOfSession = 0;
+    int importedCount = 0;
+    size_t firstLine = 1;
+    for (Chunk &chunk : chunks) {
+      for (const pair<size_t, string> &error : chunk.errors) {
+        if (invalid++ < MAX_SHOWN) {
+          cout << "[ERROR] " << filename << ":" << firstLine + error.first
+               << ": " << error.second << "; row skipped\n";
+        }
       }
-    } else if (className == "12") {
-      if (category == "Computer Science") {
-        subjects = {"English",      "Urdu",        "Maths",
-                    "Physics",      "Pak Studies", "Computer Science",
-                    "Mutaila Quran"};
-      } else if (category == "Pre-Engineering") {
-        subjects = {"English",   "Urdu",        "Maths",        "Physics",
-                    "Chemistry", "Pak Studies", "Mutaila Quran"};
-      } else if (category == "Pre-Medical") {
-        subjects = {"English",   "Urdu",        "Physics",      "Biology",
-                    "Chemistry", "Pak Studies", "Mutaila Quran"};
+      for (const pair<size_t, StudentRecord> &row : chunk.rows) {
+        if (hashTable.find(row.second.rollNo) != nullptr) {
+          duplicates.push_back(
+              {firstLine + row.first, "roll " + row.second.rollNo});
+          continue;
+        }
+        Student *holder = cnicHolder(row.second.cnicBForm);
+        if (holder != nullptr) {
+          duplicates.push_back({firstLine + row.first,
+                                "cnic " + row.second.cnicBForm +
+                                    " (held by roll " + holder->rollNo +
+                                    ")"});
+          continue;
+        }
+        Student *newStudent = createStudent(row.second);
+        if (newStudent == nullptr) {
+          if (invalid++ < MAX_SHOWN) {
+            cout << "[ERROR] " << filename << ":" << firstLine + row.first
+                 << ": " << SubjectCatalog::FULL << "; row skipped\n";
+          }
+          continue;
+        }
+        insertStudent(newStudent);
+        importedCount++;
       }
+      outOfSession += chunk.outOfSession;
+      firstLine += chunk.lines;
     }
 
-    return subjects;
+    if (invalid > MAX_SHOWN) {
+      cout << "[INFO] " << invalid - MAX_SHOWN
+           << " further invalid rows not shown.\n";
+    }
+    if (!duplicates.empty()) {
+      string reportName = filename + ".duplicates.txt";
+      ofstream report(reportName);
+      for (const pair<size_t, string> &dup : duplicates)
+        report << "line " << dup.first << ": " << dup.second << "\n";
+      cout << "[WARNING] " << duplicates.size()
+           << " rows skipped for duplicate roll numbers or CNICs (";
+      for (size_t i = 0; i < duplicates.size() && i < 5; i++)
+        cout << (i > 0 ? ", " : "") << duplicates[i].second;
+      cout << (duplicates.size() > 5 ? ", ..." : "") << "); see "
+           << reportName << "\n";
+    }
+    if (outOfSession > 0) {
+      cout << "[INFO] " << outOfSession
+           << " students have an admission year outside the current "
+              "session.\n";
+    }
+    cout << "[SUCCESS] " << importedCount << " students imported!\n";
+
+    if (importedCount > 0 && journal.isOpen())
+      compactJournal(); // bulk loads are not journaled record by record
   }
 
-public:
-  StudentManager() {
-    head = nullptr;
-    totalStudents = 0;
+  // Optional "class[|category]" scope starting at fields[index]; classNum is
+  // 0 when no class is given
+  bool parseScope(const vector<string_view> &fields, size_t index,
+                  int &classNum, string &category, string &error) {
+    classNum = 0;
+    category.clear();
+    if (fields.size() <= index || fields[index].empty())
+      return true;
+    if (!parseNumber(fields[index], classNum) || classNum < 1 ||
+        classNum > 12) {
+      error = "class must be 1-12";
+      return false;
+    }
+    if (fields.size() > index + 1)
+      category = resolveCategory(classNum, fields[index + 1]);
+    return true;
   }
 
-  void addStudent() {
-    cout << "\n--- Adding Student ---\n";
+  static const char *statusName(BatchStatus status) {
+    static const char *const names[] = {
+        "OK", "NOT_FOUND", "DUPLICATE", "INVALID", "UNKNOWN_COMMAND", "FAILED"};
+    return names[status];
+  }
 
-    string rollNo = getValidInput("Enter Roll Number", false);
-    if (searchInHashTable(rollNo) != nullptr) {
-      cout << "[ERROR] Roll number already exists!\n";
-      return;
+  // Append the response line "<code> <status>[ <detail>]"
+  static void appendStatus(string &out, BatchStatus status,
+                           const string &detail) {
+    out += to_string((int)status);
+    out += ' ';
+    out += statusName(status);
+    if (!detail.empty()) {
+      out += ' ';
+      out += detail;
     }
+    out += '\n';
+  }
 
-    string name = getValidInput("Enter Name", false);
-    string fatherName = getValidInput("Enter Father's Name", false);
-    string className = getValidInput("Enter Class (1-12)", false);
-
-    string classCategory = "";
-    vector<string> subjects;
+  static string commandName(string_view field) {
+    string command(field);
+    for (char &c : command)
+      c = (char)toupper((unsigned char)c);
+    return command;
+  }
 
-    int classNum = stoi(className);
+  // Commands that act on the student named by their second field
+  static bool needsStudent(const string &command) {
+    return command == "MARKS" || command == "ATTEND" || command == "TERMS" ||
+           command == "DELETE" || command == "QUERY" || command == "RANK" ||
+           command == "PRESENT" || command == "ATTENDANCE";
+  }
 
-    if (classNum >= 1 && classNum <= 7) {
-      string numStr = getValidInput("How many subjects? (minimum 1)", false);
-      int numSubjects = stoi(numStr);
+  // Commands that touch only the students they name, so an open archive
+  // need not be loaded in full for them
+  static bool touchesNamedStudents(const string &command) {
+    return command == "ADD" || command == "MARKS" || command == "ATTEND" ||
+           command == "TERMS" || command == "DELETE" || command == "QUERY" ||
+           command == "QUERYMANY" || command == "PRESENT" ||
+           command == "ATTENDANCE" || command == "ATTENDMANY" ||
+           command == "ATTACH";
+  }
 
-      if (numSubjects < 1) {
-        cout << "[ERROR] At least 1 subject required!\n";
-        return;
+  // Run one command split into `fields`. `beforeConsole` is called before a
+  // command that reports through the console. A roster operation.
+  BatchStatus runCommand(const vector<string_view> &fields, string &detail,
+                         const function<void()> &beforeConsole) {
+    string command = commandName(fields[0]);
+    detail.clear();
+    if (archive.isOpen() && !touchesNamedStudents(command)) {
+      beforeConsole();
+      loadArchive();
+    } else if (archive.isOpen() && command == "QUERYMANY" &&
+               fields.size() > 1) {
+      for (const string &roll : splitRolls(fields[1]))
+        searchInHashTable(roll); // queryMany does not read the archive
+    }
+    Student *student = nullptr;
+    if (needsStudent(command)) {
+      if (fields.size() < 2 || fields[1].empty()) {
+        detail = "missing roll number";
+        return BATCH_INVALID;
+      }
+      student = searchInHashTable(string(fields[1]));
+      if (student == nullptr) {
+        detail = "roll " + string(fields[1]);
+        return BATCH_NOT_FOUND;
       }
+    }
+    BatchStatus status =
+        executeCommand(command, fields, student, detail, beforeConsole);
+    trimArchiveCache();
+    return status;
+  }
 
-      for (int i = 0; i < numSubjects; i++) {
-        string subName =
-            getValidInput("Subject " + to_string(i + 1) + " Name", false);
-        subjects.push_back(subName);
+  // The body of runCommand once `student` has been looked up. For QUERY,
+  // ATTENDANCE, MARKS, ATTEND and TERMS it touches nothing but `student`,
+  // the journal and the locked indexes, so serveRecord also runs those
+  // inside a record operation.
+  BatchStatus executeCommand(const string &command,
+                             const vector<string_view> &fields,
+                             Student *student, string &detail,
+                             const function<void()> &beforeConsole) {
+    BatchStatus status = BATCH_OK;
+    int classNum;
+    string category;
+    if (command == "ADD") {
+      status = batchAdd(fields, detail);
+    } else if (command == "MARKS") {
+      status = batchMarks(student, fields, detail);
+    } else if (command == "ATTEND") {
+      status = batchAttend(student, fields, detail);
+    } else if (command == "TERMS") {
+      int terms;
+      if (fields.size() < 3 || !parseNumber(fields[2], terms) || terms < 0 ||
+          terms > 3) {
+        status = BATCH_INVALID;
+        detail = "terms must be 0-3";
+      } else {
+        beforeChange(student);
+        changeRecord(student, 0, [&](RecordVersion &version) {
+          student->setTermsCompleted(terms, version);
+        });
+        logTerms(student);
       }
-    } else if (classNum >= 8 && classNum <= 12) {
-      cout << "\nSelect Category:\n";
-      if (classNum >= 8 && classNum <= 10) {
-        cout << "1. Computer Science\n2. Biology\n";
+    } else if (command == "DELETE") {
+      string rollNo = student->rollNo;
+      deleteRecord(rollNo);
+    } else if (command == "QUERY") {
+      ostringstream record;
+      writeRecord(record, student);
+      detail = record.str();
+    } else if (command == "QUERYMANY") {
+      if (fields.size() < 2 || fields[1].empty()) {
+        status = BATCH_INVALID;
+        detail = "usage QUERYMANY|roll,roll,...";
       } else {
-        cout << "1. Computer Science\n2. Pre-Engineering\n3. Pre-Medical\n";
+        detail = queryMany(splitRolls(fields[1]));
       }
-
-      string choiceStr = getValidInput("Enter choice", false);
-      int choice = stoi(choiceStr);
-
-      if (classNum >= 8 && classNum <= 10) {
-        if (choice == 1)
-          classCategory = "Computer Science";
-        else if (choice == 2)
-          classCategory = "Biology";
+    } else if (command == "RECOMPUTE") {
+      if (parseScope(fields, 1, classNum, category, detail)) {
+        int count = classNum == 0 ? recomputeAllGrades()
+                                  : recomputeClassGrades(classNum, category);
+        detail = "students=" + to_string(count);
       } else {
-        if (choice == 1)
-          classCategory = "Computer Science";
-        else if (choice == 2)
-          classCategory = "Pre-Engineering";
-        else if (choice == 3)
-          classCategory = "Pre-Medical";
+        status = BATCH_INVALID;
       }
-
-      subjects = getSubjectsForClass(className, classCategory);
+    } else if (command == "PROMOTE") {
+      if (parseScope(fields, 1, classNum, category, detail)) {
+        int promoted = 0;
+        int notEligible = 0;
+        promoteStudents(promoted, notEligible, nullptr, classNum, category);
+        detail = "promoted=" + to_string(promoted) +
+                 " notEligible=" + to_string(notEligible);
+      } else {
+        status = BATCH_INVALID;
+      }
+    } else if (command == "RANK") {
+      size_t classSize;
+      size_t rank = meritRank(student, classSize);
+      detail = to_string(rank) + "/" + to_string(classSize);
+    } else if (command == "TOP" || command == "RANGE") {
+      int scope = 0;
+      size_t count = 10;
+      float lowest = 0;
+      float highest = 0;
+      bool valid = fields.size() < 2 || fields[1].empty() ||
+                   (parseNumber(fields[1], scope) && scope >= 0 &&
+                    scope <= 12);
+      if (command == "TOP")
+        valid = valid && (fields.size() < 3 || parseNumber(fields[2], count));
+      else
+        valid = valid && fields.size() >= 4 &&
+                parseNumber(fields[2], lowest) &&
+                parseNumber(fields[3], highest);
+      if (!valid) {
+        status = BATCH_INVALID;
+        detail = command == "TOP" ? "usage TOP[|class[|count]]"
+                                  : "usage RANGE|class|lowest|highest";
+      } else {
+        vector<Student *> list =
+            command == "TOP" ? topStudents(scope, count)
+                             : studentsInRange(scope, lowest, highest);
+        detail = to_string(list.size());
+        for (size_t i = 0; i < list.size(); i++) {
+          detail += i == 0 ? ' ' : ',';
+          detail += list[i]->rollNo;
+        }
+      }
+    } else if (command == "BANDS") {
+      int scope = 0;
+      if (fields.size() > 1 && !fields[1].empty() &&
+          (!parseNumber(fields[1], scope) || scope < 0 || scope > 12)) {
+        status = BATCH_INVALID;
+        detail = "class must be 0-12";
+      } else {
+        size_t counts[6];
+        gradeBands(scope, counts);
+        for (int band = 0; band < 6; band++) {
+          detail += band == 0 ? "" : " ";
+          detail += (char)('A' + band);
+          detail += "=" + to_string(counts[band]);
+        }
+      }
+    } else if (command == "BORN" || command == "PRESENT") {
+      // BORN|from|to and PRESENT|roll|from|to, dates as YYYY-MM-DD
+      size_t first = command == "BORN" ? 1 : 2;
+      int32_t from, to;
+      if (fields.size() < first + 2 ||
+          !Calendar::parseDateKey(fields[first], from) ||
+          !Calendar::parseDateKey(fields[first + 1], to)) {
+        status = BATCH_INVALID;
+        detail = command == "BORN" ? "usage BORN|YYYY-MM-DD|YYYY-MM-DD"
+                                   : "usage PRESENT|roll|YYYY-MM-DD|"
+                                     "YYYY-MM-DD";
+      } else if (command == "BORN") {
+        vector<Student *> list = bornBetween(from, to);
+        detail = to_string(list.size());
+        for (size_t i = 0; i < list.size(); i++) {
+          detail += i == 0 ? ' ' : ',';
+          detail += list[i]->rollNo;
+        }
+      } else {
+        int marked, present;
+        student->record().attendance.countBetween(from, to, marked, present);
+        detail = "present=" + to_string(present) +
+                 " marked=" + to_string(marked);
+      }
+    } else if (command == "ATTENDCLASS" || command == "ATTENDMANY") {
+      // ATTENDCLASS|YYYY-MM-DD|P/A|class[|category] and
+      // ATTENDMANY|YYYY-MM-DD|P/A|roll,roll,...
+      bool isClass = command == "ATTENDCLASS";
+      int32_t days;
+      int year, month, day;
+      vector<Student *> students;
+      string missing;
+      if (fields.size() < 4 || !Calendar::parseDateKey(fields[1], days) ||
+          (fields[2] != "P" && fields[2] != "A" && fields[2] != "p" &&
+           fields[2] != "a") ||
+          (isClass && (!parseScope(fields, 3, classNum, category, detail) ||
+                       classNum == 0))) {
+        status = BATCH_INVALID;
+        detail = isClass ? "usage ATTENDCLASS|YYYY-MM-DD|P/A|class"
+                           "[|category]"
+                         : "usage ATTENDMANY|YYYY-MM-DD|P/A|roll,roll,...";
+      } else if (isClass) {
+        students = classMembers(classNum, category);
+      } else if (!findStudents(splitRolls(fields[3]), students, missing)) {
+        status = BATCH_NOT_FOUND;
+        detail = "roll " + missing;
+      }
+      if (status == BATCH_OK) {
+        Calendar::fromDayNumber(days, year, month, day);
+        bool present = fields[2] == "P" || fields[2] == "p";
+        if (markAttendanceFor(students, year, month, day, present)) {
+          detail = "marked=" + to_string(students.size());
+        } else {
+          status = BATCH_INVALID;
+          detail = "date must be a valid day in 2024-2034";
+        }
+      }
+    } else if (command == "ABSENTEES" || command == "ROLLCALL") {
+      // ABSENTEES|YYYY-MM-DD[|class[|category]] lists the absent roll
+      // numbers, ROLLCALL counts present and absent students
+      int32_t day;
+      if (fields.size() < 2 || !Calendar::parseDateKey(fields[1], day) ||
+          !parseScope(fields, 2, classNum, category, detail)) {
+        status = BATCH_INVALID;
+        detail = "usage " + command + "|YYYY-MM-DD[|class[|category]]";
+      } else {
+        vector<Student *> present, absent;
+        attendanceOn(day, classNum, category, present, absent);
+        if (command == "ROLLCALL") {
+          detail = "present=" + to_string(present.size()) +
+                   " absent=" + to_string(absent.size());
+        } else {
+          detail = to_string(absent.size());
+          for (size_t i = 0; i < absent.size(); i++) {
+            detail += i == 0 ? ' ' : ',';
+            detail += absent[i]->rollNo;
+          }
+        }
+      }
+    } else if (command == "ATTENDANCE") {
+      // ATTENDANCE|roll[|YYYY-MM-DD], the date defaulting to today
+      int32_t day = today();
+      if (fields.size() > 2 && !Calendar::parseDateKey(fields[2], day)) {
+        status = BATCH_INVALID;
+        detail = "usage ATTENDANCE|roll[|YYYY-MM-DD]";
+      } else {
+        const char *names[] = {"month", "term", "session"};
+        int present[3], marked[3];
+        termAttendance(student, day, present, marked);
+        for (int i = 0; i < 3; i++) {
+          detail += i == 0 ? "" : " ";
+          detail += string(names[i]) + "=" + to_string(present[i]) + "/" +
+                    to_string(marked[i]);
+        }
+      }
+    } else if (command == "BELOW") {
+      // BELOW[|percent[|class[|YYYY-MM-DD]]]
+      float threshold = 75;
+      int scope = 0;
+      int32_t day = today();
+      if ((fields.size() > 1 && !fields[1].empty() &&
+           !parseNumber(fields[1], threshold)) ||
+          (fields.size() > 2 && !fields[2].empty() &&
+           (!parseNumber(fields[2], scope) || scope < 0 || scope > 12)) ||
+          (fields.size() > 3 && !Calendar::parseDateKey(fields[3], day))) {
+        status = BATCH_INVALID;
+        detail = "usage BELOW[|percent[|class[|YYYY-MM-DD]]]";
+      } else {
+        vector<AttendanceShortfall> list =
+            belowAttendance(threshold, scope, day);
+        detail = to_string(list.size());
+        for (size_t i = 0; i < list.size(); i++) {
+          detail += i == 0 ? ' ' : ',';
+          detail += list[i].student->rollNo;
+        }
+      }
+    } else if (command == "DUPLICATES") {
+      size_t limit = 20;
+      if (fields.size() > 1 && !parseNumber(fields[1], limit)) {
+        status = BATCH_INVALID;
+        detail = "usage DUPLICATES[|limit]";
+      } else {
+        vector<pair<uint64_t, vector<Student *>>> groups = duplicateCnics();
+        detail = to_string(groups.size());
+        for (size_t i = 0; i < groups.size() && i < limit; i++) {
+          detail += i == 0 ? ' ' : ';';
+          detail += StudentStore::formatCnic(groups[i].first) + ":";
+          for (size_t j = 0; j < groups[i].second.size(); j++) {
+            detail += j == 0 ? "" : ",";
+            detail += groups[i].second[j]->rollNo;
+          }
+        }
+      }
+    } else if (command == "STATS") {
+      detail = memoryStats();
+    } else if (command == "FIND") {
+      size_t limit = 20;
+      if (fields.size() < 2 || fields[1].empty() ||
+          (fields.size() > 2 && !parseNumber(fields[2], limit))) {
+        status = BATCH_INVALID;
+        detail = "usage FIND|text[|limit]";
+      } else {
+        vector<Student *> results;
+        size_t total = findByName(string(fields[1]), limit, results);
+        detail = to_string(total);
+        for (size_t i = 0; i < results.size(); i++) {
+          detail += i == 0 ? ' ' : ',';
+          detail += results[i]->rollNo;
+        }
+      }
+    } else if (command == "ROSTER") {
+      if (parseScope(fields, 1, classNum, category, detail) &&
+          classNum != 0) {
+        vector<Student *> members = classMembers(classNum, category);
+        detail = to_string(members.size());
+        for (size_t i = 0; i < members.size(); i++) {
+          detail += i == 0 ? ' ' : ',';
+          detail += members[i]->rollNo;
+        }
+      } else {
+        status = BATCH_INVALID;
+        if (detail.empty())
+          detail = "missing class";
+      }
+    } else if (command == "SAVE" || command == "LOAD" ||
+               command == "IMPORT" || command == "SNAPSHOT" ||
+               command == "BGSAVE" || command == "ATTACH" ||
+               command == "SEGSAVE" || command == "SEGLOAD") {
+      // These report through the console (stderr outside the menu), so
+      // keep output in order
+      beforeConsole();
+      string filename = fields.size() > 1 ? string(fields[1]) : "";
+      if (command == "SAVE" && fields.size() > 2) {
+        if (parseScope(fields, 2, classNum, category, detail))
+          saveClassToFile(classNum, category,
+                          filename.empty() ? "students.txt" : filename);
+        else
+          status = BATCH_INVALID;
+      } else if (command == "SAVE") {
+        saveToFile(filename.empty() ? "students.txt" : filename);
+      } else if (command == "BGSAVE") {
+        if (!saveInBackground(filename.empty() ? "students.txt" : filename)) {
+          status = BATCH_FAILED;
+          detail = "a background save is still running";
+        }
+      } else if (command == "LOAD") {
+        loadFromFile(filename.empty() ? "students.txt" : filename);
+      } else if (command == "IMPORT") {
+        importCSV(filename.empty() ? "students.csv" : filename);
+      } else if (command == "SEGSAVE" || command == "SEGLOAD") {
+        string manifest = filename.empty() ? "students.manifest" : filename;
+        if (!parseScope(fields, 2, classNum, category, detail))
+          status = BATCH_INVALID;
+        else if (command == "SEGSAVE" &&
+                 !saveSegments(manifest, classNum, category))
+          status = BATCH_FAILED;
+        else if (command == "SEGLOAD" &&
+                 !loadSegments(manifest, classNum, category))
+          status = BATCH_FAILED;
+      } else if (command == "ATTACH") {
+        int capacity = (int)ARCHIVE_CACHE;
+        if (fields.size() > 2 &&
+            (!parseNumber(fields[2], capacity) || capacity < 0)) {
+          status = BATCH_INVALID;
+          detail = "usage ATTACH[|file[|cache]]";
+        } else if (!attachArchive(filename.empty() ? "students.txt"
+                                                   : filename,
+                                  (size_t)capacity)) {
+          status = BATCH_FAILED;
+          detail = "cannot open archive";
+        }
+      } else if (!compactJournal()) {
+        status = BATCH_FAILED;
+        detail = "snapshot not saved";
+      }
+    } else {
+      status = BATCH_UNKNOWN;
+      detail = command;
     }
 
-    string admissionYearStr =
-        getValidInput("Enter Admission Year", false, validateYear);
-    int admissionYear = stoi(admissionYearStr);
-
-    string dob =
-        getValidInput("Enter Date of Birth (DDMMYYYY)", true, validateDOB);
-    string formattedDOB = dob.empty() ? "" : formatDOB(dob);
-
-    string cnic =
-        getValidInput("Enter CNIC/B-Form (13 digits)", true, validateCNIC);
-    string formattedCNIC = cnic.empty() ? "" : formatCNIC(cnic);
-
-    string address = getValidInput("Enter Address", true);
+    return status;
+  }
 
-    Student *newStudent =
-        new Student(rollNo, name, fatherName, className, classCategory,
-                    admissionYear, formattedDOB, formattedCNIC, address);
+  // Run QUERY, QUERYMANY, ATTENDANCE, MARKS, ATTEND, TERMS or DELETE as a
+  // record operation. False for any other command, which has to go through
+  // runCommand as a roster operation.
+  bool serveRecord(const vector<string_view> &fields, string &detail,
+                   BatchStatus &status) {
+    string command = commandName(fields[0]);
+    bool reads = command == "QUERY" || command == "ATTENDANCE";
+    bool writes =
+        command == "MARKS" || command == "ATTEND" || command == "TERMS";
+    if (!reads && !writes && command != "DELETE" && command != "QUERYMANY")
+      return false;
+    auto noConsole = [] {};
+    detail.clear();
+    status = BATCH_OK;
+    if (command == "QUERYMANY") {
+      if (fields.size() > 1)
+        faultIn(splitRolls(fields[1]));
+      status = executeCommand(command, fields, nullptr, detail, noConsole);
+      return true;
+    }
+    if (fields.size() < 2 || fields[1].empty()) {
+      detail = "missing roll number";
+      status = BATCH_INVALID;
+      return true;
+    }
 
-    for (const string &sub : subjects) {
-      newStudent->addSubject(sub, "-");
+    string rollNo(fields[1]);
+    faultIn({rollNo});
+    EpochDomain::Section section(epochs);
+    bool found = false;
+    if (command == "DELETE") {
+      found = deleteRecord(rollNo);
+    } else if (reads) {
+      readStudent(rollNo, [&](Student *student) {
+        found = student != nullptr;
+        if (found) {
+          detail.clear();
+          status = executeCommand(command, fields, student, detail, noConsole);
+        }
+      });
+    } else {
+      found = writeStudent(rollNo, [&](Student *student) {
+        status = executeCommand(command, fields, student, detail, noConsole);
+      });
+    }
+    if (!found) {
+      detail = "roll " + rollNo;
+      status = BATCH_NOT_FOUND;
     }
+    return true;
+  }
 
-    if (head == nullptr) {
-      head = newStudent;
+  // Server mode: run one request line and append its response line to
+  // `response`. Safe to call from many threads at once; record commands run
+  // as record operations and everything else under a RosterLock. True if
+  // the response acknowledges changes that syncJournal still has to make
+  // durable before it is sent.
+  bool serveRequest(string_view line, string &response) {
+    vector<string_view> fields;
+    string detail;
+    BatchStatus status;
+    if (!line.empty() && line.back() == '\r')
+      line.remove_suffix(1);
+    beginJournalWrites();
+    if (line.empty()) {
+      status = BATCH_INVALID;
+      detail = "empty request";
     } else {
-      Student *temp = head;
-      while (temp->next != nullptr) {
-        temp = temp->next;
+      splitFields(line, fields);
+      if (!serveRecord(fields, detail, status)) {
+        RosterLock roster(*this);
+        status = runCommand(fields, detail, [] {});
       }
-      temp->next = newStudent;
     }
+    bool unsynced = endJournalWrites(status, detail);
+    appendStatus(response, status, detail);
+    return unsynced;
+  }
 
-    addToHashTable(newStudent);
-    totalStudents++;
-
-    cout << "[SUCCESS] Student added successfully!\n";
-    cout << "Total students: " << totalStudents << "\n";
+  // The response line for a change whose journal records could not be
+  // synced
+  static void appendUnsynced(string &response) {
+    appendStatus(response, BATCH_FAILED,
+                 "journal sync failed; SNAPSHOT saves the change");
   }
 
-  void markAttendance(string rollNo) {
-    cout << "\n--- Mark Attendance ---\n";
+  // Run one command per line from `input` without prompts. Every command
+  // produces one line "<code> <status>[ <detail>]" (QUERYMANY adds one line
+  // per record found); blank lines and lines starting with # are skipped.
+  // Returns the number of failed commands. The whole run is a roster
+  // operation.
+  long runBatch(LineReader &input, FILE *output) {
+    const size_t FLUSH_AT = 1 << 16;
+    RosterLock roster(*this);
+
+    string out;
+    string detail;
+    long failures = 0;
+    vector<string_view> fields;
+    string_view line;
+    // Offset and length of the lines in `out` acknowledging changes that
+    // are not yet synced
+    vector<pair<size_t, size_t>> unsynced;
+    auto flush = [&]() {
+      if (!unsynced.empty() && !journal.sync()) {
+        string rewritten;
+        size_t copied = 0;
+        for (const pair<size_t, size_t> &change : unsynced) {
+          rewritten.append(out, copied, change.first - copied);
+          appendUnsynced(rewritten);
+          copied = change.first + change.second;
+        }
+        rewritten.append(out, copied, string::npos);
+        out.swap(rewritten);
+        failures += (long)unsynced.size();
+      }
+      unsynced.clear();
+      fwrite(out.data(), 1, out.size(), output);
+      fflush(output);
+      out.clear();
+    };
+
+    while (input.next(line)) {
+      if (!line.empty() && line.back() == '\r')
+        line.remove_suffix(1);
+      if (line.empty() || line[0] == '#')
+        continue;
 
-    Student *student = searchInHashTable(rollNo);
-    if (student == nullptr) {
-      cout << "[ERROR] Student not found!\n";
-      return;
+      splitFields(line, fields);
+      beginJournalWrites();
+      BatchStatus status = runCommand(fields, detail, flush);
+      bool changed = endJournalWrites(status, detail);
+      if (status != BATCH_OK)
+        failures++;
+      size_t start = out.size();
+      appendStatus(out, status, detail);
+      if (changed)
+        unsynced.emplace_back(start, out.size() - start);
+      if (out.size() >= FLUSH_AT)
+        flush();
     }
 
-    cout << "Student: " << student->name << "\n";
+    flush();
+    return failures;
+  }
 
-    string yearStr = getValidInput("Enter Year (2024-2034)", false);
-    int year = stoi(yearStr);
-    if (year < 2024 || year > 2034) {
-      cout << "[ERROR] Year must be between 2024-2034!\n";
-      return;
+  // Top `count` students of a class (the whole school when classNum is 0)
+  // in merit order
+  vector<Student *> topStudents(int classNum, size_t count) {
+    ensureMeritIndex();
+    vector<Student *> result;
+    for (int c = 1; c <= MeritIndex::CLASSES; c++) {
+      if (classNum == 0 || c == classNum)
+        meritIndex.positions(c, 0, count, result);
+    }
+    if (classNum == 0) {
+      sort(result.begin(), result.end(), MeritIndex::meritBefore);
+      if (result.size() > count)
+        result.resize(count);
     }
+    return result;
+  }
 
-    string monthStr = getValidInput("Enter Month (1-12)", false);
-    int month = stoi(monthStr);
-    if (month < 1 || month > 12) {
-      cout << "[ERROR] Invalid month!\n";
-      return;
+  // Students with lowest <= percentage < highest, in merit order; the same
+  // half-open bands calculateGrade uses
+  vector<Student *> studentsInRange(int classNum, float lowest,
+                                    float highest) {
+    ensureMeritIndex();
+    vector<Student *> result;
+    for (int c = 1; c <= MeritIndex::CLASSES; c++) {
+      if (classNum == 0 || c == classNum) {
+        meritIndex.positions(c, meritIndex.countAtLeast(c, highest),
+                             meritIndex.countAtLeast(c, lowest), result);
+      }
     }
+    if (classNum == 0)
+      sort(result.begin(), result.end(), MeritIndex::meritBefore);
+    return result;
+  }
 
-    string dayStr = getValidInput("Enter Day", false);
-    int day = stoi(dayStr);
-    int maxDays = student->attendance.getDaysInMonth(month, year);
-    if (day < 1 || day > maxDays) {
-      cout << "[ERROR] Invalid day for this month!\n";
-      return;
+  // Students born between two day numbers (both included), oldest first.
+  // A sweep over the packed birth-day column; no dates are parsed.
+  vector<Student *> bornBetween(int32_t from, int32_t to) {
+    vector<pair<int32_t, Student *>> matches;
+    for (size_t slot = 0; slot < store.slotCount(); slot++) {
+      int32_t day = store.birthDay[slot];
+      if (day >= from && day <= to && store.owner[slot] != nullptr)
+        matches.push_back({day, store.owner[slot]});
     }
+    sort(matches.begin(), matches.end(),
+         [](const pair<int32_t, Student *> &a,
+            const pair<int32_t, Student *> &b) {
+           if (a.first != b.first)
+             return a.first < b.first;
+           return a.second->rollNo < b.second->rollNo;
+         });
+    vector<Student *> result;
+    result.reserve(matches.size());
+    for (const pair<int32_t, Student *> &match : matches)
+      result.push_back(match.second);
+    return result;
+  }
 
-    string status = getValidInput("Mark as (P=Present, A=Absent)", false);
-    bool present = (status == "P" || status == "p");
+  // Present and marked days of a student in the month, term and session
+  // (in that order) that `day` falls in
+  void termAttendance(Student *student, int32_t day, int present[3],
+                      int marked[3]) {
+    termAttendance(student->getClassNumber(), student->record().attendance,
+                   day, present, marked);
+  }
 
-    student->attendance.markAttendance(year, month, day, present);
-    cout << "[SUCCESS] Attendance marked!\n";
+  void termAttendance(int classNum, const Calendar &attendance, int32_t day,
+                      int present[3], int marked[3]) {
+    const AttendanceScope scopes[] = {MONTH, TERM, SESSION};
+    for (int i = 0; i < 3; i++) {
+      int32_t from, to;
+      attendanceRange(classNum, day, scopes[i], from, to);
+      attendance.countBetween(from, to, marked[i], present[i]);
+    }
   }
 
-  void promoteAllStudents() {
-    cout << "\n--- Promoting All Students ---\n";
-    Student *current = head;
-    int promoted = 0;
-    int notEligible = 0;
+  struct AttendanceShortfall {
+    Student *student;
+    int present;
+    int marked;
+  };
+
+  // Students (of one class, or all when classNum is 0) whose attendance in
+  // the term that `day` falls in is below `threshold` percent, lowest
+  // first. Students with no marked day in the term are left out. The
+  // counts come from the prefix sums of each calendar, computed for slot
+  // blocks in parallel.
+  vector<AttendanceShortfall> belowAttendance(float threshold, int classNum,
+                                              int32_t day) {
+    const size_t BLOCK = 1 << 14;
+    int32_t from[MeritIndex::CLASSES + 1], to[MeritIndex::CLASSES + 1];
+    for (int c = 0; c <= MeritIndex::CLASSES; c++)
+      attendanceRange(c, day, TERM, from[c], to[c]);
+
+    size_t slots = store.slotCount();
+    vector<int> present(slots), marked(slots);
+    parallelFor((slots + BLOCK - 1) / BLOCK, [&](size_t block) {
+      size_t last = min(slots, (block + 1) * BLOCK);
+      for (size_t slot = block * BLOCK; slot < last; slot++) {
+        Student *student = store.owner[slot];
+        int c = store.classNumber[slot];
+        if (student == nullptr || (classNum != 0 && c != classNum))
+          continue;
+        if (c < 0 || c > MeritIndex::CLASSES)
+          c = 0;
+        student->record().attendance.countBetween(
+            from[c], to[c], marked[slot], present[slot]);
+      }
+    });
 
-    // Check current date to determine if it's promotion time
-    int currentYear, currentMonth, currentDay;
-    getCurrentDate(currentYear, currentMonth, currentDay);
+    vector<AttendanceShortfall> result;
+    for (size_t slot = 0; slot < slots; slot++) {
+      if (marked[slot] > 0 && present[slot] * 100.0 < threshold * marked[slot])
+        result.push_back({store.owner[slot], present[slot], marked[slot]});
+    }
+    sort(result.begin(), result.end(),
+         [](const AttendanceShortfall &a, const AttendanceShortfall &b) {
+           long long left = (long long)a.present * b.marked;
+           long long right = (long long)b.present * a.marked;
+           if (left != right)
+             return left < right;
+           return a.student->rollNo < b.student->rollNo;
+         });
+    return result;
+  }
 
-    while (current != nullptr) {
-      int classNum = stoi(current->className);
-      if (classNum < 12) {
-        // Check if it's the right time for promotion based on class
-        bool isPromotionTime = false;
-
-        if (classNum >= 1 && classNum <= 7) {
-          // Classes 1-7: Papers in February, new session starts in March
-          isPromotionTime = (currentMonth >= 3);
-        } else if (classNum >= 8 && classNum <= 10) {
-          // Classes 8-10: Papers in February/March, new session in April
-          isPromotionTime = (currentMonth >= 4);
-        } else if (classNum >= 11 && classNum <= 12) {
-          // Classes 11-12: Papers in May/June, new session in June/July
-          isPromotionTime = (currentMonth >= 6);
-        }
+  // Position of a student within its class, 1 being the best
+  size_t meritRank(Student *student, size_t &classSize) {
+    ensureMeritIndex();
+    classSize = meritIndex.classSize(student->getClassNumber());
+    return meritIndex.rank(student);
+  }
 
-        if (isPromotionTime) {
-          if (current->promoteToNextClass()) {
-            promoted++;
-          } else {
-            notEligible++;
-            cout << "[INFO] Student " << current->name
-                 << " (Roll: " << current->rollNo
-                 << ") cannot be promoted yet.\n";
-            cout << "  - Terms completed: " << current->termsCompleted
-                 << "/3\n";
-            cout << "  - Board marks entered: "
-                 << (current->boardMarksEntered ? "Yes" : "No") << "\n";
-            cout << "  - Percentage calculated: "
-                 << (current->percentage > 0 ? "Yes" : "No") << "\n";
-          }
-        } else {
-          cout << "[INFO] It's not promotion time for class " << classNum
-               << " yet.\n";
-        }
+  // Students per grade A-F (counts[0] is A), counted from the index with
+  // calculateGrade's thresholds
+  void gradeBands(int classNum, size_t counts[6]) {
+    static const float thresholds[] = {90, 80, 70, 60, 50};
+    ensureMeritIndex();
+    for (int band = 0; band < 6; band++)
+      counts[band] = 0;
+    for (int c = 1; c <= MeritIndex::CLASSES; c++) {
+      if (classNum != 0 && c != classNum)
+        continue;
+      size_t above = 0;
+      for (int band = 0; band < 5; band++) {
+        size_t atLeast = meritIndex.countAtLeast(c, thresholds[band]);
+        counts[band] += atLeast - above;
+        above = atLeast;
       }
-      current = current->next;
+      counts[5] += meritIndex.classSize(c) - above;
     }
+  }
 
-    cout << "[SUCCESS] " << promoted << " students promoted!\n";
-    if (notEligible > 0) {
-      cout << "[INFO] " << notEligible
-           << " students were not eligible for promotion.\n";
+  void showMeritList(const vector<Student *> &students) {
+    cout << left << setw(6) << "Pos" << setw(14) << "Roll Number" << setw(24)
+         << "Name" << setw(8) << "Class" << setw(12) << "Percentage"
+         << "Grade\n";
+    for (size_t i = 0; i < students.size(); i++) {
+      Student *student = students[i];
+      cout << setw(6) << i + 1 << setw(14) << student->rollNo << setw(24)
+           << student->getName() << setw(8) << student->getClassName() << fixed
+           << setprecision(2) << setw(12) << student->getPercentage()
+           << student->getGrade() << "\n";
     }
+    cout << right;
   }
 
-  void updateMarks(string rollNo) {
-    cout << "\n--- Update Marks ---\n";
+  // Every CNIC held by more than one student, in CNIC order, with its
+  // holders in roll number order. One pass over the CNIC index.
+  vector<pair<uint64_t, vector<Student *>>> duplicateCnics() {
+    vector<pair<uint64_t, vector<Student *>>> result;
+    result.reserve(cnicIndex.duplicateGroups());
+    cnicIndex.forEachGroup(
+        [&](uint64_t key, const vector<Student *> &holders) {
+          result.push_back({key, holders});
+          sort(result.back().second.begin(), result.back().second.end(),
+               [](Student *a, Student *b) { return a->rollNo < b->rollNo; });
+        });
+    sort(result.begin(), result.end(),
+         [](const pair<uint64_t, vector<Student *>> &a,
+            const pair<uint64_t, vector<Student *>> &b) {
+           return a.first < b.first;
+         });
+    return result;
+  }
 
-    Student *student = searchInHashTable(rollNo);
-    if (student == nullptr) {
-      cout << "[ERROR] Student not found!\n";
+  void findDuplicateCnics() {
+    cout << "\n--- Duplicate CNIC/B-Form Numbers ---\n";
+    const size_t MAX_SHOWN = 20;
+    vector<pair<uint64_t, vector<Student *>>> groups = duplicateCnics();
+    if (groups.empty()) {
+      cout << "[INFO] Every CNIC/B-Form is held by one student.\n";
       return;
     }
-
-    if (student->subjectHead == nullptr) {
-      cout << "[ERROR] No subjects found!\n";
-      return;
+    for (size_t i = 0; i < groups.size() && i < MAX_SHOWN; i++) {
+      cout << "  " << StudentStore::formatCnic(groups[i].first) << " ("
+           << groups[i].second.size() << " students)\n";
+      for (Student *student : groups[i].second)
+        cout << "    " << student->rollNo << "  " << student->getName()
+             << "  (Class " << student->getClassName() << ")\n";
     }
+    if (groups.size() > MAX_SHOWN)
+      cout << "[INFO] " << groups.size() - MAX_SHOWN
+           << " further groups not shown.\n";
+    cout << "[WARNING] " << groups.size()
+         << " CNIC/B-Form numbers are shared by more than one student.\n";
+  }
 
-    cout << "\nStudent: " << student->name << "\n";
-
-    Subject *current = student->subjectHead;
-    student->totalMarks = 0;
-    student->maxMarks = 0;
+  static string attendanceLine(int present, int marked) {
+    ostringstream line;
+    line << present << "/" << marked;
+    if (marked > 0)
+      line << " (" << fixed << setprecision(1) << present * 100.0 / marked
+           << "%)";
+    return line.str();
+  }
 
-    while (current != nullptr) {
-      int maxMarksForSub = student->getMaxMarksForSubject(current->subjectName);
-      // Create a lambda function for validation with specific max marks
-      auto validateMarksForSub = [maxMarksForSub](string marks) -> bool {
-        return validateMarks(marks, maxMarksForSub);
-      };
-      string marks =
-          getValidInput("Enter marks for " + current->subjectName + " (0-" +
-                            to_string(maxMarksForSub) + ", A=Absent, L=Leave)",
-                        true, validateMarksForSub);
+  void attendanceReports() {
+    cout << "\n--- Attendance Reports ---\n";
+    cout << "1. Student Attendance by Month/Term/Session\n"
+            "2. Students Below Attendance Threshold (This Term)\n";
+    string choice = getValidInput("Enter choice", false);
+    int32_t day = today();
+
+    if (choice == "1") {
+      string rollNo = getValidInput("Enter Roll Number", false);
+      Student *student = searchInHashTable(rollNo);
+      if (student == nullptr) {
+        cout << "[ERROR] Student not found!\n";
+        return;
+      }
+      int classNum = student->getClassNumber();
+      int32_t from, to;
+      attendanceRange(classNum, day, SESSION, from, to);
+      cout << "[INFO] " << student->getName() << " (Class "
+           << student->getClassName() << "), present/marked days\n";
+      int32_t monthStart = from;
+      for (int m = 0; m < 12; m++) {
+        int32_t monthFrom, monthTo;
+        attendanceRange(classNum, monthStart, MONTH, monthFrom, monthTo);
+        int year, month, date, marked, present;
+        Calendar::fromDayNumber(monthFrom, year, month, date);
+        student->record().attendance.countBetween(monthFrom, monthTo, marked,
+                                                  present);
+        cout << "  " << year << "-" << setw(2) << setfill('0') << month
+             << setfill(' ') << "            : "
+             << attendanceLine(present, marked) << "\n";
+        if (m % 4 == 3) {
+          int32_t termFrom, termTo;
+          attendanceRange(classNum, monthFrom, TERM, termFrom, termTo);
+          student->record().attendance.countBetween(termFrom, termTo,
+                                                    marked, present);
+          cout << "  Term " << m / 4 + 1
+               << "             : " << attendanceLine(present, marked)
+               << "\n";
+        }
+        monthStart = monthTo + 1;
+      }
+      int marked, present;
+      student->record().attendance.countBetween(from, to, marked, present);
+      cout << "  Session            : " << attendanceLine(present, marked)
+           << "\n";
+    } else if (choice == "2") {
+      string classInput = getValidInput("Enter Class (1-12, 0 for all)", false,
+                                        [](string value) {
+                                          return value == "0" ||
+                                                 validateClass(value);
+                                        });
+      string thresholdInput = getValidInput(
+          "Threshold percentage (default 75)", true, [](string value) {
+            try {
+              return stof(value) >= 0;
+            } catch (...) {
+              return false;
+            }
+          });
+      float threshold = thresholdInput.empty() ? 75 : stof(thresholdInput);
+      const size_t MAX_SHOWN = 50;
+      vector<AttendanceShortfall> list =
+          belowAttendance(threshold, stoi(classInput), day);
+      if (list.empty()) {
+        cout << "[INFO] No students below " << threshold
+             << "% attendance this term.\n";
+        return;
+      }
+      for (size_t i = 0; i < list.size() && i < MAX_SHOWN; i++)
+        cout << "  " << list[i].student->rollNo << "  "
+             << list[i].student->getName() << "  (Class "
+             << list[i].student->getClassName() << ")  "
+             << attendanceLine(list[i].present, list[i].marked) << "\n";
+      if (list.size() > MAX_SHOWN)
+        cout << "[INFO] " << list.size() - MAX_SHOWN
+             << " further students not shown.\n";
+      cout << "[WARNING] " << list.size() << " students are below "
+           << threshold << "% attendance this term.\n";
+    } else {
+      cout << "[ERROR] Invalid choice!\n";
+    }
+  }
 
-      if (!marks.empty()) {
-        current->marksStatus = marks;
-        if (marks != "A" && marks != "L" && marks != "-") {
-          float markValue = stof(marks);
-          if (markValue > maxMarksForSub) {
-            cout << "[WARNING] Marks exceed maximum (" << maxMarksForSub
-                 << "). Setting to maximum.\n";
-            markValue = maxMarksForSub;
-            current->marksStatus = to_string((int)markValue);
-          }
-          student->totalMarks += markValue;
-          student->maxMarks += maxMarksForSub;
-        }
-      } else {
-        if (current->marksStatus != "A" && current->marksStatus != "L" &&
-            current->marksStatus != "-") {
-          student->totalMarks += stof(current->marksStatus);
-          student->maxMarks += maxMarksForSub;
-        }
+  void meritLists() {
+    cout << "\n--- Merit Lists ---\n";
+    string classInput = getValidInput("Enter Class (1-12, 0 for all)", false,
+                                      [](string value) {
+                                        return value == "0" ||
+                                               validateClass(value);
+                                      });
+    int classNum = stoi(classInput);
+    cout << "1. Top Students\n2. Student Rank\n3. Students in Percentage "
+            "Range\n4. Grade Band Counts\n";
+    string choice = getValidInput("Enter choice", false);
+
+    if (choice == "1") {
+      string countInput = getValidInput("How many students? (default 10)",
+                                        true, [](const string &value) {
+                                          int n;
+                                          return parseNumber(value, n) && n > 0;
+                                        });
+      size_t count = countInput.empty() ? 10 : stoi(countInput);
+      vector<Student *> top = topStudents(classNum, count);
+      if (top.empty())
+        cout << "[INFO] No students in that class!\n";
+      else
+        showMeritList(top);
+    } else if (choice == "2") {
+      string rollNo = getValidInput("Enter Roll Number", false);
+      Student *student = searchInHashTable(rollNo);
+      if (student == nullptr) {
+        cout << "[ERROR] Student not found!\n";
+        return;
       }
-      current = current->next;
+      size_t classSize;
+      size_t rank = meritRank(student, classSize);
+      cout << "[INFO] " << student->getName() << " is ranked " << rank << " of "
+           << classSize << " in class " << student->getClassName() << " ("
+           << fixed << setprecision(2) << student->getPercentage() << "%)\n";
+    } else if (choice == "3") {
+      auto isPercentage = [](string value) {
+        try {
+          return stof(value) >= 0;
+        } catch (...) {
+          return false;
+        }
+      };
+      string lowest =
+          getValidInput("Lowest percentage (included)", false, isPercentage);
+      string highest =
+          getValidInput("Highest percentage (excluded)", false, isPercentage);
+      vector<Student *> range =
+          studentsInRange(classNum, stof(lowest), stof(highest));
+      if (range.empty())
+        cout << "[INFO] No students in that range!\n";
+      else
+        showMeritList(range);
+    } else if (choice == "4") {
+      size_t counts[6];
+      gradeBands(classNum, counts);
+      for (int band = 0; band < 6; band++)
+        cout << "  Grade " << (char)('A' + band) << " : " << counts[band]
+             << "\n";
+    } else {
+      cout << "[ERROR] Invalid choice!\n";
     }
+  }
 
-    if (student->maxMarks > 0) {
-      student->percentage = (student->totalMarks / student->maxMarks) * 100.0;
-      student->grade = Student::calculateGrade(student->percentage);
+  // Recompute totals, percentage and grade of every student from the stored
+  // marks, e.g. after a grading or max-marks rule changes. Returns the number
+  // of students recomputed.
+  int recomputeAllGrades() {
+    vector<float> totalMarks = store.totalMarks;
+    vector<float> maxMarks = store.maxMarks;
+    vector<float> percentage = store.percentage;
+    vector<char> grade = store.grade;
+    recomputeGrades(store.marks,
+                    GradeColumns{store.totalMarks.data(), store.maxMarks.data(),
+                                 store.percentage.data(), store.grade.data()});
+    // A student whose results changed gets them in its record version too,
+    // for readers, and moves in the merit order
+    for (size_t slot = 0; slot < store.slotCount(); slot++) {
+      Student *student = store.owner[slot];
+      if (student == nullptr ||
+          (!memcmp(&totalMarks[slot], &store.totalMarks[slot], sizeof(float)) &&
+           !memcmp(&maxMarks[slot], &store.maxMarks[slot], sizeof(float)) &&
+           !memcmp(&percentage[slot], &store.percentage[slot],
+                   sizeof(float)) &&
+           grade[slot] == store.grade[slot]))
+        continue;
+      student->copySummary(student->record());
+      if (meritIndex.isActive() &&
+          memcmp(&percentage[slot], &store.percentage[slot], sizeof(float)))
+        meritIndex.refresh(student);
     }
+    return totalStudents;
+  }
 
-    // Ask if these are board marks (for classes 8-12)
-    int classNum = stoi(student->className);
-    if (classNum >= 8 && classNum <= 12) {
-      string boardMarks = getValidInput("Are these board marks? (Y/N)", false);
-      if (boardMarks == "Y" || boardMarks == "y") {
-        student->boardMarksEntered = true;
-      }
+  // Same for the students of one class (and category, when not empty)
+  int recomputeClassGrades(int classNum, const string &category) {
+    vector<Student *> members = classMembers(classNum, category);
+    size_t count = members.size();
+    MarksColumns columns;
+    vector<float> totalMarks(count), maxMarks(count), percentage(count);
+    vector<char> grade(count);
+    for (size_t i = 0; i < count; i++) {
+      gatherMarks(columns, members[i]);
+      percentage[i] = members[i]->getPercentage();
+      grade[i] = members[i]->getGrade();
+    }
+    recomputeGrades(columns, GradeColumns{totalMarks.data(), maxMarks.data(),
+                                          percentage.data(), grade.data()});
+    for (size_t i = 0; i < count; i++) {
+      uint32_t slot = members[i]->getSlot();
+      bool changed = memcmp(&store.percentage[slot], &percentage[i],
+                            sizeof(float)) != 0;
+      store.totalMarks[slot] = totalMarks[i];
+      store.maxMarks[slot] = maxMarks[i];
+      store.percentage[slot] = percentage[i];
+      store.grade[slot] = grade[i];
+      members[i]->copySummary(members[i]->record());
+      if (changed)
+        meritIndex.refresh(members[i]);
     }
+    return (int)count;
+  }
 
-    cout << "[SUCCESS] Marks updated!\n";
+  bool saveSnapshot(string filename) {
+    if (head == nullptr) {
+      cout << "\n[WARNING] No data to save!\n";
+      return false;
+    }
+    // Saving over the journal's snapshot is a compaction
+    if (journal.isOpen() && filename == snapshotPath)
+      return compactJournal();
+    if (!writeSnapshot(filename, journalGeneration))
+      return false;
+    cout << "[SUCCESS] Snapshot of " << totalStudents << " students saved to "
+         << filename << "\n";
+    return true;
   }
 
-  void updateTerms(string rollNo) {
-    cout << "\n--- Update Terms ---\n";
+  void loadSnapshot(string filename) {
+    uint64_t generation;
+    if (readSnapshot(filename, generation) && journal.isOpen())
+      compactJournal(); // bulk loads are not journaled record by record
+  }
 
-    Student *student = searchInHashTable(rollNo);
-    if (student == nullptr) {
-      cout << "[ERROR] Student not found!\n";
-      return;
+  // Students are destroyed in slot order, which follows their pool slabs.
+  // Only the strings they own need freeing one by one; the students and
+  // their attendance blocks go with the pools' slabs.
+  ~StudentManager() {
+    if (backgroundSave && backgroundSave->worker.joinable())
+      backgroundSave->worker.join();
+    {
+      EpochDomain::Exclusive last(epochs); // Destroys retired students
     }
+    store.drain();
+    for (Student *student : store.owner) {
+      if (student != nullptr)
+        student->~Student();
+    }
+  }
+};
 
-    cout << "Student: " << student->name << "\n";
-    cout << "Current terms completed: " << student->termsCompleted << "/3\n";
+// The program itself: menus, front ends and main. Student Record
+// Benchmarks.cpp includes this file with STUDENT_RECORD_NO_MAIN defined
+// and brings its own main.
+#ifndef STUDENT_RECORD_NO_MAIN
 
-    string termsStr =
-        getValidInput("Enter number of terms completed (0-3)", false);
-    int terms = stoi(termsStr);
-    if (terms < 0 || terms > 3) {
-      cout << "[ERROR] Terms must be between 0 and 3!\n";
-      return;
-    }
+#ifdef __linux__
+// Server mode frames: a 4-byte little-endian payload length, then the
+// payload. A request payload is one batch command line; its response
+// payload is what batch mode prints for that command.
+class Frames {
+public:
+  static const uint32_t MAX_PAYLOAD = 1 << 20;
 
-    student->termsCompleted = terms;
-    cout << "[SUCCESS] Terms updated!\n";
+  static void append(string &out, string_view payload) {
+    uint32_t length = (uint32_t)payload.size();
+    for (int i = 0; i < 4; i++)
+      out += (char)(length >> (8 * i) & 0xFF);
+    out.append(payload.data(), payload.size());
   }
 
-  void manageSubjects(string rollNo) {
-    cout << "\n--- Manage Subjects ---\n";
-
-    Student *student = searchInHashTable(rollNo);
-    if (student == nullptr) {
-      cout << "[ERROR] Student not found!\n";
-      return;
+  // The frame starting at `offset`, if it has fully arrived; `offset` then
+  // moves past it. Sets `bad` for a length over MAX_PAYLOAD.
+  static bool next(const string &in, size_t &offset, string_view &payload,
+                   bool &bad) {
+    bad = false;
+    if (in.size() - offset < 4)
+      return false;
+    uint32_t length = 0;
+    for (int i = 0; i < 4; i++)
+      length |= (uint32_t)(unsigned char)in[offset + i] << (8 * i);
+    if (length > MAX_PAYLOAD) {
+      bad = true;
+      return false;
     }
+    if (in.size() - offset - 4 < length)
+      return false;
+    payload = string_view(in).substr(offset + 4, length);
+    offset += 4 + length;
+    return true;
+  }
+};
 
-    cout << "Student: " << student->name << " (Class: " << student->className
-         << ")\n";
-    cout << "\nCurrent Subjects:\n";
-
-    Subject *current = student->subjectHead;
-    int count = 1;
-    while (current != nullptr) {
-      cout << "  " << count << ". " << current->subjectName << "\n";
-      current = current->next;
-      count++;
+// Connect to a server: "host:port" over TCP, anything else is the path of
+// a Unix domain socket. Returns a blocking socket, or -1.
+static int connectToServer(const string &target) {
+  size_t colon = target.rfind(':');
+  const char *digits = target.c_str() + colon + 1;
+  const char *end = target.c_str() + target.size();
+  int port = 0;
+  if (colon != string::npos && digits != end &&
+      from_chars(digits, end, port).ptr == end) {
+    sockaddr_in address;
+    memset(&address, 0, sizeof(address));
+    address.sin_family = AF_INET;
+    address.sin_port = htons((uint16_t)port);
+    string host = target.substr(0, colon);
+    if (inet_pton(AF_INET, host == "localhost" ? "127.0.0.1" : host.c_str(),
+                  &address.sin_addr) != 1)
+      return -1;
+    int fd = socket(AF_INET, SOCK_STREAM | SOCK_CLOEXEC, 0);
+    if (fd < 0)
+      return -1;
+    int one = 1;
+    setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one));
+    if (connect(fd, (sockaddr *)&address, sizeof(address)) != 0) {
+      close(fd);
+      return -1;
     }
+    return fd;
+  }
 
-    cout << "\n[INFO] Subjects are managed automatically based on class and "
-            "category.\n";
-    cout << "To modify subjects, please delete and re-add the student with "
-            "correct category.\n";
+  sockaddr_un address;
+  memset(&address, 0, sizeof(address));
+  address.sun_family = AF_UNIX;
+  if (target.size() >= sizeof(address.sun_path))
+    return -1;
+  memcpy(address.sun_path, target.c_str(), target.size() + 1);
+  int fd = socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+  if (fd < 0)
+    return -1;
+  if (connect(fd, (sockaddr *)&address, sizeof(address)) != 0) {
+    close(fd);
+    return -1;
   }
+  return fd;
+}
 
-  void deleteStudent(string rollNo) {
-    cout << "\n--- Deleting Student ---\n";
+// Client side of one server connection
+class FrameConnection {
+public:
+  FrameConnection() : fd(-1), offset(0) {}
+  ~FrameConnection() {
+    if (fd >= 0)
+      close(fd);
+  }
+  FrameConnection(const FrameConnection &) = delete;
+  FrameConnection &operator=(const FrameConnection &) = delete;
 
-    if (head == nullptr) {
-      cout << "[ERROR] No students in system!\n";
-      return;
-    }
+  bool open(const string &target) {
+    fd = connectToServer(target);
+    return fd >= 0;
+  }
 
-    Student *toDelete = searchInHashTable(rollNo);
-    if (toDelete == nullptr) {
-      cout << "[ERROR] Student not found!\n";
-      return;
+  // Write every byte of `frames`
+  bool send(const string &frames) {
+    size_t sent = 0;
+    while (sent < frames.size()) {
+      ssize_t n = ::send(fd, frames.data() + sent, frames.size() - sent,
+                         MSG_NOSIGNAL);
+      if (n < 0 && errno == EINTR)
+        continue;
+      if (n <= 0)
+        return false;
+      sent += (size_t)n;
     }
+    return true;
+  }
 
-    if (head->rollNo == rollNo) {
-      head = head->next;
-      removeFromHashTable(rollNo);
-      delete toDelete;
-      totalStudents--;
-      cout << "[SUCCESS] Student deleted!\n";
-      return;
+  // Wait for data and pass each complete response to `each`; false once
+  // the server has gone away
+  bool receive(const function<void(string_view)> &each) {
+    if (offset > 0) {
+      in.erase(0, offset);
+      offset = 0;
     }
+    char buffer[1 << 16];
+    ssize_t n;
+    do {
+      n = recv(fd, buffer, sizeof(buffer), 0);
+    } while (n < 0 && errno == EINTR);
+    if (n <= 0)
+      return false;
+    in.append(buffer, (size_t)n);
+    string_view payload;
+    bool bad;
+    while (Frames::next(in, offset, payload, bad))
+      each(payload);
+    return !bad;
+  }
 
-    Student *current = head;
-    Student *previous = nullptr;
+private:
+  int fd;
+  string in;
+  size_t offset; // Start of the first response not yet passed on
+};
 
-    while (current != nullptr && current->rollNo != rollNo) {
-      previous = current;
-      current = current->next;
-    }
+// Serves StudentManager::serveRequest over Unix domain and loopback TCP
+// sockets. Every worker thread runs its own epoll loop and accepts from the
+// shared listening sockets, so a connection stays on one thread. Requests
+// that arrive together are answered in order with one write.
+class RecordServer {
+public:
+  explicit RecordServer(StudentManager &owner) : manager(owner) {}
+  RecordServer(const RecordServer &) = delete;
+  RecordServer &operator=(const RecordServer &) = delete;
+
+  ~RecordServer() {
+    for (int fd : listeners)
+      close(fd);
+    if (!socketPath.empty())
+      unlink(socketPath.c_str());
+  }
 
-    if (current != nullptr) {
-      previous->next = current->next;
-      removeFromHashTable(rollNo);
-      delete current;
-      totalStudents--;
-      cout << "[SUCCESS] Student deleted!\n";
+  bool listenUnix(const string &path) {
+    sockaddr_un address;
+    memset(&address, 0, sizeof(address));
+    address.sun_family = AF_UNIX;
+    if (path.size() >= sizeof(address.sun_path))
+      return false;
+    memcpy(address.sun_path, path.c_str(), path.size() + 1);
+    unlink(path.c_str()); // A socket left behind by an earlier run
+    int fd = socket(AF_UNIX, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+    if (fd < 0)
+      return false;
+    if (bind(fd, (sockaddr *)&address, sizeof(address)) != 0 ||
+        listen(fd, SOMAXCONN) != 0) {
+      close(fd);
+      return false;
     }
+    listeners.push_back(fd);
+    socketPath = path;
+    return true;
   }
 
-  void searchStudent(string rollNo) {
-    cout << "\n--- Search Student ---\n";
-    Student *student = searchInHashTable(rollNo);
-    if (student != nullptr) {
-      cout << "[FOUND] Student Details:\n";
-      showStudentInfo(student);
-    } else {
-      cout << "[NOT FOUND] No student with roll number " << rollNo << "\n";
+  // Loopback only: the protocol has no authentication
+  bool listenTcp(int port) {
+    sockaddr_in address;
+    memset(&address, 0, sizeof(address));
+    address.sin_family = AF_INET;
+    address.sin_port = htons((uint16_t)port);
+    address.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    int fd = socket(AF_INET, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+    if (fd < 0)
+      return false;
+    int one = 1;
+    setsockopt(fd, SOL_SOCKET, SO_REUSEADDR, &one, sizeof(one));
+    if (bind(fd, (sockaddr *)&address, sizeof(address)) != 0 ||
+        listen(fd, SOMAXCONN) != 0) {
+      close(fd);
+      return false;
     }
+    listeners.push_back(fd);
+    return true;
   }
 
-  void displayAll() {
-    if (head == nullptr) {
-      cout << "\n[INFO] No students in system!\n";
-      return;
+  // Serve until SIGINT or SIGTERM
+  bool run(size_t threads) {
+    stopping = false;
+    signal(SIGPIPE, SIG_IGN);
+    signal(SIGINT, onSignal);
+    signal(SIGTERM, onSignal);
+    vector<int> polls;
+    for (size_t i = 0; i < threads; i++) {
+      int poll = epoll_create1(EPOLL_CLOEXEC);
+      if (poll < 0)
+        break;
+      polls.push_back(poll);
+      for (int fd : listeners) {
+        epoll_event event;
+        memset(&event, 0, sizeof(event));
+        event.events = EPOLLIN | EPOLLEXCLUSIVE;
+        event.data.fd = fd;
+        epoll_ctl(poll, EPOLL_CTL_ADD, fd, &event);
+      }
     }
+    if (polls.empty())
+      return false;
+    vector<thread> workers;
+    for (size_t i = 1; i < polls.size(); i++)
+      workers.emplace_back([this, &polls, i] { serve(polls[i]); });
+    serve(polls[0]);
+    for (thread &worker : workers)
+      worker.join();
+    for (int poll : polls)
+      close(poll);
+    return true;
+  }
 
-    cout << "\n========================================\n";
-    cout << "       ALL STUDENT RECORDS\n";
-    cout << "========================================\n";
-    cout << "Total Students: " << totalStudents << "\n\n";
+private:
+  // Responses a connection may have queued before its further requests
+  // wait for the client to read
+  static const size_t OUTPUT_LIMIT = 4 << 20;
+
+  struct Connection {
+    string in;
+    size_t inStart = 0;
+    string out;
+    size_t outStart = 0;
+    bool watchingOutput = false;
+  };
+
+  StudentManager &manager;
+  vector<int> listeners;
+  string socketPath;
+  static atomic<bool> stopping; // Lock-free, so the signal handler may set it
+
+  static void onSignal(int) { stopping = true; }
+
+  bool isListener(int fd) const {
+    return find(listeners.begin(), listeners.end(), fd) != listeners.end();
+  }
 
-    Student *current = head;
-    while (current != nullptr) {
-      showStudentInfo(current);
-      current = current->next;
+  void serve(int poll) {
+    unordered_map<int, Connection> connections;
+    epoll_event events[64];
+    while (!stopping) {
+      int ready = epoll_wait(poll, events, 64, 200);
+      for (int i = 0; i < ready; i++) {
+        int fd = events[i].data.fd;
+        if (isListener(fd)) {
+          accept(poll, fd, connections);
+          continue;
+        }
+        auto found = connections.find(fd);
+        if (found == connections.end())
+          continue;
+        Connection &connection = found->second;
+        bool open = (events[i].events & (EPOLLERR | EPOLLHUP)) == 0 ||
+                    (events[i].events & EPOLLIN) != 0;
+        if (open && (events[i].events & EPOLLIN))
+          open = readRequests(fd, connection);
+        if (open)
+          open = answer(fd, connection) && flush(poll, fd, connection);
+        if (!open) {
+          close(fd); // Also drops it from the epoll set
+          connections.erase(found);
+        }
+      }
     }
+    for (auto &entry : connections)
+      close(entry.first);
   }
 
-  void saveToFile(string filename) {
-    if (head == nullptr) {
-      cout << "\n[WARNING] No data to save!\n";
-      return;
+  void accept(int poll, int listener,
+              unordered_map<int, Connection> &connections) {
+    while (true) {
+      int fd = accept4(listener, nullptr, nullptr,
+                       SOCK_NONBLOCK | SOCK_CLOEXEC);
+      if (fd < 0)
+        return; // EAGAIN: another worker took it, or none left
+      int one = 1;
+      setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one));
+      epoll_event event;
+      memset(&event, 0, sizeof(event));
+      event.events = EPOLLIN;
+      event.data.fd = fd;
+      if (epoll_ctl(poll, EPOLL_CTL_ADD, fd, &event) != 0) {
+        close(fd);
+        continue;
+      }
+      connections[fd];
     }
+  }
 
-    ofstream file(filename);
-    if (!file.is_open()) {
-      cout << "[ERROR] Cannot open file!\n";
-      return;
+  // Read everything available; false once the client has closed
+  bool readRequests(int fd, Connection &connection) {
+    char buffer[1 << 16];
+    while (true) {
+      ssize_t n = read(fd, buffer, sizeof(buffer));
+      if (n > 0) {
+        connection.in.append(buffer, (size_t)n);
+        continue;
+      }
+      if (n < 0 && errno == EINTR)
+        continue;
+      return n < 0 && (errno == EAGAIN || errno == EWOULDBLOCK);
     }
+  }
 
-    Student *current = head;
-    while (current != nullptr) {
-      file << current->rollNo << "|" << current->name << "|"
-           << current->fatherName << "|" << current->className << "|"
-           << current->classCategory << "|" << current->admissionYear << "|"
-           << current->currentYear << "|" << current->dateOfBirth << "|"
-           << current->cnicBForm << "|" << current->address << "|"
-           << current->totalSubjects << "|" << current->termsCompleted << "|"
-           << (current->boardMarksEntered ? "1" : "0") << "|";
+  // Answer the complete requests received so far, unless too much output
+  // is waiting; false on a malformed frame
+  bool answer(int, Connection &connection) {
+    string_view request;
+    bool bad = false;
+    vector<size_t> unsynced; // Responses to changes not yet synced
+    while (connection.out.size() - connection.outStart < OUTPUT_LIMIT &&
+           Frames::next(connection.in, connection.inStart, request, bad)) {
+      size_t header = connection.out.size();
+      connection.out.append(4, '\0');
+      if (manager.serveRequest(request, connection.out))
+        unsynced.push_back(header);
+      uint32_t length = (uint32_t)(connection.out.size() - header - 4);
+      for (int i = 0; i < 4; i++)
+        connection.out[header + i] = (char)(length >> (8 * i) & 0xFF);
+    }
+    if (connection.inStart > 0) {
+      connection.in.erase(0, connection.inStart);
+      connection.inStart = 0;
+    }
+    // One sync covers every change of the burst before any response to it
+    // is sent
+    if (!unsynced.empty() && !manager.syncJournal())
+      failUnsynced(connection.out, unsynced);
+    return !bad;
+  }
 
-      Subject *sub = current->subjectHead;
-      while (sub != nullptr) {
-        file << sub->subjectName << ":" << sub->marksStatus;
-        if (sub->next != nullptr)
-          file << ",";
-        sub = sub->next;
+  // The journal could not sync: replace the response frames at `unsynced`
+  // with FAILED, as their changes may not survive a crash
+  static void failUnsynced(string &out, const vector<size_t> &unsynced) {
+    string rewritten;
+    size_t offset = unsynced.front();
+    size_t next = 0;
+    while (offset < out.size()) {
+      uint32_t length = 0;
+      for (int i = 0; i < 4; i++)
+        length |= (uint32_t)(unsigned char)out[offset + i] << (8 * i);
+      if (next < unsynced.size() && unsynced[next] == offset) {
+        string response;
+        StudentManager::appendUnsynced(response);
+        Frames::append(rewritten, response);
+        next++;
+      } else {
+        rewritten.append(out, offset, 4 + (size_t)length);
       }
-      file << "|";
+      offset += 4 + (size_t)length;
+    }
+    out.resize(unsynced.front());
+    out += rewritten;
+  }
 
-      // Save attendance data
-      for (auto &entry : current->attendance.attendanceMap) {
-        file << entry.first << ":" << (entry.second ? "P" : "A") << ",";
+  // Write queued responses, watching for writability while some remain
+  bool flush(int poll, int fd, Connection &connection) {
+    while (connection.outStart < connection.out.size()) {
+      ssize_t n = send(fd, connection.out.data() + connection.outStart,
+                       connection.out.size() - connection.outStart,
+                       MSG_NOSIGNAL);
+      if (n > 0) {
+        connection.outStart += (size_t)n;
+        continue;
       }
-
-      file << "\n";
-      current = current->next;
+      if (n < 0 && errno == EINTR)
+        continue;
+      if (n < 0 && (errno == EAGAIN || errno == EWOULDBLOCK))
+        break;
+      return false;
     }
-
-    file.close();
-    cout << "[SUCCESS] Data saved to " << filename << "\n";
+    bool pending = connection.outStart < connection.out.size();
+    if (!pending) {
+      connection.out.clear();
+      connection.outStart = 0;
+    }
+    if (pending != connection.watchingOutput) {
+      epoll_event event;
+      memset(&event, 0, sizeof(event));
+      event.events = pending ? EPOLLIN | EPOLLOUT : EPOLLIN;
+      event.data.fd = fd;
+      epoll_ctl(poll, EPOLL_CTL_MOD, fd, &event);
+      connection.watchingOutput = pending;
+    }
+    return true;
   }
+};
 
-  void loadFromFile(string filename) {
-    ifstream file(filename);
-    if (!file.is_open()) {
-      cout << "[ERROR] Cannot open file!\n";
-      return;
+atomic<bool> RecordServer::stopping(false);
+
+// --client: send every command line from stdin, keeping up to WINDOW
+// requests in flight, and print the responses in order. Returns the number
+// of failed commands, or -1 if the server could not be reached.
+static long runClient(const string &target, istream &input) {
+  const size_t WINDOW = 256;
+  FrameConnection connection;
+  if (!connection.open(target))
+    return -1;
+  long failures = 0;
+  size_t inFlight = 0;
+  bool more = true;
+  bool alive = true;
+  string line;
+  string frames;
+  auto printResponse = [&](string_view response) {
+    fwrite(response.data(), 1, response.size(), stdout);
+    if (response.empty() || response[0] != '0')
+      failures++;
+    inFlight--;
+  };
+  while (alive && (more || inFlight > 0)) {
+    frames.clear();
+    while (more && inFlight < WINDOW) {
+      if (!getline(input, line)) {
+        more = false;
+        break;
+      }
+      if (!line.empty() && line.back() == '\r')
+        line.pop_back();
+      if (line.empty() || line[0] == '#')
+        continue;
+      Frames::append(frames, line);
+      inFlight++;
     }
+    if (!frames.empty() && !connection.send(frames))
+      return -1;
+    if (inFlight > 0)
+      alive = connection.receive(printResponse);
+  }
+  fflush(stdout);
+  return alive ? failures : -1;
+}
 
-    string line;
-    int loadedCount = 0;
-
-    while (getline(file, line)) {
-      vector<string> tokens;
-      size_t pos = 0;
-
-      while ((pos = line.find('|')) != string::npos) {
-        tokens.push_back(line.substr(0, pos));
-        line.erase(0, pos + 1);
-      }
-      tokens.push_back(line);
-
-      if (tokens.size() >= 12) {
-        string r = tokens[0];
-
-        if (searchInHashTable(r) == nullptr) {
-          Student *newStudent =
-              new Student(r, tokens[1], tokens[2], tokens[3], tokens[4],
-                          stoi(tokens[5]), tokens[7], tokens[8], tokens[9]);
-          newStudent->currentYear = stoi(tokens[6]);
-
-          // Load subjects (check old format first for backward compatibility)
-          string subjectsData;
-          if (tokens.size() >= 12) {
-            // Check if new format (with terms and board marks)
-            if (tokens.size() >= 14 && tokens[12].find(':') == string::npos) {
-              // New format: terms and board marks are separate tokens
-              newStudent->termsCompleted = stoi(tokens[12]);
-              newStudent->boardMarksEntered = (tokens[13] == "1");
-              subjectsData = tokens[11];
-              // Attendance starts at token 14
-            } else {
-              // Old format: subjects at token 11, attendance at token 12
-              subjectsData = tokens[11];
-            }
-          }
-          size_t subPos;
-          while ((subPos = subjectsData.find(',')) != string::npos) {
-            string subPair = subjectsData.substr(0, subPos);
-            size_t colonPos = subPair.find(':');
-            if (colonPos != string::npos) {
-              newStudent->addSubject(subPair.substr(0, colonPos),
-                                     subPair.substr(colonPos + 1));
-            }
-            subjectsData.erase(0, subPos + 1);
-          }
-          // Handle last subject (no comma after it)
-          if (!subjectsData.empty()) {
-            size_t colonPos = subjectsData.find(':');
-            if (colonPos != string::npos) {
-              newStudent->addSubject(subjectsData.substr(0, colonPos),
-                                     subjectsData.substr(colonPos + 1));
-            }
-          }
-
-          // Load attendance if exists
-          int attendanceTokenIndex = 12; // Default for old format
-          if (tokens.size() >= 14) {
-            // New format: attendance is at token 14
-            attendanceTokenIndex = 14;
-          }
-
-          if (tokens.size() > attendanceTokenIndex &&
-              !tokens[attendanceTokenIndex].empty()) {
-            string attData = tokens[attendanceTokenIndex];
-            while ((pos = attData.find(',')) != string::npos) {
-              string attPair = attData.substr(0, pos);
-              size_t colonPos = attPair.find(':');
-              if (colonPos != string::npos) {
-                string dateKey = attPair.substr(0, colonPos);
-                bool present = (attPair.substr(colonPos + 1) == "P");
-                newStudent->attendance.attendanceMap[dateKey] = present;
-              }
-              attData.erase(0, pos + 1);
-            }
-          }
-
-          if (head == nullptr) {
-            head = newStudent;
-          } else {
-            Student *temp = head;
-            while (temp->next != nullptr) {
-              temp = temp->next;
-            }
-            temp->next = newStudent;
-          }
+// --bench: `connections` clients each keep `depth` QUERY/ATTENDANCE
+// requests for random roll numbers in flight until `requests` have been
+// answered in all, then print throughput and latency percentiles
+static bool runLoadGenerator(const string &target, size_t connections,
+                             size_t requests, size_t depth) {
+  // Roll numbers to ask for, from each class roster
+  vector<string> rolls;
+  {
+    FrameConnection control;
+    if (!control.open(target))
+      return false;
+    string frames;
+    for (int classNum = 1; classNum <= 12; classNum++)
+      Frames::append(frames, "ROSTER|" + to_string(classNum));
+    if (!control.send(frames))
+      return false;
+    int answered = 0;
+    while (answered < 12) {
+      bool alive = control.receive([&](string_view response) {
+        answered++;
+        size_t list = response.find(' ', 5); // After "0 OK <count>"
+        if (response.substr(0, 4) != "0 OK" || list == string_view::npos)
+          return;
+        for (string &roll : StudentManager::splitRolls(
+                 response.substr(list + 1, response.size() - list - 2)))
+          rolls.push_back(std::move(roll));
+      });
+      if (!alive)
+        return false;
+    }
+  }
+  if (rolls.empty()) {
+    cout << "[ERROR] The server has no students to query.\n";
+    return false;
+  }
 
-          addToHashTable(newStudent);
-          totalStudents++;
-          loadedCount++;
+  using Clock = chrono::steady_clock;
+  vector<vector<uint32_t>> latencies(connections); // Microseconds
+  atomic<size_t> errors(0);
+  atomic<bool> failed(false);
+  size_t share = (requests + connections - 1) / connections;
+  Clock::time_point start = Clock::now();
+  vector<thread> clients;
+  for (size_t c = 0; c < connections; c++) {
+    clients.emplace_back([&, c] {
+      FrameConnection connection;
+      if (!connection.open(target)) {
+        failed = true;
+        return;
+      }
+      uint64_t random = 0x9E3779B97F4A7C15ULL * (c + 1);
+      deque<Clock::time_point> sentAt;
+      size_t sent = 0;
+      size_t received = 0;
+      string frames;
+      latencies[c].reserve(share);
+      while (received < share) {
+        frames.clear();
+        while (sent < share && sentAt.size() < depth) {
+          random ^= random << 13;
+          random ^= random >> 7;
+          random ^= random << 17;
+          const string &roll = rolls[random % rolls.size()];
+          Frames::append(frames, (random >> 32) % 10 == 0
+                                     ? "ATTENDANCE|" + roll
+                                     : "QUERY|" + roll);
+          sentAt.push_back(Clock::now());
+          sent++;
+        }
+        if (!frames.empty() && !connection.send(frames)) {
+          failed = true;
+          return;
+        }
+        bool alive = connection.receive([&](string_view response) {
+          Clock::time_point now = Clock::now();
+          latencies[c].push_back((uint32_t)chrono::duration_cast<
+                                     chrono::microseconds>(now - sentAt.front())
+                                     .count());
+          sentAt.pop_front();
+          received++;
+          if (response.empty() || response[0] != '0')
+            errors++;
+        });
+        if (!alive) {
+          failed = true;
+          return;
         }
       }
-    }
-
-    file.close();
-    cout << "[SUCCESS] " << loadedCount << " students loaded!\n";
+    });
   }
-
-  ~StudentManager() {
-    Student *current = head;
-    while (current != nullptr) {
-      Student *next = current->next;
-      delete current;
-      current = next;
-    }
+  for (thread &client : clients)
+    client.join();
+  double seconds = chrono::duration<double>(Clock::now() - start).count();
+  if (failed) {
+    cout << "[ERROR] Lost the connection to the server.\n";
+    return false;
   }
-};
+
+  vector<uint32_t> all;
+  for (vector<uint32_t> &part : latencies)
+    all.insert(all.end(), part.begin(), part.end());
+  sort(all.begin(), all.end());
+  auto percentile = [&](double p) {
+    return all[min(all.size() - 1, (size_t)(p * all.size()))];
+  };
+  cout << "requests=" << all.size() << " connections=" << connections
+       << " depth=" << depth << " errors=" << errors << "\n";
+  cout << fixed << setprecision(0) << "throughput=" << all.size() / seconds
+       << " req/s p50=" << percentile(0.50) << "us p99=" << percentile(0.99)
+       << "us\n";
+  return true;
+}
+#endif
 
 void displayMainMenu() {
   cout << "\n+------------------------------------------------------+\n";
@@ -1087,24 +8859,126 @@ void displayMainMenu() {
   cout << "| 9. Save to File                                     |\n";
   cout << "| 10. Load from File                                  |\n";
   cout << "| 11. Manage Subjects                                 |\n";
+  cout << "| 12. Save Binary Snapshot                            |\n";
+  cout << "| 13. Load Binary Snapshot                            |\n";
+  cout << "| 14. Import Students from CSV                        |\n";
+  cout << "| 15. Recompute All Grades                            |\n";
+  cout << "| 16. Class Operations                                |\n";
+  cout << "| 17. Search by Name                                  |\n";
+  cout << "| 18. Merit Lists                                     |\n";
+  cout << "| 19. Find Duplicate CNICs                            |\n";
+  cout << "| 20. Attendance Reports                              |\n";
+  cout << "| 21. Open Archive (Load on Demand)                   |\n";
+  cout << "| 22. Class Segment Files                             |\n";
   cout << "| 0. Exit                                             |\n";
   cout << "+------------------------------------------------------+\n";
   cout << "Enter choice: ";
 }
 
-int main() {
+// Menu actions that work on the whole roster, so they first load the rest
+// of an open archive
+static bool usesWholeRoster(int choice) {
+  return choice == 6 || choice == 7 || choice == 9 || choice == 10 ||
+         (choice >= 12 && choice <= 20) || choice == 22;
+}
+
+int main(int argc, char *argv[]) {
   StudentManager manager;
   int choice;
 
+  // --batch [file]: run commands from a file (or stdin) without the menu.
+  // Console messages (load diagnostics, save reports) go to stderr, so
+  // stdout carries only the response lines.
+  if (argc >= 2 && string(argv[1]) == "--batch") {
+    string source = argc >= 3 ? argv[2] : "-";
+    cout.rdbuf(cerr.rdbuf());
+    manager.openJournal("students.dat", "students.journal");
+    if (source == "-") {
+      LineReader input(cin);
+      return manager.runBatch(input, stdout) == 0 ? 0 : 1;
+    }
+    LineReader input(source);
+    if (!input.is_open()) {
+      cerr << "[ERROR] Cannot open " << source << "\n";
+      return 2;
+    }
+    return manager.runBatch(input, stdout) == 0 ? 0 : 1;
+  }
+
+#ifdef __linux__
+  // --serve [socket] [--tcp port] [--threads n]: answer framed requests on
+  // a Unix domain socket (default students.sock) and optionally on a
+  // loopback TCP port. Console messages go to stderr, as in batch mode.
+  if (argc >= 2 && string(argv[1]) == "--serve") {
+    cout.rdbuf(cerr.rdbuf());
+    string path = "students.sock";
+    int port = 0;
+    size_t threads = workerCount();
+    for (int i = 2; i < argc; i++) {
+      string arg = argv[i];
+      if (arg == "--tcp" && i + 1 < argc)
+        port = atoi(argv[++i]);
+      else if (arg == "--threads" && i + 1 < argc)
+        threads = (size_t)max(1, atoi(argv[++i]));
+      else
+        path = arg;
+    }
+    manager.openJournal("students.dat", "students.journal");
+    RecordServer server(manager);
+    if (!server.listenUnix(path) || (port != 0 && !server.listenTcp(port))) {
+      cerr << "[ERROR] Cannot listen on " << path;
+      if (port != 0)
+        cerr << " and port " << port;
+      cerr << "\n";
+      return 2;
+    }
+    cout << "[INFO] Serving on " << path;
+    if (port != 0)
+      cout << " and 127.0.0.1:" << port;
+    cout << " with " << threads << " threads; Ctrl+C stops.\n";
+    cout.flush();
+    server.run(threads);
+    return manager.syncJournal() ? 0 : 1;
+  }
+
+  // --client [socket|host:port]: send the commands on stdin to a server
+  if (argc >= 2 && string(argv[1]) == "--client") {
+    string target = argc >= 3 ? argv[2] : "students.sock";
+    long failures = runClient(target, cin);
+    if (failures < 0) {
+      cerr << "[ERROR] Lost or could not reach " << target << "\n";
+      return 2;
+    }
+    return failures == 0 ? 0 : 1;
+  }
+
+  // --bench [socket|host:port [connections [requests [depth]]]]
+  if (argc >= 2 && string(argv[1]) == "--bench") {
+    string target = argc >= 3 ? argv[2] : "students.sock";
+    size_t connections = argc >= 4 ? (size_t)max(1, atoi(argv[3])) : 4;
+    size_t requests = argc >= 5 ? (size_t)max(1, atoi(argv[4])) : 200000;
+    size_t depth = argc >= 6 ? (size_t)max(1, atoi(argv[5])) : 32;
+    return runLoadGenerator(target, connections, requests, depth) ? 0 : 2;
+  }
+#endif
+
   cout << "\n+------------------------------------------------------+\n";
   cout << "|       WELCOME TO STUDENT RECORD MANAGEMENT SYSTEM   |\n";
   cout << "+------------------------------------------------------+\n";
 
+  manager.openJournal("students.dat", "students.journal");
+
   do {
     displayMainMenu();
     cin >> choice;
     cin.ignore();
 
+    // Each action has the roster to itself; a background save carries on
+    // between actions
+    unique_ptr<StudentManager::RosterLock> roster(
+        new StudentManager::RosterLock(manager));
+    if (usesWholeRoster(choice))
+      manager.loadArchive();
     switch (choice) {
     case 1:
       manager.addStudent();
@@ -1118,7 +8992,7 @@ int main() {
     }
     case 3: {
       string roll;
-      cout << "Enter Roll Number for attendance: ";
+      cout << "Enter Roll Number(s) for attendance (comma-separated): ";
       getline(cin, roll);
       manager.markAttendance(roll);
       break;
@@ -1151,7 +9025,7 @@ int main() {
       break;
     }
     case 9:
-      manager.saveToFile("students.txt");
+      manager.saveInBackground("students.txt");
       break;
     case 10:
       manager.loadFromFile("students.txt");
@@ -1163,13 +9037,66 @@ int main() {
       manager.manageSubjects(roll);
       break;
     }
+    case 12:
+      manager.saveSnapshot("students.dat");
+      break;
+    case 13:
+      manager.loadSnapshot("students.dat");
+      break;
+    case 14: {
+      string filename;
+      cout << "Enter CSV file name (Press Enter for students.csv): ";
+      getline(cin, filename);
+      manager.importCSV(filename.empty() ? "students.csv" : filename);
+      break;
+    }
+    case 15:
+      cout << "[SUCCESS] Grades recomputed for "
+           << manager.recomputeAllGrades() << " students.\n";
+      break;
+    case 16:
+      manager.manageClass();
+      break;
+    case 17: {
+      string query;
+      cout << "Enter part of the student's or father's name: ";
+      getline(cin, query);
+      manager.searchByName(query);
+      break;
+    }
+    case 18:
+      manager.meritLists();
+      break;
+    case 19:
+      manager.findDuplicateCnics();
+      break;
+    case 20:
+      manager.attendanceReports();
+      break;
+    case 21: {
+      string filename;
+      cout << "Enter archive file name (Press Enter for students.txt): ";
+      getline(cin, filename);
+      manager.attachArchive(filename.empty() ? "students.txt" : filename,
+                            StudentManager::ARCHIVE_CACHE);
+      break;
+    }
+    case 22:
+      manager.manageSegments();
+      break;
     case 0:
       cout << "\nThank you for using Student Record Management System!\n";
       break;
     default:
-      cout << "[ERROR] Invalid choice! Please enter 0-11\n";
+      cout << "[ERROR] Invalid choice! Please enter 0-22\n";
     }
 
+    manager.trimArchiveCache();
+    roster.reset();
+    if (!manager.syncJournal())
+      cout << "[ERROR] The journal cannot be written; changes are not "
+              "logged. Save a snapshot (option 12) to keep them.\n";
+
     if (choice != 0) {
       cout << "\nPress Enter to continue...";
       cin.get();
@@ -1178,4 +9105,5 @@ int main() {
   } while (choice != 0);
 
   return 0;
-}
\ No newline at end of file
+}
+#endif // STUDENT_RECORD_NO_MAIN